@@ -0,0 +1,529 @@
+// Replays an allocation trace recorded by a MAPLE_MEMORY_TRACE build (see
+// Win32DumpMemoryTrace) against several allocators, reporting the time per
+// operation, the peak footprint and how fragmentation develops over the trace.
+//
+// Build: build.bat bench
+// Run:   build\maple_alloc_bench.exe memory_trace.bin [samples.csv]
+//
+// To compare a new allocator, implement a bench_allocator and add it to
+// BenchAllocators.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <malloc.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
+#include "../platform/mm/memory.h"
+#include "../platform/mm/memory.c"
+
+// Footprint and fragmentation are sampled every this many events. The time
+// spent sampling is not counted towards the replay.
+#define BENCH_SAMPLE_INTERVAL 4096
+#define BENCH_NO_SLOT         0xFFFFFFFF
+
+//~ Trace preprocessing
+//
+// The trace refers to blocks by their offset into the recorded heap. Before
+// replaying, every block is given a dense slot index so the replay loop is
+// an array lookup rather than a hash lookup.
+
+typedef struct replay_op
+{
+    u32 Op;            // memory_trace_op
+    u32 AlignmentLog2;
+    u32 Slot;          // Block passed in
+    u32 NewSlot;       // Block handed back
+    u64 Size;
+} replay_op;
+
+typedef struct replay_trace
+{
+    replay_op *Ops;
+    u64        OpCount;
+    u32        SlotCount;
+    u64        SkippedCount; // Events referring to blocks the trace never allocated
+} replay_trace;
+
+// Open addressing map from a block offset to its slot
+typedef struct slot_map
+{
+    u64 *Keys; // 0 is empty, a block is never at offset 0
+    u32 *Values;
+    u64  Capacity;
+    u64  Count;
+} slot_map;
+
+file_internal u64 slot_map_hash(u64 Key)
+{
+    Key ^= Key >> 33;
+    Key *= 0xff51afd7ed558ccdULL;
+    Key ^= Key >> 33;
+    return Key;
+}
+
+file_internal void slot_map_init(slot_map *Map, u64 Capacity)
+{
+    Map->Capacity = Capacity;
+    Map->Count    = 0;
+    Map->Keys     = (u64*)calloc(Capacity, sizeof(u64));
+    Map->Values   = (u32*)calloc(Capacity, sizeof(u32));
+}
+
+file_internal void slot_map_free(slot_map *Map)
+{
+    free(Map->Keys);
+    free(Map->Values);
+    memset(Map, 0, sizeof(slot_map));
+}
+
+file_internal void slot_map_insert(slot_map *Map, u64 Key, u32 Value);
+
+file_internal void slot_map_grow(slot_map *Map)
+{
+    slot_map Old = *Map;
+    slot_map_init(Map, Old.Capacity * 2);
+    
+    for (u64 i = 0; i < Old.Capacity; ++i)
+    {
+        if (Old.Keys[i]) slot_map_insert(Map, Old.Keys[i], Old.Values[i]);
+    }
+    
+    slot_map_free(&Old);
+}
+
+file_internal void slot_map_insert(slot_map *Map, u64 Key, u32 Value)
+{
+    if ((Map->Count + 1) * 2 > Map->Capacity) slot_map_grow(Map);
+    
+    u64 Mask = Map->Capacity - 1;
+    u64 i = slot_map_hash(Key) & Mask;
+    while (Map->Keys[i] && Map->Keys[i] != Key) i = (i + 1) & Mask;
+    
+    if (!Map->Keys[i]) Map->Count++;
+    Map->Keys[i]   = Key;
+    Map->Values[i] = Value;
+}
+
+// Returns BENCH_NO_SLOT if the key is not in the map
+file_internal u32 slot_map_remove(slot_map *Map, u64 Key)
+{
+    u64 Mask = Map->Capacity - 1;
+    u64 i = slot_map_hash(Key) & Mask;
+    while (Map->Keys[i] && Map->Keys[i] != Key) i = (i + 1) & Mask;
+    
+    if (!Map->Keys[i]) return BENCH_NO_SLOT;
+    
+    u32 Result = Map->Values[i];
+    Map->Keys[i] = 0;
+    Map->Count--;
+    
+    // Backward shift deletion, so lookups never need tombstones
+    u64 Hole = i;
+    for (u64 j = (i + 1) & Mask; Map->Keys[j]; j = (j + 1) & Mask)
+    {
+        u64 Home = slot_map_hash(Map->Keys[j]) & Mask;
+        if (((j - Home) & Mask) >= ((j - Hole) & Mask))
+        {
+            Map->Keys[Hole]   = Map->Keys[j];
+            Map->Values[Hole] = Map->Values[j];
+            Map->Keys[j]      = 0;
+            Hole = j;
+        }
+    }
+    
+    return Result;
+}
+
+file_internal bool replay_trace_load(replay_trace *Trace, const char *Filename, memory_trace_file_header *Header)
+{
+    FILE *File = fopen(Filename, "rb");
+    if (!File)
+    {
+        printf("Unable to open \"%s\"!\n", Filename);
+        return false;
+    }
+    
+    if (fread(Header, sizeof(memory_trace_file_header), 1, File) != 1 ||
+        Header->Magic != MEMORY_TRACE_MAGIC || Header->Version != MEMORY_TRACE_VERSION)
+    {
+        printf("\"%s\" is not a memory trace!\n", Filename);
+        fclose(File);
+        return false;
+    }
+    
+    memory_trace_event *Events = (memory_trace_event*)malloc(Header->EventCount * sizeof(memory_trace_event));
+    if (fread(Events, sizeof(memory_trace_event), Header->EventCount, File) != Header->EventCount)
+    {
+        printf("\"%s\" is truncated!\n", Filename);
+        free(Events);
+        fclose(File);
+        return false;
+    }
+    fclose(File);
+    
+    Trace->Ops          = (replay_op*)malloc(Header->EventCount * sizeof(replay_op));
+    Trace->OpCount      = 0;
+    Trace->SlotCount    = 0;
+    Trace->SkippedCount = 0;
+    
+    slot_map Map;
+    slot_map_init(&Map, 1 << 16);
+    
+    for (u64 i = 0; i < Header->EventCount; ++i)
+    {
+        memory_trace_event *Event = Events + i;
+        
+        replay_op Op = {0};
+        Op.Op            = Event->Op;
+        Op.AlignmentLog2 = Event->AlignmentLog2;
+        Op.Size          = Event->Size;
+        Op.Slot          = BENCH_NO_SLOT;
+        Op.NewSlot       = BENCH_NO_SLOT;
+        
+        if (Event->Ptr)
+        {
+            Op.Slot = slot_map_remove(&Map, Event->Ptr);
+            if (Op.Slot == BENCH_NO_SLOT)
+            {
+                // Allocated before tracing started, or through a thread cache
+                Trace->SkippedCount++;
+                continue;
+            }
+        }
+        
+        if (Event->Result)
+        {
+            Op.NewSlot = Trace->SlotCount++;
+            slot_map_insert(&Map, Event->Result, Op.NewSlot);
+        }
+        else if (Event->Op != MemoryTraceOp_Release)
+        {
+            // The recorded allocation failed, so there is nothing to replay
+            continue;
+        }
+        
+        Trace->Ops[Trace->OpCount++] = Op;
+    }
+    
+    slot_map_free(&Map);
+    free(Events);
+    
+    return true;
+}
+
+//~ Allocators
+
+typedef struct bench_allocator
+{
+    const char *Name;
+    
+    void  (*init)(u64 HeapSize);
+    void  (*shutdown)(void);
+    
+    void* (*alloc)(u64 Size, u64 Alignment);
+    void* (*realloc)(void *Ptr, u64 Size, u64 Alignment);
+    void  (*release)(void *Ptr, u64 Alignment);
+    
+    u64   (*footprint)(void);     // Bytes currently held from the OS
+    r32   (*fragmentation)(void); // Negative if the allocator cannot tell
+} bench_allocator;
+
+// The engine heap, backed by reserved memory the same way globals_init sets it up
+file_global memory  MapleHeap;
+file_global void   *MapleHeapMemory;
+
+file_internal bool maple_commit(void *Ptr, u64 Size)
+{
+    return VirtualAlloc(Ptr, Size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+file_internal void maple_decommit(void *Ptr, u64 Size)
+{
+    VirtualFree(Ptr, Size, MEM_DECOMMIT);
+}
+
+file_internal void maple_init(u64 HeapSize)
+{
+    MapleHeapMemory = VirtualAlloc(NULL, HeapSize, MEM_RESERVE, PAGE_NOACCESS);
+    memory_init_virtual(&MapleHeap, HeapSize, MapleHeapMemory, maple_commit, maple_decommit);
+}
+
+file_internal void maple_shutdown(void)
+{
+    memory_free(&MapleHeap);
+    VirtualFree(MapleHeapMemory, 0, MEM_RELEASE);
+}
+
+file_internal void* maple_alloc(u64 Size, u64 Alignment)
+{
+    return (Alignment) ? memory_alloc_aligned(&MapleHeap, Size, Alignment) : memory_alloc(&MapleHeap, Size);
+}
+
+file_internal void* maple_realloc(void *Ptr, u64 Size, u64 Alignment)
+{
+    return memory_realloc(&MapleHeap, Ptr, Size);
+}
+
+file_internal void maple_release(void *Ptr, u64 Alignment)
+{
+    memory_release(&MapleHeap, Ptr);
+}
+
+file_internal u64 maple_footprint(void)
+{
+    return MapleHeap.Committed;
+}
+
+file_internal r32 maple_fragmentation(void)
+{
+    memory_report Report;
+    memory_get_report(&MapleHeap, &Report);
+    return Report.Fragmentation;
+}
+
+// The CRT heap. Its footprint is taken from the private bytes of the process.
+file_global u64 SystemBaseline;
+
+file_internal u64 system_private_bytes(void)
+{
+    PROCESS_MEMORY_COUNTERS_EX Counters = {0};
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&Counters, sizeof(Counters));
+    return Counters.PrivateUsage;
+}
+
+file_internal void system_init(u64 HeapSize)
+{
+    SystemBaseline = system_private_bytes();
+}
+
+file_internal void system_shutdown(void)
+{
+}
+
+file_internal void* system_alloc(u64 Size, u64 Alignment)
+{
+    return (Alignment) ? _aligned_malloc(Size, Alignment) : malloc(Size);
+}
+
+file_internal void* system_realloc(void *Ptr, u64 Size, u64 Alignment)
+{
+    return (Alignment) ? _aligned_realloc(Ptr, Size, Alignment) : realloc(Ptr, Size);
+}
+
+file_internal void system_release(void *Ptr, u64 Alignment)
+{
+    if (Alignment) _aligned_free(Ptr);
+    else           free(Ptr);
+}
+
+file_internal u64 system_footprint(void)
+{
+    u64 PrivateBytes = system_private_bytes();
+    return (PrivateBytes > SystemBaseline) ? PrivateBytes - SystemBaseline : 0;
+}
+
+file_internal r32 system_fragmentation(void)
+{
+    return -1.0f;
+}
+
+file_global bench_allocator BenchAllocators[] = {
+    { "maple heap", maple_init,  maple_shutdown,  maple_alloc,  maple_realloc,  maple_release,  maple_footprint,  maple_fragmentation  },
+    { "malloc",     system_init, system_shutdown, system_alloc, system_realloc, system_release, system_footprint, system_fragmentation },
+};
+
+//~ Replay
+
+typedef struct replay_result
+{
+    r64 NsPerOp;
+    u64 PeakLive;
+    u64 PeakFootprint;
+    r32 PeakFragmentation;
+    u64 FailedCount;
+} replay_result;
+
+file_internal void replay_run(replay_trace *Trace, u64 HeapSize, bench_allocator *Allocator,
+                              replay_result *Result, FILE *Csv)
+{
+    // Per slot state. Alignment is kept so the block is resized and released
+    // the same way it was allocated.
+    void **Blocks     = (void**)calloc(Trace->SlotCount, sizeof(void*));
+    u64   *Sizes      = (u64*)calloc(Trace->SlotCount, sizeof(u64));
+    u8    *Alignments = (u8*)calloc(Trace->SlotCount, sizeof(u8));
+    
+    memset(Result, 0, sizeof(replay_result));
+    
+    Allocator->init(HeapSize);
+    
+    LARGE_INTEGER Frequency;
+    QueryPerformanceFrequency(&Frequency);
+    
+    u64 Ticks = 0;
+    u64 Live  = 0;
+    
+    for (u64 Chunk = 0; Chunk < Trace->OpCount; Chunk += BENCH_SAMPLE_INTERVAL)
+    {
+        u64 ChunkEnd = Chunk + BENCH_SAMPLE_INTERVAL;
+        if (ChunkEnd > Trace->OpCount) ChunkEnd = Trace->OpCount;
+        
+        LARGE_INTEGER Start, End;
+        QueryPerformanceCounter(&Start);
+        
+        for (u64 i = Chunk; i < ChunkEnd; ++i)
+        {
+            replay_op *Op = Trace->Ops + i;
+            
+            void *Block = NULL;
+            u64 Alignment = 0;
+            if (Op->Slot != BENCH_NO_SLOT)
+            {
+                Block     = Blocks[Op->Slot];
+                Alignment = (Alignments[Op->Slot]) ? 1ULL << Alignments[Op->Slot] : 0;
+                
+                Live -= Sizes[Op->Slot];
+                Blocks[Op->Slot] = NULL;
+            }
+            
+            switch (Op->Op)
+            {
+                case MemoryTraceOp_Alloc:
+                case MemoryTraceOp_AllocAligned:
+                {
+                    Alignment = (Op->Op == MemoryTraceOp_AllocAligned) ? 1ULL << Op->AlignmentLog2 : 0;
+                    Block = Allocator->alloc(Op->Size, Alignment);
+                } break;
+                
+                case MemoryTraceOp_Realloc:
+                {
+                    Block = (Block) ? Allocator->realloc(Block, Op->Size, Alignment) : Allocator->alloc(Op->Size, 0);
+                } break;
+                
+                case MemoryTraceOp_Release:
+                {
+                    if (Block) Allocator->release(Block, Alignment);
+                    Block = NULL;
+                } break;
+            }
+            
+            if (Op->NewSlot != BENCH_NO_SLOT)
+            {
+                if (!Block)
+                {
+                    Result->FailedCount++;
+                    continue;
+                }
+                
+                // Touch the memory so the cost of a cold block shows up
+                *(u8*)Block = (u8)i;
+                
+                Blocks[Op->NewSlot]     = Block;
+                Sizes[Op->NewSlot]      = Op->Size;
+                Alignments[Op->NewSlot] = (Alignment) ? (u8)memory_ctzl(Alignment) : 0;
+                Live += Op->Size;
+            }
+        }
+        
+        QueryPerformanceCounter(&End);
+        Ticks += End.QuadPart - Start.QuadPart;
+        
+        u64 Footprint     = Allocator->footprint();
+        r32 Fragmentation = Allocator->fragmentation();
+        
+        if (Live > Result->PeakLive)                           Result->PeakLive          = Live;
+        if (Footprint > Result->PeakFootprint)                 Result->PeakFootprint     = Footprint;
+        if (Fragmentation > Result->PeakFragmentation)         Result->PeakFragmentation = Fragmentation;
+        
+        if (Csv)
+        {
+            fprintf(Csv, "%s,%llu,%llu,%llu,%f\n", Allocator->Name, ChunkEnd, Live, Footprint, Fragmentation);
+        }
+    }
+    
+    if (Allocator->fragmentation() < 0.0f) Result->PeakFragmentation = -1.0f;
+    
+    // Blocks that were still live at the end of the trace
+    for (u32 Slot = 0; Slot < Trace->SlotCount; ++Slot)
+    {
+        if (Blocks[Slot])
+        {
+            Allocator->release(Blocks[Slot], (Alignments[Slot]) ? 1ULL << Alignments[Slot] : 0);
+        }
+    }
+    
+    Allocator->shutdown();
+    
+    r64 Seconds = (r64)Ticks / (r64)Frequency.QuadPart;
+    Result->NsPerOp = (Trace->OpCount) ? Seconds * 1000000000.0 / (r64)Trace->OpCount : 0.0;
+    
+    free(Blocks);
+    free(Sizes);
+    free(Alignments);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: maple_alloc_bench <trace file> [samples.csv]\n");
+        return 1;
+    }
+    
+    memory_trace_file_header Header;
+    replay_trace Trace;
+    if (!replay_trace_load(&Trace, argv[1], &Header))
+    {
+        return 1;
+    }
+    
+    printf("%s: %lld events, %lld replayed, %lld skipped, heap of %lldMB\n",
+           argv[1], Header.EventCount, Trace.OpCount, Trace.SkippedCount, Header.HeapSize / _MB(1));
+    if (Header.DroppedCount)
+    {
+        printf("warning: the trace dropped %lld events, the tail of the workload is missing\n", Header.DroppedCount);
+    }
+    printf("\n");
+    
+    FILE *Csv = NULL;
+    if (argc > 2)
+    {
+        Csv = fopen(argv[2], "w");
+        if (Csv) fprintf(Csv, "allocator,event,live_bytes,footprint_bytes,fragmentation\n");
+    }
+    
+    printf("allocator  |    ns/op | peak live (KB) | peak footprint (KB) | overhead | peak fragmentation | failed\n");
+    printf("-----------+----------+----------------+---------------------+----------+--------------------+-------\n");
+    
+    for (u32 i = 0; i < sizeof(BenchAllocators) / sizeof(BenchAllocators[0]); ++i)
+    {
+        bench_allocator *Allocator = BenchAllocators + i;
+        
+        replay_result Result;
+        replay_run(&Trace, Header.HeapSize, Allocator, &Result, Csv);
+        
+        r64 Overhead = (Result.PeakLive) ? (r64)Result.PeakFootprint / (r64)Result.PeakLive : 0.0;
+        
+        printf("%-10s | %8.2f | %14lld | %19lld | %7.2fx | ",
+               Allocator->Name, Result.NsPerOp, Result.PeakLive / 1024, Result.PeakFootprint / 1024, Overhead);
+        if (Result.PeakFragmentation < 0.0f) printf("%18s | ", "n/a");
+        else                                 printf("%18.3f | ", Result.PeakFragmentation);
+        printf("%lld\n", Result.FailedCount);
+    }
+    
+    if (Csv) fclose(Csv);
+    
+    free(Trace.Ops);
+    
+    return 0;
+}
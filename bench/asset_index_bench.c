@@ -0,0 +1,297 @@
+// Asset lookup cost in the asset system: walking the directory tree one path
+// component at a time versus a single probe into the flat path index.
+//
+// Build: build.bat bench
+// Run:   build\maple_asset_index_bench.exe [tree directory]
+//
+// A synthetic tree of 50,000 empty files is created in the tree directory
+// (asset_index_bench by default) the first time it is run, and reused after
+// that. The tree is mounted, and the same random sequence of paths is looked
+// up both ways. Mounting does not list the tree, directories are listed on the
+// first lookup into them, so the mount and the first lookup of every file are
+// timed on their own.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
+#include "../platform/platform/globals.h"
+
+#include "../platform/mm/memory.h"
+#include "../platform/mm/frame_allocator.h"
+#include "../platform/mm/tagged_heap.h"
+#include "../platform/mm/allocator.h"
+
+#define USE_MAPLE_MSTR_IMPLEMENTATION
+#include "../platform/utils/mstr.h"
+
+#define MAPLE_HASH_FUNCTION_IMPLEMENTATION
+#include "../platform/utils/hash_functions.h"
+
+#define MAPLE_STRING_INTERN_IMPLEMENTATION
+#include "../platform/utils/string_intern.h"
+
+#define MAPLE_HASH_MAP_IMPLEMENTATION
+#include "../platform/utils/hash_map.h"
+
+#define USE_MAPLE_DYN_ARRAY_IMPLEMENTATION
+#include "../platform/utils/dyn_array.h"
+
+#define MAPLE_BLOCK_COMPRESS_IMPLEMENTATION
+#include "../platform/utils/block_compress.h"
+
+#include "../platform/platform/win32/assetsys.h"
+#include "../platform/platform/win32/asset_cache.h"
+#include "../platform/platform/mpk.h"
+
+//~ The parts of the platform layer the asset system uses
+
+void mprint(char *Fmt, ...)
+{
+    va_list Args;
+    va_start(Args, Fmt);
+    vprintf(Fmt, Args);
+    va_end(Args);
+}
+
+void mprinte(char *Fmt, ...)
+{
+    va_list Args;
+    va_start(Args, Fmt);
+    vfprintf(stderr, Fmt, Args);
+    va_end(Args);
+}
+
+u32 PlatformCtzl(u64 Value)
+{
+    return (u32)__builtin_ctzll(Value);
+}
+
+mstr Win32GetExeFilepath()
+{
+    return mstr_init(".", 1);
+}
+
+#include "../platform/mm/memory.c"
+#include "../platform/mm/frame_allocator.c"
+#include "../platform/mm/tagged_heap.c"
+#include "../platform/mm/allocator.c"
+#include "../platform/platform/win32/block_decoder_win32.c"
+#include "../platform/platform/win32/assetsys_win32.c"
+#include "../platform/platform/win32/asset_cache_win32.c"
+
+globals *Core;
+
+#define BENCH_HEAP_SIZE     _MB(256)
+#define BENCH_SCRATCH_SIZE  _MB(8)
+#define BENCH_STRINGS       (1 << 16)
+
+// 10 * 10 * 500 = 50,000 files, 110 directories
+#define BENCH_CATEGORIES    10
+#define BENCH_PACKS         10
+#define BENCH_FILES         500
+#define BENCH_FILE_COUNT    (BENCH_CATEGORIES * BENCH_PACKS * BENCH_FILES)
+
+#define BENCH_LOOKUPS       (1 << 20)
+#define BENCH_SCRATCH_RESET 4096 // lookups between scratch frames
+
+file_internal r64 bench_elapsed_ns(LARGE_INTEGER Start, LARGE_INTEGER End, LARGE_INTEGER Frequency)
+{
+    return ((r64)(End.QuadPart - Start.QuadPart) * 1000000000.0) / (r64)Frequency.QuadPart;
+}
+
+file_internal u32 bench_rand(u32 *State)
+{
+    // xorshift32
+    u32 x = *State;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *State = x;
+    return x;
+}
+
+file_internal void bench_path(char *Buffer, u32 BufferLen, u32 Index)
+{
+    u32 File     = Index % BENCH_FILES;
+    u32 Pack     = (Index / BENCH_FILES) % BENCH_PACKS;
+    u32 Category = Index / (BENCH_FILES * BENCH_PACKS);
+    
+    snprintf(Buffer, BufferLen, "category_%02u/pack_%02u/asset_%04u.bin", Category, Pack, File);
+}
+
+// Returns false if the tree could not be created
+file_internal bool bench_create_tree(const char *Root)
+{
+    char Path[MAX_PATH];
+    
+    snprintf(Path, sizeof(Path), "%s/category_%02u/pack_%02u/asset_%04u.bin", Root,
+             BENCH_CATEGORIES - 1, BENCH_PACKS - 1, BENCH_FILES - 1);
+    if (GetFileAttributesA(Path) != INVALID_FILE_ATTRIBUTES) return true;
+    
+    printf("Creating %d files in \"%s\"...\n", BENCH_FILE_COUNT, Root);
+    
+    CreateDirectoryA(Root, NULL);
+    for (u32 Category = 0; Category < BENCH_CATEGORIES; ++Category)
+    {
+        snprintf(Path, sizeof(Path), "%s/category_%02u", Root, Category);
+        CreateDirectoryA(Path, NULL);
+        
+        for (u32 Pack = 0; Pack < BENCH_PACKS; ++Pack)
+        {
+            snprintf(Path, sizeof(Path), "%s/category_%02u/pack_%02u", Root, Category, Pack);
+            CreateDirectoryA(Path, NULL);
+        }
+    }
+    
+    for (u32 i = 0; i < BENCH_FILE_COUNT; ++i)
+    {
+        char Relative[MAX_PATH];
+        bench_path(Relative, sizeof(Relative), i);
+        snprintf(Path, sizeof(Path), "%s/%s", Root, Relative);
+        
+        HANDLE File = CreateFileA(Path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (File == INVALID_HANDLE_VALUE)
+        {
+            printf("Unable to create \"%s\"\n", Path);
+            return false;
+        }
+        CloseHandle(File);
+    }
+    
+    return true;
+}
+
+// The walk a lookup does when the path is not in the index yet
+file_internal assetsys_file_id bench_tree_lookup(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Path)
+{
+    return assetsys_find_fid(AssetSys, Mount->File, Path, (u32)strlen(Path));
+}
+
+int main(int argc, char **argv)
+{
+    const char *Root = (argc > 1) ? argv[1] : "asset_index_bench";
+    if (!bench_create_tree(Root)) return 1;
+    
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    
+    // The engine globals the asset system runs on
+    globals Globals = {0};
+    Core = &Globals;
+    
+    memory Heap = {0};
+    void *HeapMemory = VirtualAlloc(NULL, BENCH_HEAP_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    memory_init(&Heap, BENCH_HEAP_SIZE, HeapMemory);
+    Core->Memory = &Heap;
+    
+    frame_allocator Scratch;
+    frame_allocator_init(&Scratch, BENCH_SCRATCH_SIZE, memory_alloc(&Heap, BENCH_SCRATCH_SIZE));
+    Core->Scratch = &Scratch;
+    
+    string_table Strings;
+    string_table_init(&Strings, &Heap, BENCH_STRINGS);
+    Core->Strings = &Strings;
+    
+    assetsys AssetSys = {0};
+    Core->AssetSys = &AssetSys;
+    assetsys_init(&AssetSys, (char*)Root);
+    
+    QueryPerformanceCounter(&Start);
+    assetsys_mount(&AssetSys, Root, "bench");
+    QueryPerformanceCounter(&End);
+    
+    assetsys_mount_point *Mount = assetsys_get_mount_point(&AssetSys, string_find(&Strings, "bench", 5));
+    if (!Mount)
+    {
+        printf("Unable to mount \"%s\"\n", Root);
+        return 1;
+    }
+    
+    r64 MountNs = bench_elapsed_ns(Start, End, Frequency);
+    
+    // The same random paths for both runs
+    char (*Paths)[64] = malloc(BENCH_FILE_COUNT * sizeof(*Paths));
+    u32 *Order = malloc(BENCH_LOOKUPS * sizeof(u32));
+    
+    for (u32 i = 0; i < BENCH_FILE_COUNT; ++i) bench_path(Paths[i], sizeof(Paths[i]), i);
+    
+    u32 Rand = 0x9E3779B9;
+    for (u32 i = 0; i < BENCH_LOOKUPS; ++i) Order[i] = bench_rand(&Rand) % BENCH_FILE_COUNT;
+    
+    // Directories are listed on the first lookup that walks into them, and
+    // files are indexed on their first lookup, so the first pass over every
+    // file is where the tree is built
+    QueryPerformanceCounter(&Start);
+    for (u32 i = 0; i < BENCH_FILE_COUNT; ++i) assetsys_lookup(&AssetSys, Mount, Paths[i]);
+    QueryPerformanceCounter(&End);
+    
+    hash_map *Index = &AssetSys.PathIndex.Map;
+    u64 IndexBytes = (u64)(Index->GroupMask + 1) * (HASH_MAP_GROUP_SIZE + HASH_MAP_GROUP_SLOTS * Index->EntrySize);
+    
+    printf("Mounted in %.2f ms, first lookup of all %u files in %.1f ms, path index: %u entries, %.1f KB\n\n",
+           MountNs / 1000000.0, BENCH_FILE_COUNT, bench_elapsed_ns(Start, End, Frequency) / 1000000.0,
+           Index->Count, IndexBytes / 1024.0);
+    
+    // Both have to agree before their timings mean anything
+    for (u32 i = 0; i < BENCH_FILE_COUNT; ++i)
+    {
+        assetsys_file_id Walked  = bench_tree_lookup(&AssetSys, Mount, Paths[i]);
+        assetsys_file_id Indexed = assetsys_lookup(&AssetSys, Mount, Paths[i]);
+        
+        if (!assetsys_valid_file_id(Walked) || Walked.Mask != Indexed.Mask)
+        {
+            printf("Lookup mismatch for \"%s\"\n", Paths[i]);
+            return 1;
+        }
+        
+        if (i % BENCH_SCRATCH_RESET == 0) frame_allocator_begin_frame(&Scratch);
+    }
+    
+    printf("lookup      | ns/lookup | scratch bytes/lookup\n");
+    printf("------------+-----------+---------------------\n");
+    
+    for (u32 Run = 0; Run < 2; ++Run)
+    {
+        u64 Sum = 0;
+        u64 ScratchBytes = 0;
+        
+        frame_allocator_begin_frame(&Scratch);
+        QueryPerformanceCounter(&Start);
+        for (u32 i = 0; i < BENCH_LOOKUPS; ++i)
+        {
+            const char *Path = Paths[Order[i]];
+            assetsys_file_id Fid = (Run == 0) ? bench_tree_lookup(&AssetSys, Mount, Path) : assetsys_lookup(&AssetSys, Mount, Path);
+            Sum += Fid.Mask;
+            
+            if ((i + 1) % BENCH_SCRATCH_RESET == 0)
+            {
+                ScratchBytes += (u8*)Scratch.Brkp - (u8*)Scratch.Start - Scratch.FrameIndex * Scratch.FrameSize;
+                frame_allocator_begin_frame(&Scratch);
+            }
+        }
+        QueryPerformanceCounter(&End);
+        
+        printf("%-11s | %9.1f | %20.1f\n", (Run == 0) ? "tree walk" : "path index",
+               bench_elapsed_ns(Start, End, Frequency) / BENCH_LOOKUPS, (r64)ScratchBytes / BENCH_LOOKUPS);
+        
+        // Keep the loop from being optimized out
+        if (Sum == 1) printf(" ");
+    }
+    
+    free(Order);
+    free(Paths);
+    
+    return 0;
+}
@@ -0,0 +1,302 @@
+// Compression ratio and decode throughput of block compressed assets.
+//
+// Build: build.bat bench
+// Run:   build\maple_block_compress_bench.exe [asset directory]
+//
+// Every file under the asset directory (build\data by default) is compressed
+// as a block stream at a few block sizes. For each block size the bench
+// reports the ratio, the compression speed, and decode speed on one thread
+// (block_stream_decode) and through the asset system's block decoder with a
+// growing number of worker threads. Decode speeds are in raw bytes out.
+//
+// The ratio of each file type is reported for the default block size.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
+#define MAPLE_BLOCK_COMPRESS_IMPLEMENTATION
+#include "../platform/utils/block_compress.h"
+
+#define BENCH_MIN_DECODED _MB(256) // raw bytes decoded per timed run
+#define BENCH_MAX_TYPES   32
+
+void mprinte(char *Fmt, ...)
+{
+    va_list Args;
+    va_start(Args, Fmt);
+    vfprintf(stderr, Fmt, Args);
+    va_end(Args);
+}
+
+#include "../platform/platform/win32/block_decoder_win32.c"
+
+typedef struct bench_file
+{
+    char *Type; // extension, "none" without one
+    u8   *Data;
+    u64   Size;
+    
+    u8   *Stream;
+    u64   StreamSize;
+} bench_file;
+
+typedef struct bench_corpus
+{
+    bench_file *Files;
+    u32         Count;
+    u32         Cap;
+    
+    u64         Bytes;
+} bench_corpus;
+
+file_internal r64 bench_elapsed_ns(LARGE_INTEGER Start, LARGE_INTEGER End, LARGE_INTEGER Frequency)
+{
+    return ((r64)(End.QuadPart - Start.QuadPart) * 1000000000.0) / (r64)Frequency.QuadPart;
+}
+
+file_internal void corpus_add_file(bench_corpus *Corpus, const char *Path, const char *Name)
+{
+    FILE *In = fopen(Path, "rb");
+    if (!In) return;
+    
+    fseek(In, 0, SEEK_END);
+    u64 Size = (u64)_ftelli64(In);
+    fseek(In, 0, SEEK_SET);
+    
+    // Nothing to compress
+    if (Size == 0)
+    {
+        fclose(In);
+        return;
+    }
+    
+    u8 *Data = (u8*)malloc(Size);
+    if (fread(Data, 1, Size, In) != Size)
+    {
+        free(Data);
+        fclose(In);
+        return;
+    }
+    fclose(In);
+    
+    if (Corpus->Count == Corpus->Cap)
+    {
+        Corpus->Cap   = (Corpus->Cap) ? Corpus->Cap * 2 : 256;
+        Corpus->Files = (bench_file*)realloc(Corpus->Files, Corpus->Cap * sizeof(bench_file));
+    }
+    
+    const char *Extension = strrchr(Name, '.');
+    Extension = (Extension && Extension[1]) ? Extension + 1 : "none";
+    
+    bench_file *File = Corpus->Files + Corpus->Count++;
+    File->Type       = _strdup(Extension);
+    File->Data       = Data;
+    File->Size       = Size;
+    File->Stream     = NULL;
+    File->StreamSize = 0;
+    
+    Corpus->Bytes += Size;
+}
+
+file_internal void corpus_add_directory(bench_corpus *Corpus, const char *Directory)
+{
+    char Search[MAX_PATH];
+    snprintf(Search, MAX_PATH, "%s/*", Directory);
+    
+    WIN32_FIND_DATAA FindData;
+    HANDLE Handle = FindFirstFileA(Search, &FindData);
+    if (Handle == INVALID_HANDLE_VALUE) return;
+    
+    do
+    {
+        if (strcmp(FindData.cFileName, ".") == 0 || strcmp(FindData.cFileName, "..") == 0) continue;
+        
+        char Path[MAX_PATH];
+        snprintf(Path, MAX_PATH, "%s/%s", Directory, FindData.cFileName);
+        
+        if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) corpus_add_directory(Corpus, Path);
+        else                                                      corpus_add_file(Corpus, Path, FindData.cFileName);
+    } while (FindNextFileA(Handle, &FindData));
+    
+    FindClose(Handle);
+}
+
+// Compresses every file at BlockSize, returns the total stream size
+file_internal u64 bench_compress(bench_corpus *Corpus, u32 BlockSize, r64 *Ns)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    
+    u64 Result = 0;
+    *Ns = 0;
+    
+    for (u32 i = 0; i < Corpus->Count; ++i)
+    {
+        bench_file *File = Corpus->Files + i;
+        
+        u64 Bound = block_stream_bound(File->Size, BlockSize);
+        File->Stream = (u8*)realloc(File->Stream, Bound);
+        
+        QueryPerformanceCounter(&Start);
+        File->StreamSize = block_stream_compress(File->Data, File->Size, BlockSize, File->Stream, Bound);
+        QueryPerformanceCounter(&End);
+        
+        *Ns    += bench_elapsed_ns(Start, End, Frequency);
+        Result += File->StreamSize;
+    }
+    
+    return Result;
+}
+
+// Decodes every file until BENCH_MIN_DECODED bytes are out, on the calling
+// thread when Decoder is NULL. Returns GB/s, or 0 if a file did not decode
+// back to its data.
+file_internal r64 bench_decode(bench_corpus *Corpus, block_decoder *Decoder, u8 *Dst)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    
+    u32 Rounds = (u32)((BENCH_MIN_DECODED + Corpus->Bytes - 1) / Corpus->Bytes);
+    bool Ok = true;
+    
+    QueryPerformanceCounter(&Start);
+    for (u32 r = 0; r < Rounds; ++r)
+    {
+        for (u32 i = 0; i < Corpus->Count; ++i)
+        {
+            bench_file *File = Corpus->Files + i;
+            const block_stream_header *Header = (const block_stream_header*)File->Stream;
+            
+            if (Decoder) Ok &= block_decoder_run(Decoder, File->Stream, 0, Header->BlockCount, Dst);
+            else         Ok &= block_stream_decode(File->Stream, Dst);
+            
+            // Only checked once, the first round is timed like the others
+            if (r == 0) Ok &= (memcmp(Dst, File->Data, File->Size) == 0);
+        }
+    }
+    QueryPerformanceCounter(&End);
+    
+    if (!Ok) return 0;
+    
+    return ((r64)Rounds * Corpus->Bytes) / bench_elapsed_ns(Start, End, Frequency);
+}
+
+file_internal void bench_types(bench_corpus *Corpus)
+{
+    const char *Types[BENCH_MAX_TYPES];
+    u64 Raw[BENCH_MAX_TYPES]    = {0};
+    u64 Stored[BENCH_MAX_TYPES] = {0};
+    u32 Files[BENCH_MAX_TYPES]  = {0};
+    u32 TypeCount = 0;
+    
+    for (u32 i = 0; i < Corpus->Count; ++i)
+    {
+        bench_file *File = Corpus->Files + i;
+        
+        u32 Type = 0;
+        while (Type < TypeCount && strcmp(Types[Type], File->Type) != 0) ++Type;
+        
+        // Everything past the last slot is counted as "other"
+        if (Type == TypeCount)
+        {
+            if (TypeCount == BENCH_MAX_TYPES) Type = BENCH_MAX_TYPES - 1;
+            else                              Types[TypeCount++] = File->Type;
+            if (TypeCount == BENCH_MAX_TYPES) Types[BENCH_MAX_TYPES - 1] = "other";
+        }
+        
+        Raw[Type]    += File->Size;
+        Stored[Type] += File->StreamSize;
+        Files[Type]  += 1;
+    }
+    
+    printf("type     | files  | MB       | ratio\n");
+    printf("---------+--------+----------+--------\n");
+    for (u32 i = 0; i < TypeCount; ++i)
+    {
+        printf("%-8.8s | %6u | %8.2f | %5.1f%%\n", Types[i], Files[i], Raw[i] / (1024.0 * 1024.0),
+               100.0 * (r64)Stored[i] / (r64)Raw[i]);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *AssetDirectory = (argc > 1) ? argv[1] : "data";
+    
+    bench_corpus Corpus = {0};
+    corpus_add_directory(&Corpus, AssetDirectory);
+    
+    if (Corpus.Count == 0)
+    {
+        printf("No files in \"%s\"\n", AssetDirectory);
+        return 1;
+    }
+    
+    printf("assets in \"%s\": %u files, %.2f MB\n\n", AssetDirectory, Corpus.Count, Corpus.Bytes / (1024.0 * 1024.0));
+    
+    u64 Largest = 0;
+    for (u32 i = 0; i < Corpus.Count; ++i)
+    {
+        if (Corpus.Files[i].Size > Largest) Largest = Corpus.Files[i].Size;
+    }
+    u8 *Dst = (u8*)malloc(Largest);
+    
+    // Decoders with 1, 2, 4... workers, up to one per core besides the
+    // calling thread
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+    
+    u32 MaxThreads = (SystemInfo.dwNumberOfProcessors > 1) ? SystemInfo.dwNumberOfProcessors - 1 : 0;
+    if (MaxThreads > BLOCK_DECODER_MAX_THREADS) MaxThreads = BLOCK_DECODER_MAX_THREADS;
+    
+    block_decoder Decoders[4];
+    u32 DecoderCount = 0;
+    for (u32 Threads = 1; Threads < MaxThreads; Threads *= 2)
+    {
+        block_decoder_init(Decoders + DecoderCount++, Threads);
+    }
+    block_decoder_init(Decoders + DecoderCount++, MaxThreads);
+    
+    printf("block  | ratio  | compress MB/s | decode GB/s, 1 thread");
+    for (u32 d = 0; d < DecoderCount; ++d) printf(" | %u+1 threads", Decoders[d].ThreadCount);
+    printf("\n-------+--------+---------------+----------------------");
+    for (u32 d = 0; d < DecoderCount; ++d) printf("-+------------");
+    printf("\n");
+    
+    r64 CompressNs;
+    u32 BlockSizes[] = { _KB(64), _KB(128), _KB(256) };
+    for (u32 b = 0; b < sizeof(BlockSizes) / sizeof(BlockSizes[0]); ++b)
+    {
+        u64 Stored = bench_compress(&Corpus, BlockSizes[b], &CompressNs);
+        
+        printf("%3uKB  | %5.1f%% | %13.0f | %21.2f", BlockSizes[b] / 1024, 100.0 * (r64)Stored / (r64)Corpus.Bytes,
+               (r64)Corpus.Bytes / CompressNs * 1000.0, bench_decode(&Corpus, NULL, Dst));
+        
+        for (u32 d = 0; d < DecoderCount; ++d)
+        {
+            printf(" | %11.2f", bench_decode(&Corpus, Decoders + d, Dst));
+        }
+        printf("\n");
+    }
+    printf("\n");
+    
+    bench_compress(&Corpus, BLOCK_STREAM_DEFAULT_BLOCK, &CompressNs);
+    printf("ratio by type, %uKB blocks\n", (u32)(BLOCK_STREAM_DEFAULT_BLOCK / 1024));
+    bench_types(&Corpus);
+    
+    for (u32 d = 0; d < DecoderCount; ++d) block_decoder_free(Decoders + d);
+    
+    return 0;
+}
@@ -0,0 +1,357 @@
+// Throughput and collision rates of the engine hashes on asset paths.
+//
+// MurmurHash3 (hash_bytes) is what the asset system used for every path
+// component, FNV-1a is what the string table used, and hash64 replaces both.
+//
+// Build: build.bat bench
+// Run:   build\maple_hash_bench.exe [asset directory]
+//
+// The corpus is every file path under the asset directory (build\data by
+// default) plus each of its path components. A generated corpus that follows
+// the engine's asset naming is added so the collision counts have enough
+// keys to mean something.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_HASH_FUNCTION_IMPLEMENTATION
+#include "../platform/utils/hash_functions.h"
+
+#define BENCH_GENERATED_COUNT (1 << 20)
+#define BENCH_MIN_HASHED      _MB(256) // bytes hashed per timed run
+#define BENCH_LONG_SIZE       _MB(1)
+
+typedef struct corpus
+{
+    char **Keys;
+    u32   *Lens;
+    u32    Count;
+    u32    Cap;
+    
+    u64    Bytes;
+} corpus;
+
+typedef u64 (*bench_hash_fn)(const void *Key, u64 Len);
+
+typedef struct bench_hash
+{
+    const char    *Name;
+    bench_hash_fn  Fn;
+} bench_hash;
+
+file_internal u64 bench_murmur3(const void *Key, u64 Len)
+{
+    u128 Hash = hash_bytes((void*)Key, (u32)Len);
+    return (u64)Hash.Upper ^ (u64)Hash.Lower;
+}
+
+file_internal u64 bench_fnv1a(const void *Key, u64 Len)
+{
+    const u8 *P = (const u8*)Key;
+    u64 Hash = 0xCBF29CE484222325ULL;
+    for (u64 i = 0; i < Len; ++i)
+    {
+        Hash ^= P[i];
+        Hash *= 0x100000001B3ULL;
+    }
+    return Hash;
+}
+
+file_internal r64 bench_elapsed_ns(LARGE_INTEGER Start, LARGE_INTEGER End, LARGE_INTEGER Frequency)
+{
+    return ((r64)(End.QuadPart - Start.QuadPart) * 1000000000.0) / (r64)Frequency.QuadPart;
+}
+
+file_internal void corpus_add(corpus *Corpus, const char *Key, u32 Len)
+{
+    if (Corpus->Count == Corpus->Cap)
+    {
+        Corpus->Cap  = (Corpus->Cap) ? Corpus->Cap * 2 : 1024;
+        Corpus->Keys = (char**)realloc(Corpus->Keys, Corpus->Cap * sizeof(char*));
+        Corpus->Lens = (u32*)realloc(Corpus->Lens, Corpus->Cap * sizeof(u32));
+    }
+    
+    char *Copy = (char*)malloc(Len + 1);
+    memcpy(Copy, Key, Len);
+    Copy[Len] = 0;
+    
+    Corpus->Keys[Corpus->Count] = Copy;
+    Corpus->Lens[Corpus->Count] = Len;
+    Corpus->Count++;
+    Corpus->Bytes += Len;
+}
+
+// Adds the path relative to the asset directory, and every component of it
+file_internal void corpus_add_path(corpus *Corpus, const char *Path)
+{
+    u32 Len = (u32)strlen(Path);
+    corpus_add(Corpus, Path, Len);
+    
+    const char *Start = Path;
+    for (const char *Iter = Path;; ++Iter)
+    {
+        if (*Iter == '/' || *Iter == 0)
+        {
+            if (Iter > Start) corpus_add(Corpus, Start, (u32)(Iter - Start));
+            if (*Iter == 0) break;
+            Start = Iter + 1;
+        }
+    }
+}
+
+file_internal void corpus_add_directory(corpus *Corpus, const char *Root, const char *Relative)
+{
+    char Search[MAX_PATH];
+    if (Relative[0]) snprintf(Search, MAX_PATH, "%s/%s/*", Root, Relative);
+    else             snprintf(Search, MAX_PATH, "%s/*", Root);
+    
+    WIN32_FIND_DATAA FindData;
+    HANDLE Handle = FindFirstFileA(Search, &FindData);
+    if (Handle == INVALID_HANDLE_VALUE) return;
+    
+    do
+    {
+        if (strcmp(FindData.cFileName, ".") == 0 || strcmp(FindData.cFileName, "..") == 0) continue;
+        
+        char Path[MAX_PATH];
+        if (Relative[0]) snprintf(Path, MAX_PATH, "%s/%s", Relative, FindData.cFileName);
+        else             snprintf(Path, MAX_PATH, "%s", FindData.cFileName);
+        
+        if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            corpus_add_directory(Corpus, Root, Path);
+        }
+        else
+        {
+            corpus_add_path(Corpus, Path);
+        }
+    } while (FindNextFileA(Handle, &FindData));
+    
+    FindClose(Handle);
+}
+
+// Paths shaped like the ones the engine loads: a few directories, long
+// shared prefixes and names that only differ in a counter.
+file_internal void corpus_generate(corpus *Corpus, u32 Count)
+{
+    const char *Formats[] = {
+        "data/models/binaries/mesh_%05u_lod%u.bin",
+        "data/textures/terrain/tile_%03u_%03u_albedo.png",
+        "data/materials/material_%u_v%u.mat",
+        "shaders/permutations/shader_%05u_%u.spv",
+    };
+    
+    char Path[256];
+    for (u32 i = 0; i < Count; ++i)
+    {
+        u32 Format = i & 3;
+        u32 Id     = i >> 2;
+        
+        u32 Len;
+        if (Format == 1) Len = snprintf(Path, sizeof(Path), Formats[Format], Id >> 8, Id & 0xFF);
+        else             Len = snprintf(Path, sizeof(Path), Formats[Format], Id >> 2, Id & 3);
+        
+        corpus_add(Corpus, Path, Len);
+    }
+}
+
+file_internal int corpus_compare_keys(const void *Left, const void *Right)
+{
+    return strcmp(*(const char**)Left, *(const char**)Right);
+}
+
+// Collisions only count between different strings
+file_internal void corpus_dedup(corpus *Corpus)
+{
+    qsort(Corpus->Keys, Corpus->Count, sizeof(char*), corpus_compare_keys);
+    
+    u32 Count = 0;
+    Corpus->Bytes = 0;
+    for (u32 i = 0; i < Corpus->Count; ++i)
+    {
+        if (Count > 0 && strcmp(Corpus->Keys[Count - 1], Corpus->Keys[i]) == 0)
+        {
+            free(Corpus->Keys[i]);
+            continue;
+        }
+        
+        Corpus->Keys[Count] = Corpus->Keys[i];
+        Corpus->Lens[Count] = (u32)strlen(Corpus->Keys[i]);
+        Corpus->Bytes += Corpus->Lens[Count];
+        Count++;
+    }
+    Corpus->Count = Count;
+}
+
+file_internal void corpus_free(corpus *Corpus)
+{
+    for (u32 i = 0; i < Corpus->Count; ++i) free(Corpus->Keys[i]);
+    free(Corpus->Keys);
+    free(Corpus->Lens);
+    memset(Corpus, 0, sizeof(corpus));
+}
+
+file_internal int bench_compare_u64(const void *Left, const void *Right)
+{
+    u64 L = *(const u64*)Left;
+    u64 R = *(const u64*)Right;
+    return (L > R) - (L < R);
+}
+
+file_internal u64 bench_count_duplicates(u64 *Values, u32 Count)
+{
+    qsort(Values, Count, sizeof(u64), bench_compare_u64);
+    
+    u64 Result = 0;
+    for (u32 i = 1; i < Count; ++i) Result += (Values[i] == Values[i - 1]);
+    return Result;
+}
+
+file_internal void bench_corpus(const char *Name, corpus *Corpus, bench_hash *Hashes, u32 HashCount)
+{
+    if (Corpus->Count == 0)
+    {
+        printf("%s: empty\n\n", Name);
+        return;
+    }
+    
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    
+    u32 Rounds = (u32)(BENCH_MIN_HASHED / (Corpus->Bytes + 1)) + 1;
+    
+    // A power of two table at 50% load, like the string table
+    u32 BucketCount = 1;
+    while (BucketCount < 2 * Corpus->Count) BucketCount <<= 1;
+    u8 *Buckets = (u8*)malloc(BucketCount);
+    
+    u64 *Values = (u64*)malloc(Corpus->Count * sizeof(u64));
+    
+    r64 ExpectedUsed   = BucketCount * (1.0 - exp(-(r64)Corpus->Count / BucketCount));
+    r64 Expected32     = ((r64)Corpus->Count * (r64)(Corpus->Count - 1)) / (2.0 * 4294967296.0);
+    
+    printf("%s: %u keys, %.1f bytes on average, %u buckets\n", Name, Corpus->Count,
+           (r64)Corpus->Bytes / Corpus->Count, BucketCount);
+    printf("hash        | ns/key | GB/s  | 64-bit coll | 32-bit coll (expected %.1f) | buckets used vs ideal\n", Expected32);
+    printf("------------+--------+-------+-------------+-----------------------------+----------------------\n");
+    
+    for (u32 h = 0; h < HashCount; ++h)
+    {
+        bench_hash_fn Fn = Hashes[h].Fn;
+        
+        u64 Sum = 0;
+        QueryPerformanceCounter(&Start);
+        for (u32 Round = 0; Round < Rounds; ++Round)
+        {
+            for (u32 i = 0; i < Corpus->Count; ++i) Sum += Fn(Corpus->Keys[i], Corpus->Lens[i]);
+        }
+        QueryPerformanceCounter(&End);
+        
+        r64 Ns = bench_elapsed_ns(Start, End, Frequency);
+        r64 NsPerKey = Ns / ((r64)Rounds * Corpus->Count);
+        r64 GBs = ((r64)Rounds * Corpus->Bytes) / Ns;
+        
+        for (u32 i = 0; i < Corpus->Count; ++i) Values[i] = Fn(Corpus->Keys[i], Corpus->Lens[i]);
+        
+        memset(Buckets, 0, BucketCount);
+        u32 Used = 0;
+        for (u32 i = 0; i < Corpus->Count; ++i)
+        {
+            u32 Bucket = (u32)Values[i] & (BucketCount - 1);
+            Used += !Buckets[Bucket];
+            Buckets[Bucket] = 1;
+        }
+        
+        u64 Collisions64 = bench_count_duplicates(Values, Corpus->Count);
+        
+        for (u32 i = 0; i < Corpus->Count; ++i)
+        {
+            u64 Value = Fn(Corpus->Keys[i], Corpus->Lens[i]);
+            Values[i] = (u32)(Value ^ (Value >> 32));
+        }
+        u64 Collisions32 = bench_count_duplicates(Values, Corpus->Count);
+        
+        printf("%-11s | %6.2f | %5.2f | %11lld | %27lld | %6.2f%%\n", Hashes[h].Name, NsPerKey, GBs,
+               Collisions64, Collisions32, 100.0 * Used / ExpectedUsed);
+        
+        // Keep the loops from being optimized out
+        if (Sum == 1) printf(" ");
+    }
+    printf("\n");
+    
+    free(Values);
+    free(Buckets);
+}
+
+file_internal void bench_long(bench_hash *Hashes, u32 HashCount)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    
+    u8 *Buffer = (u8*)malloc(BENCH_LONG_SIZE);
+    for (u32 i = 0; i < BENCH_LONG_SIZE; ++i) Buffer[i] = (u8)(i * 2654435761U >> 24);
+    
+    u32 Rounds = (u32)(BENCH_MIN_HASHED / BENCH_LONG_SIZE);
+    
+    printf("long input: %lldKB\n", BENCH_LONG_SIZE / 1024);
+    printf("hash        | GB/s\n");
+    printf("------------+-------\n");
+    for (u32 h = 0; h < HashCount; ++h)
+    {
+        u64 Sum = 0;
+        QueryPerformanceCounter(&Start);
+        for (u32 Round = 0; Round < Rounds; ++Round)
+        {
+            Buffer[0] = (u8)Round;
+            Sum += Hashes[h].Fn(Buffer, BENCH_LONG_SIZE);
+        }
+        QueryPerformanceCounter(&End);
+        
+        r64 Ns = bench_elapsed_ns(Start, End, Frequency);
+        printf("%-11s | %5.2f\n", Hashes[h].Name, ((r64)Rounds * BENCH_LONG_SIZE) / Ns);
+        
+        if (Sum == 1) printf(" ");
+    }
+    
+    free(Buffer);
+}
+
+int main(int argc, char **argv)
+{
+    const char *AssetDirectory = (argc > 1) ? argv[1] : "data";
+    
+    bench_hash Hashes[] = {
+        { "murmur3_128", bench_murmur3 },
+        { "fnv1a_64",    bench_fnv1a   },
+        { "hash64",      hash64        },
+    };
+    u32 HashCount = sizeof(Hashes) / sizeof(Hashes[0]);
+    
+    corpus Assets = {0};
+    corpus_add_directory(&Assets, AssetDirectory, "");
+    corpus_dedup(&Assets);
+    
+    char Name[MAX_PATH + 16];
+    snprintf(Name, sizeof(Name), "assets in \"%s\"", AssetDirectory);
+    bench_corpus(Name, &Assets, Hashes, HashCount);
+    corpus_free(&Assets);
+    
+    corpus Generated = {0};
+    corpus_generate(&Generated, BENCH_GENERATED_COUNT);
+    corpus_dedup(&Generated);
+    bench_corpus("generated asset paths", &Generated, Hashes, HashCount);
+    corpus_free(&Generated);
+    
+    bench_long(Hashes, HashCount);
+    
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Allocation throughput of the engine heap when shared across threads, once
+// going straight to the locked heap and once through per-thread caches.
+//
+// Build: build.bat bench
+// Run:   build\maple_memory_bench.exe
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
+#include "../platform/mm/memory.h"
+#include "../platform/mm/memory.c"
+
+#define BENCH_HEAP_SIZE       _MB(512)
+#define BENCH_MAX_THREADS     16
+#define BENCH_OPS_PER_THREAD  2000000
+#define BENCH_LIVE_COUNT      1024   // allocations each thread keeps alive
+#define BENCH_MIN_SIZE        16
+#define BENCH_MAX_SIZE        256
+
+typedef struct bench_thread
+{
+    memory *Heap;
+    bool    UseCache;
+    u32     Seed;
+    HANDLE  StartEvent;
+} bench_thread;
+
+file_internal u32 bench_rand(u32 *State)
+{
+    // xorshift32
+    u32 x = *State;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *State = x;
+    return x;
+}
+
+file_internal DWORD WINAPI bench_thread_proc(LPVOID Param)
+{
+    bench_thread *Thread = (bench_thread*)Param;
+    
+    memory_cache Cache;
+    memory_cache_init(&Cache, Thread->Heap);
+    
+    void *Live[BENCH_LIVE_COUNT] = {0};
+    u32 Rand = Thread->Seed;
+    
+    WaitForSingleObject(Thread->StartEvent, INFINITE);
+    
+    for (u32 Op = 0; Op < BENCH_OPS_PER_THREAD; ++Op)
+    {
+        u32 Slot = bench_rand(&Rand) % BENCH_LIVE_COUNT;
+        if (Live[Slot])
+        {
+            if (Thread->UseCache) memory_cache_release(&Cache, Live[Slot]);
+            else                  memory_release(Thread->Heap, Live[Slot]);
+            Live[Slot] = NULL;
+        }
+        else
+        {
+            u32 Size = BENCH_MIN_SIZE + bench_rand(&Rand) % (BENCH_MAX_SIZE - BENCH_MIN_SIZE);
+            if (Thread->UseCache) Live[Slot] = memory_cache_alloc(&Cache, Size);
+            else                  Live[Slot] = memory_alloc(Thread->Heap, Size);
+            
+            // Touch the memory so the cost of a cold block shows up
+            if (Live[Slot]) *(u32*)Live[Slot] = Op;
+        }
+    }
+    
+    for (u32 Slot = 0; Slot < BENCH_LIVE_COUNT; ++Slot)
+    {
+        if (Thread->UseCache) memory_cache_release(&Cache, Live[Slot]);
+        else                  memory_release(Thread->Heap, Live[Slot]);
+    }
+    
+    memory_cache_flush(&Cache);
+    
+    return 0;
+}
+
+// Returns millions of operations per second across all threads
+file_internal r64 bench_run(memory *Heap, u32 ThreadCount, bool UseCache)
+{
+    bench_thread Threads[BENCH_MAX_THREADS];
+    HANDLE       Handles[BENCH_MAX_THREADS];
+    
+    HANDLE StartEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    
+    for (u32 i = 0; i < ThreadCount; ++i)
+    {
+        Threads[i].Heap       = Heap;
+        Threads[i].UseCache   = UseCache;
+        Threads[i].Seed       = 0x9E3779B9 * (i + 1);
+        Threads[i].StartEvent = StartEvent;
+        
+        Handles[i] = CreateThread(NULL, 0, bench_thread_proc, Threads + i, 0, NULL);
+    }
+    
+    // Give every thread a chance to reach the start line
+    Sleep(50);
+    
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    
+    SetEvent(StartEvent);
+    WaitForMultipleObjects(ThreadCount, Handles, TRUE, INFINITE);
+    
+    QueryPerformanceCounter(&End);
+    
+    for (u32 i = 0; i < ThreadCount; ++i)
+    {
+        CloseHandle(Handles[i]);
+    }
+    CloseHandle(StartEvent);
+    
+    r64 Seconds = (r64)(End.QuadPart - Start.QuadPart) / (r64)Frequency.QuadPart;
+    return ((r64)ThreadCount * BENCH_OPS_PER_THREAD) / Seconds / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+    void *HeapMemory = VirtualAlloc(NULL, BENCH_HEAP_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!HeapMemory)
+    {
+        printf("Unable to allocate the benchmark heap!\n");
+        return 1;
+    }
+    
+    memory Heap = {0};
+    memory_init(&Heap, BENCH_HEAP_SIZE, HeapMemory);
+    
+    printf("%d ops per thread, %d live allocations per thread, sizes %d-%d bytes\n\n",
+           BENCH_OPS_PER_THREAD, BENCH_LIVE_COUNT, BENCH_MIN_SIZE, BENCH_MAX_SIZE);
+    printf("threads | locked heap (Mops/s) | thread cache (Mops/s) | speedup\n");
+    printf("--------+----------------------+-----------------------+--------\n");
+    
+    for (u32 ThreadCount = 1; ThreadCount <= BENCH_MAX_THREADS; ThreadCount *= 2)
+    {
+        r64 Locked = bench_run(&Heap, ThreadCount, false);
+        r64 Cached = bench_run(&Heap, ThreadCount, true);
+        
+        printf("%7d | %20.2f | %21.2f | %6.2fx\n", ThreadCount, Locked, Cached, Cached / Locked);
+    }
+    
+    memory_free(&Heap);
+    VirtualFree(HeapMemory, 0, MEM_RELEASE);
+    
+    return 0;
+}
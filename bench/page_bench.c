@@ -0,0 +1,217 @@
+// Random access over a fragmented engine heap, once backed by regular pages
+// and once by large pages, to show what the TLB costs the heap during asset
+// decode and command recording style workloads.
+//
+// Build: build.bat bench
+// Run:   build\maple_page_bench.exe
+//
+// Large pages need the "Lock pages in memory" right (SeLockMemoryPrivilege)
+// and enough contiguous physical memory. The large page run is skipped if
+// either is missing.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
+#include "../platform/mm/memory.h"
+#include "../platform/mm/memory.c"
+
+#define BENCH_HEAP_SIZE     _MB(512)
+#define BENCH_BLOCK_COUNT   (1 << 20) // live blocks once the heap is built
+#define BENCH_CHURN_COUNT   (1 << 21) // allocs and releases made while building
+#define BENCH_MIN_SIZE      16
+#define BENCH_MAX_SIZE      512
+#define BENCH_ACCESS_COUNT  (1 << 24)
+
+typedef struct bench_result
+{
+    r64 AllocNs;   // per alloc/release while building the heap
+    r64 ChaseNs;   // per dependent load hopping between blocks
+    r64 TouchNs;   // per independent read/modify/write of a random block
+} bench_result;
+
+file_internal u32 bench_rand(u32 *State)
+{
+    // xorshift32
+    u32 x = *State;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *State = x;
+    return x;
+}
+
+file_internal r64 bench_elapsed_ns(LARGE_INTEGER Start, LARGE_INTEGER End, LARGE_INTEGER Frequency, u64 Count)
+{
+    return ((r64)(End.QuadPart - Start.QuadPart) * 1000000000.0) / (r64)Frequency.QuadPart / (r64)Count;
+}
+
+// Same as Win32EnableLockMemoryPrivilege in the platform layer
+file_internal bool bench_enable_large_pages(void)
+{
+    HANDLE Token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES|TOKEN_QUERY, &Token))
+    {
+        return false;
+    }
+    
+    TOKEN_PRIVILEGES Privileges = {0};
+    Privileges.PrivilegeCount           = 1;
+    Privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    
+    bool Result = false;
+    if (LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &Privileges.Privileges[0].Luid))
+    {
+        AdjustTokenPrivileges(Token, FALSE, &Privileges, 0, NULL, NULL);
+        Result = (GetLastError() == ERROR_SUCCESS);
+    }
+    
+    CloseHandle(Token);
+    return Result;
+}
+
+file_internal void bench_run(void *HeapMemory, void **Blocks, bench_result *Result)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    QueryPerformanceFrequency(&Frequency);
+    
+    // Fault every page in first so the regular page run does not pay for
+    // demand paging inside the timed sections.
+    memset(HeapMemory, 0, BENCH_HEAP_SIZE);
+    
+    memory Heap = {0};
+    memory_init(&Heap, BENCH_HEAP_SIZE, HeapMemory);
+    
+    memset(Blocks, 0, BENCH_BLOCK_COUNT * sizeof(void*));
+    
+    // Build a heap the way a long session does: lots of churn, so that blocks
+    // that are next to each other in the table end up far apart in memory.
+    u32 Rand = 0x9E3779B9;
+    
+    QueryPerformanceCounter(&Start);
+    for (u32 Op = 0; Op < BENCH_CHURN_COUNT; ++Op)
+    {
+        u32 Slot = bench_rand(&Rand) % BENCH_BLOCK_COUNT;
+        if (Blocks[Slot]) memory_release(&Heap, Blocks[Slot]);
+        
+        u32 Size = BENCH_MIN_SIZE + bench_rand(&Rand) % (BENCH_MAX_SIZE - BENCH_MIN_SIZE);
+        Blocks[Slot] = memory_alloc(&Heap, Size);
+    }
+    QueryPerformanceCounter(&End);
+    Result->AllocNs = bench_elapsed_ns(Start, End, Frequency, 2 * BENCH_CHURN_COUNT);
+    
+    for (u32 Slot = 0; Slot < BENCH_BLOCK_COUNT; ++Slot)
+    {
+        if (!Blocks[Slot]) Blocks[Slot] = memory_alloc(&Heap, BENCH_MIN_SIZE);
+    }
+    
+    // Link the blocks into a single random cycle. Every hop depends on the
+    // last load, so the time per hop is dominated by cache and TLB misses.
+    for (u32 Slot = 0; Slot < BENCH_BLOCK_COUNT - 1; ++Slot)
+    {
+        u32 Other = Slot + bench_rand(&Rand) % (BENCH_BLOCK_COUNT - Slot);
+        void *Temp = Blocks[Slot];
+        Blocks[Slot]  = Blocks[Other];
+        Blocks[Other] = Temp;
+    }
+    for (u32 Slot = 0; Slot < BENCH_BLOCK_COUNT; ++Slot)
+    {
+        *(void**)Blocks[Slot] = Blocks[(Slot + 1) % BENCH_BLOCK_COUNT];
+    }
+    
+    void *Cursor = Blocks[0];
+    QueryPerformanceCounter(&Start);
+    for (u32 Hop = 0; Hop < BENCH_ACCESS_COUNT; ++Hop)
+    {
+        Cursor = *(void**)Cursor;
+    }
+    QueryPerformanceCounter(&End);
+    Result->ChaseNs = bench_elapsed_ns(Start, End, Frequency, BENCH_ACCESS_COUNT);
+    
+    // Independent accesses, so the core can overlap misses
+    u64 Sum = (u64)Cursor;
+    QueryPerformanceCounter(&Start);
+    for (u32 Access = 0; Access < BENCH_ACCESS_COUNT; ++Access)
+    {
+        u64 *Block = (u64*)Blocks[bench_rand(&Rand) % BENCH_BLOCK_COUNT];
+        Sum += Block[1]++;
+    }
+    QueryPerformanceCounter(&End);
+    Result->TouchNs = bench_elapsed_ns(Start, End, Frequency, BENCH_ACCESS_COUNT);
+    
+    // Keep the loops from being optimized out
+    if (Sum == 1) printf(" ");
+    
+    for (u32 Slot = 0; Slot < BENCH_BLOCK_COUNT; ++Slot)
+    {
+        memory_release(&Heap, Blocks[Slot]);
+    }
+    memory_free(&Heap);
+}
+
+file_internal void bench_print(const char *Name, u64 PageSize, bench_result *Result, bench_result *Baseline)
+{
+    printf("%-13s | %6lldKB | %13.2f | %12.2f | %12.2f | %5.2fx\n",
+           Name, PageSize / 1024, Result->AllocNs, Result->ChaseNs, Result->TouchNs,
+           Baseline->ChaseNs / Result->ChaseNs);
+}
+
+int main(int argc, char **argv)
+{
+    void **Blocks = (void**)malloc(BENCH_BLOCK_COUNT * sizeof(void*));
+    
+    SYSTEM_INFO SysInfo;
+    GetSystemInfo(&SysInfo);
+    
+    printf("%lldMB heap, %d live blocks of %d-%d bytes, %d accesses\n\n",
+           BENCH_HEAP_SIZE / (1024 * 1024), BENCH_BLOCK_COUNT, BENCH_MIN_SIZE, BENCH_MAX_SIZE, BENCH_ACCESS_COUNT);
+    printf("pages         | size     | alloc (ns/op) | chase (ns)   | touch (ns)   | speedup\n");
+    printf("--------------+----------+---------------+--------------+--------------+--------\n");
+    
+    bench_result Regular = {0};
+    void *RegularMemory = VirtualAlloc(NULL, BENCH_HEAP_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+    if (!RegularMemory)
+    {
+        printf("Unable to allocate the benchmark heap!\n");
+        return 1;
+    }
+    
+    bench_run(RegularMemory, Blocks, &Regular);
+    bench_print("regular", SysInfo.dwPageSize, &Regular, &Regular);
+    VirtualFree(RegularMemory, 0, MEM_RELEASE);
+    
+    u64 LargePageSize = bench_enable_large_pages() ? (u64)GetLargePageMinimum() : 0;
+    if (!LargePageSize)
+    {
+        printf("large         | skipped, \"Lock pages in memory\" is not granted to this user\n");
+    }
+    else
+    {
+        void *LargeMemory = VirtualAlloc(NULL, BENCH_HEAP_SIZE, MEM_COMMIT|MEM_RESERVE|MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (!LargeMemory)
+        {
+            printf("large         | skipped, not enough contiguous physical memory (error %ld)\n", GetLastError());
+        }
+        else
+        {
+            bench_result Large = {0};
+            bench_run(LargeMemory, Blocks, &Large);
+            bench_print("large", LargePageSize, &Large, &Regular);
+            VirtualFree(LargeMemory, 0, MEM_RELEASE);
+        }
+    }
+    
+    free(Blocks);
+    
+    return 0;
+}
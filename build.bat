@@ -11,7 +11,7 @@ set HOST_DIR=%HOST_DIR:~0,-1%
 :: Flags for Platform
 SET MP_CFLAGS=-std=c99 -g -D_DEBUG -Wno-microsoft-include
 SET MP_INC=
-SET MP_LIB=-llibcpmtd.lib -luser32.lib -lGdi32.lib -lwinmm.lib
+SET MP_LIB=-llibcpmtd.lib -luser32.lib -lGdi32.lib -lwinmm.lib -ladvapi32.lib
 SET MP_INPUT=%HOST_DIR%\platform\engine_unity.c
 SET MP_OUTPUT=maple.exe
 SET MP_DEFS=-DVK_NO_PROTOTYPES
@@ -34,6 +34,10 @@ SET GM_OUTPUT=maple_game.dll
 SET GM_EXPORTS=
 SET GM_DEFS=-DGAME_DLL_EXPORT
 
+:: Flags for the Benchmarks
+SET BN_CFLAGS=-std=c99 -O2 -Wno-microsoft-include
+SET BN_LIB=-luser32.lib -lwinmm.lib -lpsapi.lib -ladvapi32.lib
+
 IF NOT EXIST build\data\terrain\ (
     1>NUL MKDIR build\data\terrain\
 )
@@ -77,6 +81,40 @@ IF "%1" == "vk" (
     EXIT /B %ERRORLEVEL%
 )
 
+IF "%1" == "bench" (
+    pushd build\
+        echo Building maple benchmarks...
+        clang %BN_CFLAGS% %HOST_DIR%\bench\memory_bench.c -omaple_memory_bench.exe %BN_LIB%
+        clang %BN_CFLAGS% %HOST_DIR%\bench\alloc_bench.c -omaple_alloc_bench.exe %BN_LIB%
+        clang %BN_CFLAGS% %HOST_DIR%\bench\page_bench.c -omaple_page_bench.exe %BN_LIB%
+        clang %BN_CFLAGS% %HOST_DIR%\bench\hash_bench.c -omaple_hash_bench.exe %BN_LIB%
+        clang %BN_CFLAGS% %HOST_DIR%\bench\asset_index_bench.c -omaple_asset_index_bench.exe %BN_LIB%
+        clang %BN_CFLAGS% %HOST_DIR%\bench\block_compress_bench.c -omaple_block_compress_bench.exe %BN_LIB%
+    popd
+    EXIT /B %ERRORLEVEL%
+)
+
+IF "%1" == "tools" (
+    pushd build\
+        echo Building maple tools...
+        clang %BN_CFLAGS% %HOST_DIR%\tools\mpk_builder.c -omaple_mpk.exe %BN_LIB%
+    popd
+    EXIT /B %ERRORLEVEL%
+)
+
+:: Engine, graphics and game built with allocation tracing. memory.c is compiled
+:: into all three, so they have to agree on MAPLE_MEMORY_TRACE. The trace is
+:: written to memory_trace.bin on shutdown.
+IF "%1" == "trace" (
+    pushd build\
+        echo Building maple with allocation tracing...
+        clang %MP_CFLAGS% %MP_DEFS% -DMAPLE_MEMORY_TRACE %MP_INC% %MP_INPUT% -o%MP_OUTPUT% %MP_LIB%
+        cl %VK_DEFS% /DMAPLE_MEMORY_TRACE %VK_CFLAGS% %VK_INC% %VK_INPUT% /LD %VK_OUTPUT% /link %VK_LIB% %VK_EXPORTS%
+        clang %GM_CFLAGS% %GM_DEFS% -DMAPLE_MEMORY_TRACE %GM_INC% %GM_INPUT% -shared -o%GM_OUTPUT% %GM_LIB%
+    popd
+    EXIT /B %ERRORLEVEL%
+)
+
 IF "%1" == "mp" (
     pushd build\
         echo Building maple engine...
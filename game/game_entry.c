@@ -2,6 +2,20 @@
  graphics_api *Graphics;
 platform     *Platform;
 
+// The engine code compiled into the dll logs through mprinte, which only the
+// platform exe has
+void mprinte(char *Fmt, ...)
+{
+    char Buffer[1024];
+    
+    va_list Args;
+    va_start(Args, Fmt);
+    vsnprintf(Buffer, sizeof(Buffer), Fmt, Args);
+    va_end(Args);
+    
+    Platform->mprinte("%s", Buffer);
+}
+
 file_internal void rotate_camera_about_x(camera *Camera, r32 angle)
 {
     vec3 haxis = vec3_norm(vec3_cross(Camera->WorldUp, Camera->Front));
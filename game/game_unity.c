@@ -9,6 +9,9 @@
 
 #include "../platform/utils/maple_types.h"
 
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
 #define MAPLE_VECTOR_MATH_IMPLEMENTATION
 #include "../platform/utils/vector_math.h"
 #include "../platform/utils/camera.h"
@@ -18,6 +21,8 @@
 //~ Platform and Graphics headers
 
 #include "../platform/platform/win32/assetsys.h"
+#include "../platform/platform/win32/async_io.h"
+#include "../platform/platform/win32/asset_cache.h"
 #include "../platform/platform/platform.h"
 // TODO(Dustin): Remove Vulkan header...
 #include "../graphics/vulkan/vulkan.h"
@@ -26,7 +31,11 @@
 #include "../platform/frame_params/frame_params.h"
 
 #include "../platform/mm/memory.h"
+#include "../platform/mm/frame_allocator.h"
+#include "../platform/mm/tagged_heap.h"
 #include "../platform/mm/memory.c"
+#include "../platform/mm/frame_allocator.c"
+#include "../platform/mm/tagged_heap.c"
 
 //~ Game Source
 
@@ -20,7 +20,7 @@ file_internal void mp_dynamic_uniform_buffer_init(mp_dynamic_uniform_buffer *Buf
     alloc_info.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
     alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
     
-    Buffer->Handles = (buffer_parameters*)memory_alloc(Core->Memory, sizeof(buffer_parameters) * SwapChainImageCount);
+    Buffer->Handles = (buffer_parameters*)memory_alloc_tagged(Core->Memory, sizeof(buffer_parameters) * SwapChainImageCount, MemoryTag_Renderer);
     for (u32 i = 0; i < SwapChainImageCount; ++i)
     {
         Core->VkCore.CreateVmaBuffer(create_info,
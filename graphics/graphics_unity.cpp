@@ -22,9 +22,15 @@
 #define MAPLE_VECTOR_MATH_IMPLEMENTATION
 
 #include "../platform/utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "../platform/utils/atomics.h"
+
 #include "vulkan/vulkan.h"
 
 #include "../platform/platform/win32/assetsys.h"
+#include "../platform/platform/win32/async_io.h"
+#include "../platform/platform/win32/asset_cache.h"
 #include "../platform/platform/platform.h"
 #include "platform.h"
 
@@ -60,17 +66,31 @@ HMODULE VulkanLibrary;
 
 typedef struct 
 {
-    struct memory          *Memory;
-    struct renderer        *Renderer;
-    vulkan_core             VkCore;
+    struct memory             *Memory;
+    struct frame_allocator    *Scratch; // owned by the platform
+    struct renderer           *Renderer;
+    struct mp_resource_pools  *ResourcePools;
+    struct stack_allocator    *LoadStack; // Resource creation, temporaries are rewound per resource
+    vulkan_core                VkCore;
 } globals;
 
 extern globals *Core;
 
 #include "../platform/mm/memory.h"
+#include "../platform/mm/frame_allocator.h"
+#include "../platform/mm/tagged_heap.h"
+#include "../platform/mm/pool_allocator.h"
+#include "../platform/mm/stack_allocator.h"
+#include "../platform/mm/allocator.h"
 #include "mm.h"
 #include "../platform/utils/stb_ds.h"
 #include "../platform/utils/mstr.h"
+#define MAPLE_HASH_FUNCTION_IMPLEMENTATION
+#include "../platform/utils/hash_functions.h"
+#define MAPLE_HASH_MAP_IMPLEMENTATION
+#include "../platform/utils/hash_map.h"
+#define USE_MAPLE_DYN_ARRAY_IMPLEMENTATION
+#include "../platform/utils/dyn_array.h"
 #include "../platform/utils/vector_math.h" 
 
 #include "dynamic_uniform_buffer.h"
@@ -83,6 +103,11 @@ extern globals *Core;
 //-------------------------------------------------
 
 #include "../platform/mm/memory.c"
+#include "../platform/mm/frame_allocator.c"
+#include "../platform/mm/tagged_heap.c"
+#include "../platform/mm/pool_allocator.c"
+#include "../platform/mm/stack_allocator.c"
+#include "../platform/mm/allocator.c"
 
 #include "vulkan_functions.cpp"
 #include "maple_vk.cpp"
@@ -47,6 +47,10 @@ file_internal void DisplayError(LPTSTR lpszFunction)
     LocalFree(lpDisplayBuf);
 }
 
+file_global tag_block PlatformHeap;
+// Messages are printed from worker threads too, the block is only touched under this
+file_global spin_lock  PlatformHeapLock;
+
 // An internal allocation scheme that allocates from the 2MB Platform Linear allcoator.
 // this functions is primarily used by print/formatting functions that need temporary,
 // dynamic memory. When the heap is filled, the allocator is reset.
@@ -54,25 +58,23 @@ file_internal void* PlatformLocalAlloc(u32 Size)
 {
     void* Result = NULL;
     
-#if 0
-    if (!PlatformHeap.Start)
-        PlatformHeap = TaggedHeapRequestAllocation(&Core->TaggedHeap, PlatformTag);
+    spin_lock_acquire(&PlatformHeapLock);
+    
+    if (!PlatformHeap.Heap)
+    {
+        tag_block_init(&PlatformHeap, Platform->TaggedHeap, TaggedHeapTag_Platform);
+    }
     
-    Result = TaggedHeapBlockAlloc(&PlatformHeap, Size);
-    if (!Result)
+    // Rewind rather than requesting another block, messages are consumed right away
+    if (PlatformHeap.Start &&
+        (char*)PlatformHeap.Brkp + Size + TAGGED_HEAP_ALIGNMENT > (char*)PlatformHeap.Start + TAGGED_HEAP_BLOCK_SIZE)
     {
         PlatformHeap.Brkp = PlatformHeap.Start;
-        
-        Result = TaggedHeapBlockAlloc(&PlatformHeap, Size);
-        if (!Result)
-            Platform->mprinte("Error allocating from Platform Heap Allocator!\n");
     }
-#else
     
-    // TODO(Dustin): Temporary fix for not having a tagged heap/string right now
-    Result = malloc(Size);
+    Result = tag_block_alloc(&PlatformHeap, Size);
     
-#endif
+    spin_lock_release(&PlatformHeapLock);
     
     return Result;
 }
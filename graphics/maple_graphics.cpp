@@ -3,6 +3,19 @@
 
 globals *Core;
 
+// The shared utils log through mprinte, which only the platform exe has
+inline void mprinte(char *Fmt, ...)
+{
+    char Buffer[1024];
+    
+    va_list Args;
+    va_start(Args, Fmt);
+    vsnprintf(Buffer, sizeof(Buffer), Fmt, Args);
+    va_end(Args);
+    
+    Platform->mprinte("%s", Buffer);
+}
+
 typedef enum cmd_type
 {
     CmdType_BeginFrame,
@@ -141,14 +154,61 @@ typedef struct mp_image
     
 } mp_image;
 
+// Capacities of the resource pools. Handles are allocated from fixed size
+// pools so they are contiguous in memory and creation/destruction is O(1).
+#define MAX_PIPELINES          64
+#define MAX_RENDER_COMPONENTS  4096
+#define MAX_UPLOAD_BUFFERS     1024
+#define MAX_IMAGES             256
+#define MAX_DESCRIPTOR_SETS    256
+
+typedef struct mp_resource_pools
+{
+    pool_allocator Pipelines;
+    pool_allocator RenderComponents;
+    pool_allocator UploadBuffers;
+    pool_allocator Images;
+    pool_allocator DescriptorSets;
+} mp_resource_pools;
+
+file_internal void mp_resource_pool_init(pool_allocator *Pool, u64 ElementSize, u32 Capacity)
+{
+    u64 PoolSize = pool_allocator_size(ElementSize, Capacity, true);
+    pool_allocator_init(Pool, ElementSize, Capacity, true, memory_alloc_tagged(Core->Memory, PoolSize, MemoryTag_Renderer));
+}
+
+file_internal void mp_resource_pool_free(pool_allocator *Pool)
+{
+    memory_release(Core->Memory, Pool->Start);
+    pool_allocator_free(Pool);
+}
+
+void mp_resource_pools_init(mp_resource_pools *Pools)
+{
+    mp_resource_pool_init(&Pools->Pipelines,        sizeof(mp_pipeline),         MAX_PIPELINES);
+    mp_resource_pool_init(&Pools->RenderComponents, sizeof(mp_render_component), MAX_RENDER_COMPONENTS);
+    mp_resource_pool_init(&Pools->UploadBuffers,    sizeof(mp_upload_buffer),    MAX_UPLOAD_BUFFERS);
+    mp_resource_pool_init(&Pools->Images,           sizeof(mp_image),            MAX_IMAGES);
+    mp_resource_pool_init(&Pools->DescriptorSets,   sizeof(mp_descriptor_set),   MAX_DESCRIPTOR_SETS);
+}
+
+void mp_resource_pools_free(mp_resource_pools *Pools)
+{
+    mp_resource_pool_free(&Pools->DescriptorSets);
+    mp_resource_pool_free(&Pools->Images);
+    mp_resource_pool_free(&Pools->UploadBuffers);
+    mp_resource_pool_free(&Pools->RenderComponents);
+    mp_resource_pool_free(&Pools->Pipelines);
+}
+
 void mp_command_pool_init(command_pool *CommandPool)
 {
     u64 InitialMemory = _64KB;
     u64 StartingCommandListSize = _KB(1) * sizeof(command_list_cmd);
     
-    command_pool pCommandPool = (command_pool)memory_alloc(Core->Memory, sizeof(mp_command_pool));
+    command_pool pCommandPool = (command_pool)memory_alloc_tagged(Core->Memory, sizeof(mp_command_pool), MemoryTag_CommandPool);
     pCommandPool->LastCommandListSize = StartingCommandListSize;
-    pCommandPool->Ptr = memory_alloc(Core->Memory, InitialMemory);
+    pCommandPool->Ptr = memory_alloc_tagged(Core->Memory, InitialMemory, MemoryTag_CommandPool);
     memory_init(&pCommandPool->Pool, InitialMemory, pCommandPool->Ptr);
     
     pCommandPool->Handle = Core->VkCore.CreateCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
@@ -169,16 +229,16 @@ void mp_command_pool_free(command_pool *CommandPool)
 
 void mp_command_list_init(command_list *CommandList, command_pool CommandPool)
 {
-    command_list pCommandList  = (command_list)memory_alloc(&CommandPool->Pool, sizeof(mp_command_list));
+    command_list pCommandList  = (command_list)memory_alloc_tagged(&CommandPool->Pool, sizeof(mp_command_list), MemoryTag_CommandPool);
     pCommandList->AttachedPool = CommandPool;
-    pCommandList->Start        = (char*)memory_alloc(&pCommandList->AttachedPool->Pool, CommandPool->LastCommandListSize);
+    pCommandList->Start        = (char*)memory_alloc_tagged(&pCommandList->AttachedPool->Pool, CommandPool->LastCommandListSize, MemoryTag_CommandPool);
     pCommandList->End          = (char*)pCommandList->Start + CommandPool->LastCommandListSize;
     pCommandList->Offset       = (char*)pCommandList->Start;
     pCommandList->IsActive     = false;
     pCommandList->CommandCount = 0;
     
     pCommandList->CommandListCount = Core->VkCore.GetSwapChainImageCount();
-    pCommandList->Handles = (VkCommandBuffer*)memory_alloc(Core->Memory, pCommandList->CommandListCount);
+    pCommandList->Handles = (VkCommandBuffer*)memory_alloc_tagged(Core->Memory, sizeof(VkCommandBuffer) * pCommandList->CommandListCount, MemoryTag_CommandPool);
     Core->VkCore.CreateCommandBuffers(pCommandList->AttachedPool->Handle,
                                       VK_COMMAND_BUFFER_LEVEL_PRIMARY,
                                       pCommandList->CommandListCount,
@@ -392,19 +452,29 @@ INITIALIZE_GRAPHICS(initialize_graphics)
 {
     Platform = CreateInfo->Platform;
     
-    u32 MemorySize = _1MB;
+    u64 MemorySize = _1GB;
     
-    // Initialize memory
-    void *PlatformMemory = Platform->request_memory(MemorySize);
+    // Initialize memory. The range is only reserved, pages are committed
+    // by the heap as it grows.
+    void *PlatformMemory = Platform->reserve_memory(MemorySize);
     
     memory Memory = {0};
-    memory_init(&Memory, MemorySize, PlatformMemory);
+    memory_init_virtual(&Memory, MemorySize, PlatformMemory,
+                        Platform->commit_memory, Platform->decommit_memory);
     
     memory *pMemory = (memory*)memory_alloc(&Memory, sizeof(memory));
     *pMemory = Memory;
     
     Core = (globals*)memory_alloc(pMemory, sizeof(globals));
-    Core->Memory = pMemory;
+    Core->Memory  = pMemory;
+    Core->Scratch = Platform->Scratch;
+    
+    Core->ResourcePools = palloc<mp_resource_pools>();
+    mp_resource_pools_init(Core->ResourcePools);
+    
+    // Only holds the temporaries of the resource being created, so it stays small
+    Core->LoadStack = palloc<stack_allocator>();
+    stack_allocator_init(Core->LoadStack, _1MB, palloc<char>(_1MB));
     
     // Initialize Vulkan
     Platform->mprint("Initializing Vulkan...\n");
@@ -425,11 +495,19 @@ SHUTDOWN_GRAPHICS(shutdown_graphics)
     
     Core->VkCore.Shutdown();
     
+    pfree(Core->LoadStack->Start);
+    stack_allocator_free(Core->LoadStack);
+    pfree(Core->LoadStack);
+    
+    mp_resource_pools_free(Core->ResourcePools);
+    pfree(Core->ResourcePools);
+    
     memory Memory = *Core->Memory;
     void *MemoryPtr = Memory.Start;;
     
     memory_release(&Memory, Core->Memory);
-    Core->Memory = NULL;
+    Core->Memory  = NULL;
+    Core->Scratch = NULL;
     
     memory_release(&Memory, Core);
     Core = NULL;
@@ -521,85 +599,73 @@ FREE_COMMAND_POOL(free_command_pool)
     mp_command_pool_free(CommandPool);
 }
 
-file_internal void LoadShader(char *ShaderFileName,
+// Returns false if the shader could not be read, no module is created then
+file_internal bool LoadShader(char *ShaderFileName,
                               VkShaderStageFlagBits ShaderStage,
                               VkShaderModule &ShaderModule,
                               VkPipelineShaderStageCreateInfo &ShaderStageInfo)
 {
-    void *ShaderBuffer = NULL;
-    u64 BufferSize;
+    // SPIR-V comes from the asset cache, so pipelines sharing a stage only
+    // read it once. Cached files are page aligned, or 16 byte aligned in a
+    // pack, which meets the 4 byte alignment the code needs.
+    cached_file ShaderFile = Platform->acquire_file(ShaderFileName, "shaders");
     
-    BufferSize = Platform->file_get_fsize(ShaderFileName, "shaders");
-    ShaderBuffer = memory_alloc(Core->Memory, BufferSize);
+    ShaderModule    = VK_NULL_HANDLE;
+    ShaderStageInfo = {};
     
-    Platform->load_file(ShaderFileName, true, "shaders", ShaderBuffer, BufferSize);
+    if (!ShaderFile.Data)
+    {
+        Platform->mprinte("Unable to load shader \"%s\"!\n", ShaderFileName);
+        Platform->release_file(&ShaderFile);
+        return false;
+    }
     
-    ShaderModule = Core->VkCore.CreateShaderModule((u32*)ShaderBuffer, BufferSize);
+    ShaderModule = Core->VkCore.CreateShaderModule((const u32*)ShaderFile.Data, ShaderFile.Size);
+    
+    Platform->release_file(&ShaderFile);
     
-    ShaderStageInfo = {};
     ShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     ShaderStageInfo.stage  = ShaderStage;
     ShaderStageInfo.module = ShaderModule;
     ShaderStageInfo.pName  = "main";
     
-    memory_release(Core->Memory, ShaderBuffer);
+    return true;
 }
 
 CREATE_PIPELINE(create_pipeline) 
 {
-    pipeline pPipeline = (pipeline)memory_alloc(Core->Memory, sizeof(mp_pipeline));
+    pipeline pPipeline = (pipeline)pool_alloc(&Core->ResourcePools->Pipelines);
     
     VkShaderModule ShaderModules[5];
     VkPipelineShaderStageCreateInfo ShaderStages[5];
     u32 ShaderStageCount = 0;
     
-    // Load Vertex Shader
-    if (PipelineInfo->VertexShader)
-    {
-        LoadShader(PipelineInfo->VertexShader,
-                   VK_SHADER_STAGE_VERTEX_BIT ,
-                   ShaderModules[ShaderStageCount],
-                   ShaderStages[ShaderStageCount]);
-        ShaderStageCount++;
-    }
-    
-    // Load Fragment Shader
-    if (PipelineInfo->FragmentShader)
-    {
-        LoadShader(PipelineInfo->FragmentShader,
-                   VK_SHADER_STAGE_FRAGMENT_BIT ,
-                   ShaderModules[ShaderStageCount],
-                   ShaderStages[ShaderStageCount]);
-        ShaderStageCount++;
-    }
-    
-    // Load Geometry Shader
-    if (PipelineInfo->GeometryShader)
-    {
-        LoadShader(PipelineInfo->GeometryShader,
-                   VK_SHADER_STAGE_GEOMETRY_BIT ,
-                   ShaderModules[ShaderStageCount],
-                   ShaderStages[ShaderStageCount]);
-        ShaderStageCount++;
-    }
-    
-    // Load Tess Control Shader
-    if (PipelineInfo->TessControlShader)
-    {
-        LoadShader(PipelineInfo->TessControlShader,
-                   VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
-                   ShaderModules[ShaderStageCount],
-                   ShaderStages[ShaderStageCount]);
-        ShaderStageCount++;
-    }
+    struct { char *File; VkShaderStageFlagBits Stage; } Shaders[] = {
+        { PipelineInfo->VertexShader,      VK_SHADER_STAGE_VERTEX_BIT                  },
+        { PipelineInfo->FragmentShader,    VK_SHADER_STAGE_FRAGMENT_BIT                },
+        { PipelineInfo->GeometryShader,    VK_SHADER_STAGE_GEOMETRY_BIT                },
+        { PipelineInfo->TessControlShader, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT    },
+        { PipelineInfo->TessEvalShader,    VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT },
+    };
     
-    // Load Tess Eval Shader
-    if (PipelineInfo->TessEvalShader)
+    for (u32 i = 0; i < sizeof(Shaders)/sizeof(Shaders[0]); ++i)
     {
-        LoadShader(PipelineInfo->TessEvalShader,
-                   VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
-                   ShaderModules[ShaderStageCount],
-                   ShaderStages[ShaderStageCount]);
+        if (!Shaders[i].File) continue;
+        
+        if (!LoadShader(Shaders[i].File, Shaders[i].Stage,
+                        ShaderModules[ShaderStageCount], ShaderStages[ShaderStageCount]))
+        {
+            // A pipeline missing a stage is not the pipeline that was asked for
+            for (u32 Shader = 0; Shader < ShaderStageCount; Shader++)
+            {
+                Core->VkCore.DestroyShaderModule(ShaderModules[Shader]);
+            }
+            
+            pool_release(&Core->ResourcePools->Pipelines, pPipeline);
+            *Pipeline = NULL;
+            return;
+        }
+        
         ShaderStageCount++;
     }
     
@@ -687,12 +753,13 @@ CREATE_PIPELINE(create_pipeline)
     VkPipelineLayoutCreateInfo PipelineLayoutInfo = {};
     PipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     
+    stack_marker LoadMarker = stack_get_marker(Core->LoadStack, StackSide_Top);
+    
     // The descriptors...needs to append descriptors the renderer handles internally.
     // 1. GlobalShaderData DescriptorLayout
     // 2. ObjectDataBuffer DescriptorLayout
     u32 LayoutCount = PipelineInfo->DescriptorLayoutsCount + 2;
-    VkDescriptorSetLayout *Layouts = (VkDescriptorSetLayout*)memory_alloc(Core->Memory, 
-                                                                          LayoutCount * sizeof(VkDescriptorSetLayout));
+    VkDescriptorSetLayout *Layouts = talloc<VkDescriptorSetLayout>(Core->LoadStack, LayoutCount);
     Layouts[0] = Core->Renderer->GlobalShaderData.DescriptorLayout;
     Layouts[1] = Core->Renderer->ObjectDataBuffer.DescriptorLayout;
     
@@ -708,6 +775,8 @@ CREATE_PIPELINE(create_pipeline)
     
     pPipeline->Layout = Core->VkCore.CreatePipelineLayout(PipelineLayoutInfo);
     
+    stack_free_to_marker(Core->LoadStack, LoadMarker);
+    
     // create the pipeline
     VkGraphicsPipelineCreateInfo PipelineCreateInfo = {};
     PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -769,11 +838,13 @@ CREATE_PIPELINE(create_pipeline)
     //~ Create the Normal Visualization Pipeline
     if (0) {
         // HACK(Dustin): Assume only Vertex and Fragment
-        LoadShader("data/shaders/normal_vis.geom.spv",
-                   VK_SHADER_STAGE_GEOMETRY_BIT,
-                   ShaderModules[2],
-                   ShaderStages[2]);
-        ShaderStageCount++;
+        if (LoadShader("data/shaders/normal_vis.geom.spv",
+                       VK_SHADER_STAGE_GEOMETRY_BIT,
+                       ShaderModules[2],
+                       ShaderStages[2]))
+        {
+            ShaderStageCount++;
+        }
         
         Rasterizer = {};
         Rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -812,8 +883,6 @@ CREATE_PIPELINE(create_pipeline)
         Core->VkCore.DestroyShaderModule(ShaderModules[Shader]);
     }
     
-    memory_release(Core->Memory, Layouts);
-    
     *Pipeline = pPipeline;
 }
 
@@ -824,13 +893,13 @@ FREE_PIPELINE(free_pipeline)
     Core->VkCore.DestroyPipeline((*Pipeline)->Wireframe);
     Core->VkCore.DestroyPipeline((*Pipeline)->NormalVis);
     
-    memory_release(Core->Memory, (*Pipeline));
+    pool_release(&Core->ResourcePools->Pipelines, (*Pipeline));
     *Pipeline = NULL;
 }
 
 CREATE_RENDER_COMPONENT(create_render_component)
 {
-    render_component Result = (render_component)memory_alloc(Core->Memory, sizeof(mp_render_component));
+    render_component Result = (render_component)pool_alloc(&Core->ResourcePools->RenderComponents);
     
     VkBufferCreateInfo VertexBufferInfo = {};
     VertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -905,7 +974,7 @@ FREE_RENDER_COMPONENT(free_render_component)
     Core->VkCore.DestroyVmaBuffer((*RenderComponent)->IndexBuffer.Handle,
                                   (*RenderComponent)->IndexBuffer.Memory);
     
-    memory_release(Core->Memory, *RenderComponent);
+    pool_release(&Core->ResourcePools->RenderComponents, *RenderComponent);
     *RenderComponent = NULL;
 }
 
@@ -918,7 +987,7 @@ SET_RENDER_COMPONENT_INFO(set_render_component_info)
 
 CREATE_UPLOAD_BUFFER(create_upload_buffer)
 {
-    upload_buffer Result = (upload_buffer)memory_alloc(Core->Memory, sizeof(mp_upload_buffer));
+    upload_buffer Result = (upload_buffer)pool_alloc(&Core->ResourcePools->UploadBuffers);
     
     Result->Type = BufferType;
     Result->Size = BufferSize;
@@ -1082,7 +1151,7 @@ FREE_UPLOAD_BUFFER(free_upload_buffer)
     Core->VkCore.DestroyVmaBuffer((*Buffer)->Handle, 
                                   (*Buffer)->Allocation);
     
-    memory_release(Core->Memory, *Buffer);
+    pool_release(&Core->ResourcePools->UploadBuffers, *Buffer);
     *Buffer = NULL;
 }
 
@@ -1120,7 +1189,7 @@ GET_UPLOAD_BUFFER_INFO(get_upload_buffer_info)
 
 CREATE_IMAGE(create_image)
 {
-    image Result = (image)memory_alloc(Core->Memory, sizeof(mp_image));
+    image Result = (image)pool_alloc(&Core->ResourcePools->Images);
     
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -1263,7 +1332,7 @@ FREE_IMAGE(free_image)
     Core->VkCore.DestroyImageView((*Image)->View);
     Core->VkCore.DestroyVmaImage((*Image)->Handle, (*Image)->Memory);
     
-    memory_release(Core->Memory, (*Image));
+    pool_release(&Core->ResourcePools->Images, (*Image));
     (*Image) = NULL;
 }
 
@@ -1321,7 +1390,7 @@ GET_IMAGE_DIMENSIONS(get_image_dimensions)
 
 CREATE_DESCRIPTOR_SET_LAYOUT(create_descriptor_set_layout)
 {
-    descriptor_layout Result = (descriptor_layout)memory_alloc(Core->Memory, sizeof(mp_descriptor_layout));
+    descriptor_layout Result = (descriptor_layout)memory_alloc_tagged(Core->Memory, sizeof(mp_descriptor_layout), MemoryTag_Renderer);
     
     Result->Handle = Core->VkCore.CreateDescriptorSetLayout(LayoutInfo->Bindings, 
                                                             LayoutInfo->BindingsCount);
@@ -1338,13 +1407,14 @@ FREE_DESCRIPTOR_SET_LAYOUT(free_descriptor_set_layout)
 
 CREATE_DESCRIPTOR_SET(create_descriptor_set) 
 {
-    descriptor_set Result = (descriptor_set)memory_alloc(Core->Memory, sizeof(mp_descriptor_set));
+    descriptor_set Result = (descriptor_set)pool_alloc(&Core->ResourcePools->DescriptorSets);
     
     u32 SwapChainImageCount = Core->VkCore.GetSwapChainImageCount();
     Result->HandleCount = SwapChainImageCount;
     
-    VkDescriptorSetLayout *Layouts = (VkDescriptorSetLayout*)memory_alloc(Core->Memory, 
-                                                                          sizeof(VkDescriptorSetLayout) * SwapChainImageCount);
+    stack_marker LoadMarker = stack_get_marker(Core->LoadStack, StackSide_Top);
+    
+    VkDescriptorSetLayout *Layouts = talloc<VkDescriptorSetLayout>(Core->LoadStack, SwapChainImageCount);
     for (u32 LayoutIdx = 0; LayoutIdx < SwapChainImageCount; ++LayoutIdx)
         Layouts[LayoutIdx] = SetInfo->Layout->Handle;
     
@@ -1354,13 +1424,13 @@ CREATE_DESCRIPTOR_SET(create_descriptor_set)
     AllocInfo.descriptorSetCount = SwapChainImageCount;
     AllocInfo.pSetLayouts        = Layouts;
     
-    Result->Handles = (VkDescriptorSet*)memory_alloc(Core->Memory, 
-                                                     sizeof(VkDescriptorSet) * SwapChainImageCount);
+    Result->Handles = (VkDescriptorSet*)memory_alloc_tagged(Core->Memory, 
+                                                            sizeof(VkDescriptorSet) * SwapChainImageCount, MemoryTag_Renderer);
     
     Core->VkCore.CreateDescriptorSets(Result->Handles,
                                       AllocInfo);
     
-    memory_release(Core->Memory, Layouts);
+    stack_free_to_marker(Core->LoadStack, LoadMarker);
     
     Result->Binding = SetInfo->Binding;
     Result->Set     = SetInfo->Set;
@@ -1371,7 +1441,7 @@ CREATE_DESCRIPTOR_SET(create_descriptor_set)
 FREE_DESCRIPTOR_SET(free_descriptor_set) 
 {
     memory_release(Core->Memory, (*Set)->Handles);
-    memory_release(Core->Memory, (*Set));
+    pool_release(&Core->ResourcePools->DescriptorSets, (*Set));
     (*Set) = NULL;
 }
 
@@ -267,6 +267,7 @@ extern "C"
 #define EXECUTE_COMMAND_LIST(fn) EXTERN_GRAPHICS_API void fn(command_list CommandList)
     typedef void (GRAPHICS_CALL *PFN_execute_command_list)(command_list CommandList);
     
+    // Pipeline is set to NULL if one of the shaders can not be loaded
 #define CREATE_PIPELINE(fn) EXTERN_GRAPHICS_API void fn(pipeline_create_info *PipelineInfo, pipeline *Pipeline)
     typedef void (GRAPHICS_CALL *PFN_create_pipeline)(pipeline_create_info *PipelineInfo, pipeline *Pipeline);
     
@@ -1,16 +1,18 @@
 #ifndef MAPLE_MM_H
 #define MAPLE_MM_H
 
+// Honours alignof(T), so types like camera_data (alignas(16)) can be used with
+// aligned SIMD loads. Types with ordinary alignment take the regular path.
 template<typename T>
 T* palloc(memory *Allocator, u32 NumElements = 1)
 {
-    return (T*)memory_alloc(Allocator, sizeof(T) * NumElements);
+    return (T*)memory_alloc_aligned_tagged(Allocator, sizeof(T) * NumElements, alignof(T), MemoryTag_Renderer);
 }
 
 template<typename T>
 T* palloc(u32 NumElements = 1)
 {
-    return (T*)memory_alloc(Core->Memory, sizeof(T) * NumElements);
+    return (T*)memory_alloc_aligned_tagged(Core->Memory, sizeof(T) * NumElements, alignof(T), MemoryTag_Renderer);
 }
 
 template<typename T>
@@ -26,12 +28,41 @@ void pfree(T *Ptr)
     memory_release(Core->Memory, (void*)Ptr);
 }
 
-#if 0
+// Allocations from a double ended stack. palloc takes long lived memory from the
+// bottom, talloc takes temporaries from the top. Neither is freed on its own,
+// a side is rewound to a marker with stack_free_to_marker.
 template<typename T>
-T* halloc(tag_block_t Allocator, u64 Size)
+T* palloc(stack_allocator *Allocator, u64 NumElements = 1)
 {
-    return (T*)TaggedHeapBlockAlloc(Allocator, sizeof(T) * Size);
+    return (T*)stack_alloc(Allocator, sizeof(T) * NumElements, StackSide_Bottom);
+}
+
+template<typename T>
+T* talloc(stack_allocator *Allocator, u64 NumElements = 1)
+{
+    return (T*)stack_alloc(Allocator, sizeof(T) * NumElements, StackSide_Top);
+}
+
+// Transient allocations from the per-frame scratch memory. These are never
+// freed, the memory is reclaimed when the frame comes back around.
+template<typename T>
+T* talloc(frame_allocator *Allocator, u64 NumElements = 1)
+{
+    return (T*)frame_alloc(Allocator, sizeof(T) * NumElements);
+}
+
+template<typename T>
+T* talloc(u64 NumElements = 1)
+{
+    return (T*)frame_alloc(Core->Scratch, sizeof(T) * NumElements);
+}
+
+// Allocations from a tag_block. These are never freed, the memory is reclaimed
+// when the tag of the block is released.
+template<typename T>
+T* halloc(tag_block *Allocator, u64 NumElements = 1)
+{
+    return (T*)tag_block_alloc(Allocator, sizeof(T) * NumElements);
 }
-#endif
 
 #endif //MAPLE_MM_H
\ No newline at end of file
@@ -238,7 +238,6 @@ u32 renderer_begin_frame()
         clear_values[1].depthStencil = { 1.0f, 0 };
         Core->VkCore.BeginRenderPass(*ActiveCommandBuffer, clear_values, 2, Framebuffer, Core->Renderer->PrimaryRenderPass);
         
-        //render_set_viewport_info *ViewportInfo = talloc<render_set_viewport_info>(1);
         VkExtent2D Extent = Core->VkCore.GetSwapChainExtent();
         
         u32 Width, Height;
@@ -303,12 +302,13 @@ void object_data_buffer_init(object_data_buffer *ObjectDataBuffer)
     ObjectDataBuffer->DescriptorLayout = Core->VkCore.CreateDescriptorSetLayout(Bindings, 1);
     
     // Create the Descriptor Sets
-    ObjectDataBuffer->DescriptorSets = (VkDescriptorSet*)memory_alloc(Core->Memory, 
-                                                                      sizeof(VkDescriptorSet) * SwapChainImageCount);
+    ObjectDataBuffer->DescriptorSets = (VkDescriptorSet*)memory_alloc_tagged(Core->Memory, 
+                                                                             sizeof(VkDescriptorSet) * SwapChainImageCount, MemoryTag_Renderer);
     ObjectDataBuffer->DescriptorSetsCount = SwapChainImageCount;
     
-    VkDescriptorSetLayout *Layouts = (VkDescriptorSetLayout*)memory_alloc(Core->Memory, 
-                                                                          sizeof(VkDescriptorSetLayout) * SwapChainImageCount);
+    stack_marker LoadMarker = stack_get_marker(Core->LoadStack, StackSide_Top);
+    
+    VkDescriptorSetLayout *Layouts = talloc<VkDescriptorSetLayout>(Core->LoadStack, SwapChainImageCount);
     for (u32 LayoutIdx = 0; LayoutIdx < SwapChainImageCount; ++LayoutIdx)
         Layouts[LayoutIdx] = ObjectDataBuffer->DescriptorLayout;
     
@@ -321,7 +321,7 @@ void object_data_buffer_init(object_data_buffer *ObjectDataBuffer)
     Core->VkCore.CreateDescriptorSets(ObjectDataBuffer->DescriptorSets,
                                       AllocInfo);
     
-    memory_release(Core->Memory, Layouts);
+    stack_free_to_marker(Core->LoadStack, LoadMarker);
     
     // HACK(Dustin): HARDCODING THE SIZE OF THE BUFFER. PROBABLY WANT
     // TO ALLOW FOR THE PLATFORM TO SET THIS.
@@ -392,12 +392,13 @@ void global_shader_data_init(global_shader_data *ShaderData)
     ShaderData->DescriptorLayout = Core->VkCore.CreateDescriptorSetLayout(Bindings, 1);
     
     // Create the Descriptor Sets
-    ShaderData->DescriptorSets = (VkDescriptorSet*)memory_alloc(Core->Memory, 
-                                                                sizeof(VkDescriptorSet) * SwapChainImageCount);
+    ShaderData->DescriptorSets = (VkDescriptorSet*)memory_alloc_tagged(Core->Memory, 
+                                                                       sizeof(VkDescriptorSet) * SwapChainImageCount, MemoryTag_Renderer);
     ShaderData->DescriptorSetsCount = SwapChainImageCount;
     
-    VkDescriptorSetLayout *Layouts = (VkDescriptorSetLayout*)memory_alloc(Core->Memory, 
-                                                                          sizeof(VkDescriptorSetLayout) * SwapChainImageCount);
+    stack_marker LoadMarker = stack_get_marker(Core->LoadStack, StackSide_Top);
+    
+    VkDescriptorSetLayout *Layouts = talloc<VkDescriptorSetLayout>(Core->LoadStack, SwapChainImageCount);
     for (u32 LayoutIdx = 0; LayoutIdx < SwapChainImageCount; ++LayoutIdx)
         Layouts[LayoutIdx] = ShaderData->DescriptorLayout;
     
@@ -410,7 +411,7 @@ void global_shader_data_init(global_shader_data *ShaderData)
     Core->VkCore.CreateDescriptorSets(ShaderData->DescriptorSets,
                                       AllocInfo);
     
-    memory_release(Core->Memory, Layouts);
+    stack_free_to_marker(Core->LoadStack, LoadMarker);
     
     mp_uniform_buffer_init(&ShaderData->Buffer, sizeof(camera_data));
     
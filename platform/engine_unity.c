@@ -15,12 +15,19 @@
 //~ Type System
 
 #include "utils/maple_types.h"
+
+#define MAPLE_ATOMICS_IMPLEMENTATION
+#include "utils/atomics.h"
+
 #include "../graphics/vulkan/vulkan_core.h"
 #include "platform/globals.h"
 
 //~ Memory Management
 
 #include "mm/memory.h"
+#include "mm/frame_allocator.h"
+#include "mm/tagged_heap.h"
+#include "mm/allocator.h"
 
 //~ Util stuff
 
@@ -39,11 +46,28 @@
 #define MAPLE_HASH_FUNCTION_IMPLEMENTATION
 #include "utils/hash_functions.h"
 
+#define MAPLE_STRING_INTERN_IMPLEMENTATION
+#include "utils/string_intern.h"
+
+#define MAPLE_HASH_MAP_IMPLEMENTATION
+#include "utils/hash_map.h"
+
+#define USE_MAPLE_DYN_ARRAY_IMPLEMENTATION
+#include "utils/dyn_array.h"
+
+#define MAPLE_BLOCK_COMPRESS_IMPLEMENTATION
+#include "utils/block_compress.h"
+
 //~ Platform Agnostic Apis
 // - Asset System (platform implementation: win32/assetsys_win32.c)
+// - Async File IO (platform implementation: win32/async_io_win32.c)
+// - Asset Cache (platform implementation: win32/asset_cache_win32.c)
 // - Platform (platform implementation: win32/platform_win32.c)
 
 #include "platform/win32/assetsys.h"
+#include "platform/win32/async_io.h"
+#include "platform/win32/asset_cache.h"
+#include "platform/mpk.h"
 #include "platform/platform.h"
 
 //~ Kinda anything else
@@ -62,4 +86,7 @@
 //-------------------------------------------------------------------------------------------------------------------//
 
 #include "mm/memory.c"
+#include "mm/frame_allocator.c"
+#include "mm/tagged_heap.c"
+#include "mm/allocator.c"
 #include "platform/platform_entry.c"
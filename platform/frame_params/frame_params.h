@@ -13,6 +13,15 @@ typedef struct frame_params
     u64             RenderStageStartTime;
     u64             RenderStageEndTime;
     
+    //~ Memory
+    
+    // Transient memory that is valid for this frame and the next.
+    struct frame_allocator *Scratch;
+    // Same lifetime as Scratch, for bulk per-frame data such as GPU staging.
+    // Backed by 2MB blocks from the tagged heap, so it is not capped by the
+    // size of the scratch memory.
+    struct tag_block       *FrameHeap;
+    
     //~ Input
     
     input           Input;
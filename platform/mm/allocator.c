@@ -0,0 +1,65 @@
+allocator allocator_heap(memory *Heap, memory_tag Tag)
+{
+    allocator Result;
+    Result.Type = AllocatorType_Heap;
+    Result.Tag  = Tag;
+    Result.Heap = Heap;
+    return Result;
+}
+
+allocator allocator_frame(frame_allocator *Frame)
+{
+    allocator Result;
+    Result.Type  = AllocatorType_Frame;
+    Result.Tag   = MemoryTag_Untagged;
+    Result.Frame = Frame;
+    return Result;
+}
+
+allocator allocator_tagged(tag_block *Block)
+{
+    allocator Result;
+    Result.Type  = AllocatorType_Tagged;
+    Result.Tag   = MemoryTag_Untagged;
+    Result.Block = Block;
+    return Result;
+}
+
+void* allocator_alloc(allocator *Allocator, u64 Size)
+{
+    switch (Allocator->Type)
+    {
+        case AllocatorType_Heap:   return memory_alloc_tagged(Allocator->Heap, Size, Allocator->Tag);
+        case AllocatorType_Frame:  return frame_alloc(Allocator->Frame, Size);
+        case AllocatorType_Tagged: return tag_block_alloc(Allocator->Block, Size);
+        default:                   return NULL;
+    }
+}
+
+void* allocator_realloc(allocator *Allocator, void *Ptr, u64 OldSize, u64 Size)
+{
+    // Heap reallocs of NULL would lose the tag
+    if (!Ptr) return allocator_alloc(Allocator, Size);
+    
+    switch (Allocator->Type)
+    {
+        case AllocatorType_Heap:   return memory_realloc(Allocator->Heap, Ptr, Size);
+        case AllocatorType_Frame:  return frame_realloc(Allocator->Frame, Ptr, OldSize, Size);
+        case AllocatorType_Tagged:
+        {
+            // Bump allocated, the old allocation is left behind until the tag is released
+            void *Result = tag_block_alloc(Allocator->Block, Size);
+            if (Result && Ptr) memcpy(Result, Ptr, (OldSize < Size) ? OldSize : Size);
+            return Result;
+        }
+        default:                   return NULL;
+    }
+}
+
+void allocator_free(allocator *Allocator, void *Ptr)
+{
+    if (Allocator->Type == AllocatorType_Heap && Ptr)
+    {
+        memory_release(Allocator->Heap, Ptr);
+    }
+}
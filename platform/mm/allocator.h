@@ -0,0 +1,37 @@
+#ifndef ENGINE_MM_ALLOCATOR_H
+#define ENGINE_MM_ALLOCATOR_H
+
+// A handle to one of the engine allocators, so containers can be given memory
+// from the heap or from an arena without knowing which. Arena allocations are
+// never freed on their own: allocator_free is a no-op for them and the memory
+// goes away with the frame or the tag.
+typedef enum allocator_type
+{
+    AllocatorType_Heap,   // memory_alloc_tagged, freed with memory_release
+    AllocatorType_Frame,  // frame_alloc, valid until the frame is recycled
+    AllocatorType_Tagged, // tag_block_alloc, valid until the tag is released. Allocations have to fit in a block.
+} allocator_type;
+
+typedef struct allocator
+{
+    allocator_type Type;
+    memory_tag     Tag; // Heap allocations only
+    
+    union
+    {
+        memory          *Heap;
+        frame_allocator *Frame;
+        tag_block       *Block;
+    };
+} allocator;
+
+allocator allocator_heap(memory *Heap, memory_tag Tag);
+allocator allocator_frame(frame_allocator *Frame);
+allocator allocator_tagged(tag_block *Block);
+
+void* allocator_alloc(allocator *Allocator, u64 Size);
+// OldSize is the size the allocation was made with, arenas do not track it
+void* allocator_realloc(allocator *Allocator, void *Ptr, u64 OldSize, u64 Size);
+void allocator_free(allocator *Allocator, void *Ptr);
+
+#endif //ENGINE_MM_ALLOCATOR_H
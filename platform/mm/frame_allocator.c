@@ -0,0 +1,88 @@
+#define frame_align(n)          (((n) + FRAME_ALLOCATOR_ALIGNMENT - 1) & ~(u64)(FRAME_ALLOCATOR_ALIGNMENT - 1))
+#define frame_start(a, i)       ((char*)(a)->Start + (u64)(i) * (a)->FrameSize)
+
+void frame_allocator_init(frame_allocator *Allocator, u64 Size, void *Ptr)
+{
+    Allocator->FrameSize  = 0;
+    Allocator->Start      = NULL;
+    Allocator->Brkp       = NULL;
+    Allocator->FrameIndex = 0;
+    Allocator->HighWater  = 0;
+    
+    if (Ptr)
+    {
+        // Keep every frame's region aligned
+        Allocator->FrameSize = (Size / FRAME_ALLOCATOR_FRAME_COUNT) & ~(u64)(FRAME_ALLOCATOR_ALIGNMENT - 1);
+        Allocator->Start     = Ptr;
+        Allocator->Brkp      = Ptr;
+    }
+}
+
+void frame_allocator_free(frame_allocator *Allocator)
+{
+    Allocator->FrameSize  = 0;
+    Allocator->Start      = NULL;
+    Allocator->Brkp       = NULL;
+    Allocator->FrameIndex = 0;
+    Allocator->HighWater  = 0;
+}
+
+void frame_allocator_begin_frame(frame_allocator *Allocator)
+{
+    u64 Used = (char*)Allocator->Brkp - frame_start(Allocator, Allocator->FrameIndex);
+    if (Used > Allocator->HighWater) Allocator->HighWater = Used;
+    
+    Allocator->FrameIndex = (Allocator->FrameIndex + 1) % FRAME_ALLOCATOR_FRAME_COUNT;
+    Allocator->Brkp       = frame_start(Allocator, Allocator->FrameIndex);
+}
+
+void* frame_alloc(frame_allocator *Allocator, u64 Size)
+{
+    if (Size == 0) return NULL;
+    
+    void *Result = NULL;
+    
+    // The start of each frame is aligned, so aligning the size keeps
+    // every allocation aligned.
+    Size = frame_align(Size);
+    
+    char *FrameEnd = frame_start(Allocator, Allocator->FrameIndex) + Allocator->FrameSize;
+    if ((char*)Allocator->Brkp + Size <= FrameEnd)
+    {
+        Result = Allocator->Brkp;
+        Allocator->Brkp = (char*)Allocator->Brkp + Size;
+    }
+    else
+    {
+        mprinte("Frame allocator is out of memory! Requested %llu bytes.\n", Size);
+    }
+    
+    return Result;
+}
+
+void* frame_realloc(frame_allocator *Allocator, void *Ptr, u64 OldSize, u64 Size)
+{
+    if (!Ptr) return frame_alloc(Allocator, Size);
+    if (Size == 0) return NULL;
+    
+    char *FrameEnd = frame_start(Allocator, Allocator->FrameIndex) + Allocator->FrameSize;
+    if ((char*)Ptr + frame_align(OldSize) == (char*)Allocator->Brkp)
+    {
+        if ((char*)Ptr + frame_align(Size) <= FrameEnd)
+        {
+            Allocator->Brkp = (char*)Ptr + frame_align(Size);
+            return Ptr;
+        }
+        
+        mprinte("Frame allocator is out of memory! Requested %llu bytes.\n", Size);
+        return NULL;
+    }
+    
+    void *Result = frame_alloc(Allocator, Size);
+    if (Result) memcpy(Result, Ptr, (OldSize < Size) ? OldSize : Size);
+    
+    return Result;
+}
+
+#undef frame_align
+#undef frame_start
@@ -0,0 +1,41 @@
+#ifndef ENGINE_MM_FRAME_ALLOCATOR_H
+#define ENGINE_MM_FRAME_ALLOCATOR_H
+
+// Number of frames the scratch memory is split across. Matches the number
+// of frames in flight in the renderer, so anything allocated last frame is
+// still valid while the current frame is being built.
+#define FRAME_ALLOCATOR_FRAME_COUNT 2
+#define FRAME_ALLOCATOR_ALIGNMENT   16
+
+// A bump pointer allocator for transient, per-frame memory. Allocations are
+// never freed individually, the whole frame is thrown away when the frame
+// comes back around in frame_allocator_begin_frame.
+typedef struct frame_allocator
+{
+    u64   FrameSize; // Size of a single frame's region
+    
+    void *Start;
+    void *Brkp;
+    
+    u32   FrameIndex;
+    
+    // Memory Usage tracking
+    u64   HighWater; // Most memory used by a single frame
+} frame_allocator;
+
+// Size is the total size of the backing memory, it is split evenly
+// across FRAME_ALLOCATOR_FRAME_COUNT frames.
+void frame_allocator_init(frame_allocator *Allocator, u64 Size, void *Ptr);
+void frame_allocator_free(frame_allocator *Allocator);
+
+// Flips to the next frame and resets its memory.
+void frame_allocator_begin_frame(frame_allocator *Allocator);
+
+void* frame_alloc(frame_allocator *Allocator, u64 Size);
+// Grows or shrinks an allocation made this frame. When Ptr is the most recent
+// allocation it is resized in place, otherwise a new block is allocated and
+// the old contents copied over. Returns NULL if the frame is out of memory,
+// in which case Ptr is left untouched.
+void* frame_realloc(frame_allocator *Allocator, void *Ptr, u64 OldSize, u64 Size);
+
+#endif //ENGINE_MM_FRAME_ALLOCATOR_H
@@ -1,32 +1,128 @@
+#include <stdarg.h>
 
 #define BLOCK_SIZE       8
 #define HEADER_SIZE      BLOCK_SIZE
-#define MIN_HEADER_SIZE  sizeof(void*)
-#define LIST_HEADER_SIZE 2*MIN_HEADER_SIZE
+// A free block has to hold the two free list links and the boundary tag
+// (footer) used to find it from its right neighbour.
+#define MIN_BLOCK_SIZE   (2*sizeof(void*) + sizeof(u64))
+#define SMALL_BLOCK_SIZE (1ULL << MEMORY_FL_INDEX_SHIFT)
 
 #define mem_align(n)            ((n) + BLOCK_SIZE - 1) & ~(BLOCK_SIZE - 1)
-#define header_adjusted_size(n) (MIN_HEADER_SIZE + (((n) >= LIST_HEADER_SIZE) ? (n) : LIST_HEADER_SIZE))
-#define header_to_mem(h)        (void*)((char*)(h) + MIN_HEADER_SIZE)
-#define mem_to_header(p)        (header_t)((char*)(p) - MIN_HEADER_SIZE)
+#define header_to_mem(h)        (void*)((char*)(h) + HEADER_SIZE)
+#define mem_to_header(p)        (header_t)((char*)(p) - HEADER_SIZE)
+#define header_next(h)          (header_t)((char*)(h) + HEADER_SIZE + (h)->Size)
+#define header_footer(h)        (u64*)((char*)(h) + HEADER_SIZE + (h)->Size - sizeof(u64))
+#define header_prev(h)          (header_t)((char*)(h) - *((u64*)(h) - 1) - HEADER_SIZE)
 
+// Memory Layout of a block:
+//
+// Used: | Size, Tag, PrevFree, Used | Data ...                        |
+// Free: | Size, Tag, PrevFree, Used | Next | Prev | ... | Size (footer) |
+//
+// The footer of a free block lets a block that is being released find its
+// left neighbour in O(1). PrevFree is set on the right neighbour whenever
+// a block is placed in a free list, so used blocks never need a footer.
+//
+// Invariant: the block directly below Brkp is never free. Releasing the
+// last block in the heap hands its memory back to Brkp instead of placing
+// it in a free list.
 typedef struct header
 {
-    u64 Size:63;
+    u64 Size:55;
+    u64 Movable:1;  // Allocated through memory_alloc_movable
+    u64 Tag:6;      // memory_tag
+    u64 PrevFree:1;
     u64 Used:1;
     
     header_t Next;
     header_t Prev;
 } header;
 
-file_internal header_t memory_find_free_header(header_t* FreeList, u64 Size);
-file_internal void memory_free_list_add(header_t *FreeList, header_t Header);
-file_internal void memory_free_list_remove(header_t* FreeList, header_t HeaderToRemove);
-file_internal header_t memory_block_split(header_t* FreeList, header_t Header, u64 Size);
-file_internal void memory_block_coalesce(header_t LeftHeader, header_t RightHeader);
+file_internal u32 memory_ctz(u32 Value);
+file_internal u32 memory_ctzl(u64 Value);
+file_internal u32 memory_flsl(u64 Value);
+
+file_internal void memory_mapping_insert(u64 Size, u32 *Fl, u32 *Sl);
+file_internal void memory_mapping_search(u64 Size, u32 *Fl, u32 *Sl);
+file_internal header_t memory_find_free_header(memory *Memory, u64 Size);
+file_internal void memory_free_list_add(memory *Memory, header_t Header);
+file_internal void memory_free_list_remove(memory *Memory, header_t Header);
+file_internal header_t memory_block_split(header_t Header, u64 Size);
+file_internal void memory_block_coalesce(memory *Memory, header_t Header);
+file_internal bool memory_block_grow(memory *Memory, header_t Header, u64 Size);
+
+file_internal bool memory_commit_to(memory *Memory, void *End);
+file_internal void memory_decommit_tail(memory *Memory);
+
+file_internal header_t memory_block_acquire(memory *Memory, u64 Size);
+file_internal void* memory_heap_alloc(memory *Memory, u64 Size, u32 Tag);
+file_internal void* memory_heap_alloc_aligned(memory *Memory, u64 Size, u64 Alignment, u32 Tag);
+file_internal void memory_heap_release(memory *Memory, void *Ptr);
+file_internal u64 memory_compact_chain(memory *Memory, header_t Hole, u64 Budget);
+
+file_internal u32 memory_histogram_bucket(u64 Size);
+file_internal void memory_tag_stats_add(memory *Memory, u32 Tag, u64 Size);
+file_internal void memory_tag_stats_remove(memory *Memory, u32 Tag, u64 Size);
+
+#ifdef MAPLE_MEMORY_TRACE
+file_internal void memory_trace_record(memory *Memory, u32 Op, u32 Tag, u64 Alignment,
+                                       void *Ptr, void *Result, u64 Size);
+#else
+#define memory_trace_record(...)
+#endif
+
+//~ Bit scans
+// memory.c is compiled into the graphics and game dlls as well,
+// so it cannot depend on the Platform* bit functions exported by the exe.
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+#include <intrin.h>
+
+file_internal u32 memory_ctz(u32 Value)
+{
+    unsigned long Index;
+    _BitScanForward(&Index, Value);
+    return Index;
+}
+
+file_internal u32 memory_ctzl(u64 Value)
+{
+    unsigned long Index;
+    _BitScanForward64(&Index, Value);
+    return Index;
+}
+
+file_internal u32 memory_flsl(u64 Value)
+{
+    unsigned long Index;
+    _BitScanReverse64(&Index, Value);
+    return Index;
+}
+
+#else
+
+file_internal u32 memory_ctz(u32 Value)
+{
+    return __builtin_ctz(Value);
+}
+
+file_internal u32 memory_ctzl(u64 Value)
+{
+    return __builtin_ctzll(Value);
+}
+
+file_internal u32 memory_flsl(u64 Value)
+{
+    return 63 - __builtin_clzll(Value);
+}
+
+#endif
 
 void memory_init(memory *Memory, u64 Size, void *Ptr)
 {
     assert(Size % BLOCK_SIZE == 0);
+    assert(Size < (1ULL << MEMORY_FL_INDEX_MAX));
     Memory->Size = Size;
     
     if (!Ptr)
@@ -35,11 +131,42 @@ void memory_init(memory *Memory, u64 Size, void *Ptr)
     }
     else
     {
+        Memory->Lock           = 0;
+        Memory->Committed      = Size;
+        Memory->PageSize       = 0;
         Memory->Start          = Ptr;
         Memory->Brkp           = Memory->Start;
-        Memory->FreeList       = NULL;
+        Memory->Commit         = NULL;
+        Memory->Decommit       = NULL;
+        Memory->Trace          = NULL;
+        Memory->Handles        = NULL;
+        Memory->HandleCapacity = 0;
+        Memory->HandleBrkp     = 0;
+        Memory->HandleFreeList = 0;
+        Memory->MovableCount   = 0;
+        Memory->FlBitmap       = 0;
         Memory->UsedMemory     = 0;
         Memory->NumAllocations = 0;
+        Memory->FreeMemory     = 0;
+        Memory->FreeBlockCount = 0;
+        
+        memset(Memory->SlBitmap, 0, sizeof(Memory->SlBitmap));
+        memset(Memory->FreeLists, 0, sizeof(Memory->FreeLists));
+        memset(Memory->TagStats, 0, sizeof(Memory->TagStats));
+    }
+}
+
+void memory_init_virtual(memory *Memory, u64 Size, void *Ptr,
+                         pfn_memory_commit Commit, pfn_memory_decommit Decommit)
+{
+    assert(Size % MEMORY_COMMIT_GRANULARITY == 0);
+    
+    memory_init(Memory, Size, Ptr);
+    if (Ptr)
+    {
+        Memory->Committed = 0;
+        Memory->Commit    = Commit;
+        Memory->Decommit  = Decommit;
     }
 }
 
@@ -49,272 +176,431 @@ void memory_free(memory *Memory)
     {
         printf("Freeing Free List allocator, but not all memory has been freed. There are still %lld allocations with %lld used memory.\n",
                Memory->NumAllocations, Memory->UsedMemory);
+        
+        for (u32 Tag = 0; Tag < MemoryTag_Count; ++Tag)
+        {
+            memory_tag_stats *Stats = Memory->TagStats + Tag;
+            if (Stats->LiveCount)
+            {
+                printf("    %s: %lld allocations with %lld used memory.\n",
+                       memory_tag_name((memory_tag)Tag), Stats->LiveCount, Stats->LiveBytes);
+            }
+        }
     }
     
     Memory->Start          = NULL;
     Memory->Brkp           = NULL;
-    Memory->FreeList       = NULL;
+    Memory->FlBitmap       = 0;
     Memory->Size           = 0;
+    Memory->Committed      = 0;
+    Memory->PageSize       = 0;
+    Memory->Commit         = NULL;
+    Memory->Decommit       = NULL;
+    Memory->Trace          = NULL;
+    Memory->Handles        = NULL;
+    Memory->HandleCapacity = 0;
+    Memory->HandleBrkp     = 0;
+    Memory->HandleFreeList = 0;
+    Memory->MovableCount   = 0;
     Memory->UsedMemory     = 0;
     Memory->NumAllocations = 0;
+    Memory->FreeMemory     = 0;
+    Memory->FreeBlockCount = 0;
+    
+    memset(Memory->SlBitmap, 0, sizeof(Memory->SlBitmap));
+    memset(Memory->FreeLists, 0, sizeof(Memory->FreeLists));
+    memset(Memory->TagStats, 0, sizeof(Memory->TagStats));
 }
 
-file_internal header_t memory_find_free_header(header_t* FreeList, u64 Size)
+// Maps a block size to the free list the block belongs in. Sizes below
+// SMALL_BLOCK_SIZE all live in the first level and are split linearly.
+file_internal void memory_mapping_insert(u64 Size, u32 *Fl, u32 *Sl)
 {
-    header_t Iter = *FreeList;
-    
-    // Simple first-fit search
-    while (Iter != NULL)
+    if (Size < SMALL_BLOCK_SIZE)
     {
-        if (!Iter->Used && Size <= Iter->Size)
-        {
-            break;
-        }
-        
-        Iter = Iter->Next;
+        *Fl = 0;
+        *Sl = (u32)(Size / (SMALL_BLOCK_SIZE / MEMORY_SL_INDEX_COUNT));
     }
-    
-    if (Iter)
+    else
     {
-        memory_free_list_remove(FreeList, Iter);
+        u32 Fls = memory_flsl(Size);
+        *Sl = (u32)(Size >> (Fls - MEMORY_SL_INDEX_COUNT_LOG2)) ^ (1 << MEMORY_SL_INDEX_COUNT_LOG2);
+        *Fl = Fls - (MEMORY_FL_INDEX_SHIFT - 1);
     }
-    
-    return Iter;
 }
 
-file_internal void memory_block_coalesce(header_t LeftHeader, header_t RightHeader)
+// Same as memory_mapping_insert, but rounds the size up to the next list
+// so that any block found in the returned list is large enough.
+file_internal void memory_mapping_search(u64 Size, u32 *Fl, u32 *Sl)
 {
-    if (!LeftHeader || !RightHeader)
-        return;
-    
-    // i arbitrarily decided that h1 will be the header
-    // that is kept.
-    if (LeftHeader < RightHeader)
-    {
-        LeftHeader->Next = RightHeader->Next;
-        if (RightHeader->Next) RightHeader->Next->Prev = LeftHeader;
-    }
-    else
+    if (Size >= SMALL_BLOCK_SIZE)
     {
-        LeftHeader->Prev = RightHeader->Prev;
-        if (RightHeader->Prev) RightHeader->Prev->Next = LeftHeader;
+        Size += (1ULL << (memory_flsl(Size) - MEMORY_SL_INDEX_COUNT_LOG2)) - 1;
     }
     
-    // h1_sz + h2_sz will result in the TOTAL memory retrieved.
-    // in reality, the memory that can be used is dependent on its
-    // size. Looks something like:
-    // TOTAL MEMORY = HEADER 1 + H1_SZ + HEADER 2 + H2SZ
-    //
-    // However, [HEADER 1] will be reserved during a merge, so cannot
-    // be considered part of block size.
-    //
-    // Therefore, we can think of the new block size to be something like:
-    //     NEW BLOCK SIZE =  H1_SZ + HEADER 2 + H2SZ
-    //     NEW BLOCK SIZE =  H1_SZ + header_adjusted_size(header2)
-    LeftHeader->Size += header_adjusted_size(RightHeader->Size);
+    memory_mapping_insert(Size, Fl, Sl);
 }
 
-file_internal void memory_free_list_add(header_t *FreeList, header_t Header)
+file_internal header_t memory_find_free_header(memory *Memory, u64 Size)
 {
-    Header->Next = NULL;
-    Header->Prev = NULL;
+    header_t Result = NULL;
     
-    // init the list
-    if (!(*FreeList))
-    {
-        *FreeList = Header;
-        (*FreeList)->Prev = NULL;
-        (*FreeList)->Next = NULL;
-        
-        return;
-    }
-    
-    header_t Iter = *FreeList;
+    u32 Fl, Sl;
+    memory_mapping_search(Size, &Fl, &Sl);
     
-    // add to the front
-    if (Header < *FreeList)
-    {
-        Header->Next      = *FreeList;
-        (*FreeList)->Prev = Header;
-        *FreeList         = Header;
-    }
-    else
+    if (Fl < MEMORY_FL_INDEX_COUNT)
     {
-        while (Iter->Next && Header > Iter->Next)
+        // Search the current first level for a list at least as large as the request,
+        // then fall back to the next non-empty first level.
+        u32 SlMap = Memory->SlBitmap[Fl] & (~0U << Sl);
+        if (!SlMap)
         {
-            // NOTE(Dustin): I am not sure about the relevency of this branch...
-            // I think I was originally trying to detect a duplicate in the list.
-            if (Iter == Header || Iter->Next == Header)
+            u64 FlMap = Memory->FlBitmap & (~0ULL << (Fl + 1));
+            if (FlMap)
             {
-                return;
+                Fl    = memory_ctzl(FlMap);
+                SlMap = Memory->SlBitmap[Fl];
             }
-            
-            Iter = Iter->Next;
         }
         
-        // insert the header into the list
-        Header->Prev = Iter;
-        Header->Next = Iter->Next;
-        
-        if (Iter->Next)
+        if (SlMap)
         {
-            Iter->Next->Prev = Header;
+            Sl = memory_ctz(SlMap);
+            Result = Memory->FreeLists[Fl][Sl];
         }
-        
-        Iter->Next = Header;
     }
     
-    // If the new node is besides already existing nodes, merge them together
-    Iter = Header;
-    
-    if (Iter->Next)
+    if (Result)
     {
-        u64 Adj = header_adjusted_size(Iter->Size);
-        if (((char*)Iter + Adj) == (char*)Iter->Next)
-        {
-            memory_block_coalesce(Iter, Iter->Next);
-        }
+        memory_free_list_remove(Memory, Result);
     }
     
-    if (Iter->Prev)
+    return Result;
+}
+
+file_internal void memory_free_list_add(memory *Memory, header_t Header)
+{
+    u32 Fl, Sl;
+    memory_mapping_insert(Header->Size, &Fl, &Sl);
+    
+    header_t Head = Memory->FreeLists[Fl][Sl];
+    
+    Header->Used = 0;
+    Header->Prev = NULL;
+    Header->Next = Head;
+    if (Head) Head->Prev = Header;
+    
+    Memory->FreeLists[Fl][Sl] = Header;
+    Memory->FlBitmap     |= (1ULL << Fl);
+    Memory->SlBitmap[Fl] |= (1U << Sl);
+    
+    Memory->FreeMemory += Header->Size;
+    Memory->FreeBlockCount++;
+    
+    // boundary tag for the right neighbour
+    *header_footer(Header) = Header->Size;
+}
+
+file_internal void memory_free_list_remove(memory *Memory, header_t Header)
+{
+    u32 Fl, Sl;
+    memory_mapping_insert(Header->Size, &Fl, &Sl);
+    
+    if (Header->Prev) Header->Prev->Next = Header->Next;
+    if (Header->Next) Header->Next->Prev = Header->Prev;
+    
+    if (Memory->FreeLists[Fl][Sl] == Header)
     {
-        u64 Adj = header_adjusted_size(Iter->Prev->Size);
-        if (((char*)Iter - Adj) == (char*)Iter->Prev)
+        Memory->FreeLists[Fl][Sl] = Header->Next;
+        
+        if (!Header->Next)
         {
-            memory_block_coalesce(Iter->Prev, Iter);
+            Memory->SlBitmap[Fl] &= ~(1U << Sl);
+            if (!Memory->SlBitmap[Fl]) Memory->FlBitmap &= ~(1ULL << Fl);
         }
     }
+    
+    Header->Prev = NULL;
+    Header->Next = NULL;
+    
+    Memory->FreeMemory -= Header->Size;
+    Memory->FreeBlockCount--;
 }
 
-
-file_internal void memory_free_list_remove(header_t* FreeList, header_t HeaderToRemove)
+// Splits the Header so that it holds exactly Size bytes. If the leftover is large
+// enough to form a block, that block is returned. The caller is responsible for
+// placing the leftover block.
+file_internal header_t memory_block_split(header_t Header, u64 Size)
 {
-    // Do not need to check FreeList because Alloc only calls memory_find_free_header
-    // if the FreeList exists
-    // if (!(*FreeList) || header == NULL) return;
+    header_t Result = NULL;
     
-    if (*FreeList == HeaderToRemove)
+    if (Header->Size >= Size + HEADER_SIZE + MIN_BLOCK_SIZE)
     {
-        *FreeList = HeaderToRemove->Next;
-        if (*FreeList) (*FreeList)->Prev = NULL;
+        Result = (header_t)((char*)Header + HEADER_SIZE + Size);
+        Result->Size     = Header->Size - Size - HEADER_SIZE;
+        Result->Tag      = MemoryTag_Untagged;
+        Result->Movable  = 0;
+        Result->Used     = 0;
+        Result->PrevFree = 0;
+        
+        Header->Size = Size;
     }
     
-    // Remove it from the free list
-    if (HeaderToRemove->Prev != NULL)
+    return Result;
+}
+
+// Merges a block that is no longer used with its free neighbours and then places
+// it in the correct free list, or gives it back to the break point if it is the
+// last block in the heap.
+file_internal void memory_block_coalesce(memory *Memory, header_t Header)
+{
+    header_t Next = header_next(Header);
+    if ((void*)Next < Memory->Brkp && !Next->Used)
     {
-        HeaderToRemove->Prev->Next = HeaderToRemove->Next;
+        memory_free_list_remove(Memory, Next);
+        Header->Size += HEADER_SIZE + Next->Size;
     }
     
-    if (HeaderToRemove->Next != NULL)
+    if (Header->PrevFree)
     {
-        HeaderToRemove->Next->Prev = HeaderToRemove->Prev;
+        header_t Prev = header_prev(Header);
+        memory_free_list_remove(Memory, Prev);
+        Prev->Size += HEADER_SIZE + Header->Size;
+        Header = Prev;
     }
     
-    HeaderToRemove->Prev = NULL;
-    HeaderToRemove->Next = NULL;
+    Next = header_next(Header);
+    if ((void*)Next >= Memory->Brkp)
+    {
+        Memory->Brkp = Header;
+        memory_decommit_tail(Memory);
+    }
+    else
+    {
+        memory_free_list_add(Memory, Header);
+        Next->PrevFree = 1;
+    }
 }
 
-file_internal header_t memory_block_split(header_t* FreeList, header_t Header, u64 Size)
+// Grows a used block in place to hold Size bytes, either by absorbing the free block
+// to its right or, if it is the last block in the heap, by moving the break point.
+// Returns false if neither is possible and the block is left untouched.
+file_internal bool memory_block_grow(memory *Memory, header_t Header, u64 Size)
 {
-    /*
-      Determine if a header can be split
-      Let's consider the minimum scenerio where size is 8bytes.
-      The Header Alignment uses 24bytes, so an 8byte request is
-      aligned to 24bytes.
-    
-      Since 8bytes is the minimum request size, that means after
-      a split, there must be 8 bytes leftover. So a split can occur
-      when:
+    u64 OldSize = Header->Size;
     
-      header_size - header_adjusted_size(size) >= 8 bytes
-    
-      So the new block will have a total allocated size of at least
-      24 bytes. 16 bytes of this is usable. 8 bytes is reserved for
-      header flags. So new block size will be:
-    
-      block_size = header_adjusted_size(size) - 8 bytes
-      Before split:
-      -----------------------------
-      | 8b |  x >= 16b            |
-      -----------------------------
-      After split:
-      ------------------------------------------
-      | 8b | size | 8b | leftover at least 16b |
-      ------------------------------------------
+    header_t Next = header_next(Header);
+    if ((void*)Next >= Memory->Brkp)
+    {
+        if ((char*)Header + HEADER_SIZE + Size > (char*)Memory->Start + Memory->Size ||
+            !memory_commit_to(Memory, (char*)Header + HEADER_SIZE + Size))
+        {
+            return false;
+        }
+        
+        Header->Size = Size;
+        Memory->Brkp = header_next(Header);
+    }
+    else if (!Next->Used && OldSize + HEADER_SIZE + Next->Size >= Size)
+    {
+        memory_free_list_remove(Memory, Next);
+        Header->Size += HEADER_SIZE + Next->Size;
+        
+        header_t Leftover = memory_block_split(Header, Size);
+        if (Leftover)
+        {
+            // Next was fully coalesced, so the block after the leftover is used
+            // and already has PrevFree set.
+            memory_free_list_add(Memory, Leftover);
+        }
+        else
+        {
+            Next = header_next(Header);
+            if ((void*)Next < Memory->Brkp) Next->PrevFree = 0;
+        }
+    }
+    else
+    {
+        return false;
+    }
     
-    */
+    memory_tag_stats *Stats = Memory->TagStats + Header->Tag;
+    Memory->UsedMemory += Header->Size - OldSize;
+    Stats->LiveBytes   += Header->Size - OldSize;
+    if (Stats->LiveBytes > Stats->PeakBytes) Stats->PeakBytes = Stats->LiveBytes;
     
-    // size required to form a new block with the requested size
-    u64 ReqSize        = header_adjusted_size(Size);
-    u64 HeaderDataSize = Header->Size;
+    return true;
+}
+
+// Makes sure every byte below End is backed by committed pages. Pages are
+// committed a chunk at a time so that the bump path does not call into the
+// OS for every allocation.
+file_internal bool memory_commit_to(memory *Memory, void *End)
+{
+    u64 Needed = (char*)End - (char*)Memory->Start;
+    if (Needed <= Memory->Committed) return true;
+    if (!Memory->Commit) return false;
     
-    // Requested memory is over budget
-    if (ReqSize >= HeaderDataSize) return Header;
+    u64 Committed = (Needed + MEMORY_COMMIT_GRANULARITY - 1) & ~(MEMORY_COMMIT_GRANULARITY - 1);
+    if (Committed > Memory->Size) Committed = Memory->Size;
     
-    u64 Leftover = HeaderDataSize - Size;
-    // is there enough space for the split? Need: 8 byte core header + 16 bytes for the links
-    if (Leftover < header_adjusted_size(BLOCK_SIZE))
+    if (!Memory->Commit((char*)Memory->Start + Memory->Committed, Committed - Memory->Committed))
     {
-        return Header;
+        printf("Failed to commit memory for the heap!\n");
+        return false;
     }
     
-    Header->Size = Size;
+    Memory->Committed = Committed;
+    return true;
+}
+
+// Hands the pages past the break point back to the OS once enough of them
+// have piled up. The address range stays reserved.
+file_internal void memory_decommit_tail(memory *Memory)
+{
+    if (!Memory->Decommit) return;
     
-    header_t SplitHeader = (header_t)((char*)Header + ReqSize);
-    // leftover represents the TOTAL space leftover. Need to account for
-    // the reserved flags space, so subtract 8bytes
-    SplitHeader->Size = Leftover - BLOCK_SIZE;
-    SplitHeader->Used = 0;
+    u64 Keep = ((char*)Memory->Brkp - (char*)Memory->Start);
+    Keep = (Keep + MEMORY_COMMIT_GRANULARITY - 1) & ~(MEMORY_COMMIT_GRANULARITY - 1);
     
-    // Add the split header to the free list for future use
-    memory_free_list_add(FreeList, SplitHeader);
+    if (Memory->Committed - Keep >= MEMORY_DECOMMIT_THRESHOLD)
+    {
+        Memory->Decommit((char*)Memory->Start + Keep, Memory->Committed - Keep);
+        Memory->Committed = Keep;
+    }
+}
+
+// Takes a used block of at least Size bytes from the free lists, or from the
+// break point if no free block fits. Size must already be aligned. Usage
+// tracking is left to the caller.
+file_internal header_t memory_block_acquire(memory *Memory, u64 Size)
+{
+    // Search for an available header
+    header_t Header = memory_find_free_header(Memory, Size);
+    if (Header)
+    {
+        header_t Leftover = memory_block_split(Header, Size);
+        if (Leftover)
+        {
+            // The original block was fully coalesced, so the leftover
+            // cannot have a free right neighbour.
+            memory_free_list_add(Memory, Leftover);
+        }
+        else
+        {
+            header_t Next = header_next(Header);
+            if ((void*)Next < Memory->Brkp) Next->PrevFree = 0;
+        }
+        
+        Header->Used    = 1;
+        Header->Movable = 0;
+    }
+    else
+    {
+        // header was not found, request from the heap
+        if (((char*)Memory->Brkp + HEADER_SIZE + Size) <= ((char*)Memory->Start + Memory->Size) &&
+            memory_commit_to(Memory, (char*)Memory->Brkp + HEADER_SIZE + Size))
+        {
+            Header = (header_t)Memory->Brkp;
+            Memory->Brkp = (char*)Memory->Brkp + HEADER_SIZE + Size;
+            
+            Header->Size     = Size;
+            Header->Tag      = MemoryTag_Untagged;
+            Header->Movable  = 0;
+            Header->Used     = 1;
+            Header->PrevFree = 0;
+            Header->Next     = NULL;
+            Header->Prev     = NULL;
+        }
+        else
+        {
+            // TODO(Dustin): Log
+            printf("Requesting more memory than is available!\n");
+        }
+    }
     
     return Header;
 }
 
-void* memory_alloc(memory *Memory, u64 Size)
+file_internal void* memory_heap_alloc(memory *Memory, u64 Size, u32 Tag)
 {
     if (Size == 0) return NULL;
     
     void *Result = NULL;
     
     Size = mem_align(Size);
-    u64 AdjSize = header_adjusted_size(Size);
+    if (Size < MIN_BLOCK_SIZE) Size = MIN_BLOCK_SIZE;
     
-    // Search for an available header
-    header_t Header = NULL;
-    if (Memory->FreeList && (Header = memory_find_free_header(&Memory->FreeList, Size)))
+    header_t Header = memory_block_acquire(Memory, Size);
+    if (Header)
     {
-        memory_block_split(&Memory->FreeList, Header, Size);
-        Header->Used = 1;
+        Header->Tag = Tag;
         
         Memory->NumAllocations++;
         Memory->UsedMemory += Header->Size;
+        memory_tag_stats_add(Memory, Tag, Header->Size);
         
         Result = header_to_mem(Header);
     }
-    else {
-        // header was not found, request from the heap
-        if (((char*)Memory->Brkp + AdjSize) <= ((char*)Memory->Start + Memory->Size))
+    
+    return Result;
+}
+
+// Over-allocates by enough to place an aligned block inside of the acquired
+// one, then gives the unused space on either side back to the heap. The gap in
+// front is either empty or large enough to form a free block of its own.
+file_internal void* memory_heap_alloc_aligned(memory *Memory, u64 Size, u64 Alignment, u32 Tag)
+{
+    if (Size == 0) return NULL;
+    
+    assert((Alignment & (Alignment - 1)) == 0 && "Alignment must be a power of two!");
+    if (Alignment <= BLOCK_SIZE) return memory_heap_alloc(Memory, Size, Tag);
+    
+    void *Result = NULL;
+    
+    Size = mem_align(Size);
+    if (Size < MIN_BLOCK_SIZE) Size = MIN_BLOCK_SIZE;
+    
+    header_t Header = memory_block_acquire(Memory, Size + Alignment + HEADER_SIZE + MIN_BLOCK_SIZE);
+    if (Header)
+    {
+        char *Data    = (char*)header_to_mem(Header);
+        char *Aligned = (char*)(((u64)Data + Alignment - 1) & ~(Alignment - 1));
+        if (Aligned != Data && (u64)(Aligned - Data) < HEADER_SIZE + MIN_BLOCK_SIZE)
         {
-            char *NextAddr = (char*)Memory->Brkp;
-            Memory->Brkp = (char*)Memory->Brkp + AdjSize;
-            Header = (header_t)NextAddr;
-            
-            Header->Size = Size;
-            Header->Used = 1;
-            Header->Next = NULL;
-            Header->Prev = NULL;
+            Aligned = (char*)(((u64)Data + HEADER_SIZE + MIN_BLOCK_SIZE + Alignment - 1) & ~(Alignment - 1));
+        }
+        
+        if (Aligned != Data)
+        {
+            header_t Front = Header;
             
-            Memory->NumAllocations++;
-            Memory->UsedMemory += Header->Size;
+            Header = (header_t)mem_to_header(Aligned);
+            Header->Size     = Front->Size - (u64)(Aligned - Data);
+            Header->Movable  = 0;
+            Header->Used     = 1;
+            Header->PrevFree = 0;
             
-            Result = header_to_mem(Header);
+            // Used blocks are always to the left and right of Front, so it
+            // only merges with a free block to its left.
+            Front->Size = (u64)(Aligned - Data) - HEADER_SIZE;
+            Front->Used = 0;
+            memory_block_coalesce(Memory, Front);
         }
-        else {
-            // TODO(Dustin): Log
-            printf("Requesting more memory than is available!\n");
+        
+        header_t Leftover = memory_block_split(Header, Size);
+        if (Leftover)
+        {
+            memory_block_coalesce(Memory, Leftover);
         }
+        
+        Header->Tag = Tag;
+        
+        Memory->NumAllocations++;
+        Memory->UsedMemory += Header->Size;
+        memory_tag_stats_add(Memory, Tag, Header->Size);
+        
+        Result = header_to_mem(Header);
     }
     
     return Result;
@@ -323,13 +609,18 @@ void* memory_alloc(memory *Memory, u64 Size)
 void* memory_realloc(memory *Memory, void *Ptr, u64 Size)
 {
     header_t Header = (header_t)mem_to_header(Ptr);
+    assert(!Ptr || !Header->Movable);
     
     void *Result = NULL;
     
     Size = mem_align(Size);
+    if (Size < MIN_BLOCK_SIZE) Size = MIN_BLOCK_SIZE;
+    
+    spin_lock_acquire(&Memory->Lock);
+    
     if (!Ptr)
     {
-        Result = memory_alloc(Memory, Size);
+        Result = memory_heap_alloc(Memory, Size, MemoryTag_Untagged);
     }
     else if (Header->Size == Size)
     {
@@ -337,13 +628,23 @@ void* memory_realloc(memory *Memory, void *Ptr, u64 Size)
     }
     else if (Size > Header->Size)
     {
-        // Size is greater than the allocation, so we
-        // have allocate a new block of memory, copy
-        // the old block over, and finally free the old
-        // block
-        Result = memory_alloc(Memory, Size);
-        memcpy(Result, Ptr, Size);
-        memory_release(Memory, Ptr);
+        // Size is greater than the allocation. Try to grow
+        // the block into its right neighbour first, otherwise
+        // allocate a new block, copy the old block over, and
+        // free the old block.
+        if (memory_block_grow(Memory, Header, Size))
+        {
+            Result = Ptr;
+        }
+        else
+        {
+            Result = memory_heap_alloc(Memory, Size, Header->Tag);
+            if (Result)
+            {
+                memcpy(Result, Ptr, Header->Size);
+                memory_heap_release(Memory, Ptr);
+            }
+        }
     }
     else
     {
@@ -351,15 +652,30 @@ void* memory_realloc(memory *Memory, void *Ptr, u64 Size)
         // we attempt to split the block, adjust
         // size, add new block back to the free list
         // and return adjusted block.
-        memory_block_split(&Memory->FreeList, Header, Size);
+        u64 OldSize = Header->Size;
+        header_t Leftover = memory_block_split(Header, Size);
+        if (Leftover)
+        {
+            Memory->UsedMemory -= OldSize - Header->Size;
+            Memory->TagStats[Header->Tag].LiveBytes -= OldSize - Header->Size;
+            memory_block_coalesce(Memory, Leftover);
+        }
         
         Result = header_to_mem(Header);
     }
     
+    // The block keeps its tag, so the tag is read back from the result. The old
+    // header may already be gone if the block moved.
+    memory_trace_record(Memory, MemoryTraceOp_Realloc,
+                        (Result) ? ((header_t)mem_to_header(Result))->Tag : MemoryTag_Untagged,
+                        0, Ptr, Result, Size);
+    
+    spin_lock_release(&Memory->Lock);
+    
     return Result;
 }
 
-void memory_release(memory *Memory, void *Ptr)
+file_internal void memory_heap_release(memory *Memory, void *Ptr)
 {
     if (!Ptr) return;
     
@@ -379,23 +695,611 @@ void memory_release(memory *Memory, void *Ptr)
     
     Memory->UsedMemory -= Header->Size;
     Memory->NumAllocations--;
+    memory_tag_stats_remove(Memory, Header->Tag, Header->Size);
+    
+    memory_block_coalesce(Memory, Header);
+}
+
+void* memory_alloc(memory *Memory, u64 Size)
+{
+    return memory_alloc_tagged(Memory, Size, MemoryTag_Untagged);
+}
+
+void* memory_alloc_tagged(memory *Memory, u64 Size, memory_tag Tag)
+{
+    spin_lock_acquire(&Memory->Lock);
+    void *Result = memory_heap_alloc(Memory, Size, Tag);
+    memory_trace_record(Memory, MemoryTraceOp_Alloc, Tag, 0, NULL, Result, Size);
+    spin_lock_release(&Memory->Lock);
+    
+    return Result;
+}
+
+void* memory_alloc_aligned(memory *Memory, u64 Size, u64 Alignment)
+{
+    return memory_alloc_aligned_tagged(Memory, Size, Alignment, MemoryTag_Untagged);
+}
+
+void* memory_alloc_aligned_tagged(memory *Memory, u64 Size, u64 Alignment, memory_tag Tag)
+{
+    spin_lock_acquire(&Memory->Lock);
+    void *Result = memory_heap_alloc_aligned(Memory, Size, Alignment, Tag);
+    memory_trace_record(Memory, MemoryTraceOp_AllocAligned, Tag, Alignment, NULL, Result, Size);
+    spin_lock_release(&Memory->Lock);
+    
+    return Result;
+}
+
+void memory_release(memory *Memory, void *Ptr)
+{
+    if (!Ptr) return;
+    assert(!((header_t)mem_to_header(Ptr))->Movable);
+    
+    spin_lock_acquire(&Memory->Lock);
+    memory_trace_record(Memory, MemoryTraceOp_Release, MemoryTag_Untagged, 0, Ptr, NULL, 0);
+    memory_heap_release(Memory, Ptr);
+    spin_lock_release(&Memory->Lock);
+}
+
+//~ Movable blocks
+//
+// Layout of a movable block:
+//
+// | Header (Movable = 1) | Handle slot (u64) | Data ... |
+//
+// The slot lets compaction find the table entry of a block it just moved.
+//
+// Movable allocations are not recorded in allocation traces.
+// Compaction changes the offset of a block after it was recorded, so the
+// trace could not match the release to the alloc.
+
+#define handle_make(gen, index) (((u64)(gen) << 32) | (u64)(index))
+#define handle_index(h)         (u32)((h) & 0xFFFFFFFF)
+#define handle_generation(h)    (u32)((h) >> 32)
+
+void memory_handle_table_init(memory *Memory, u32 Capacity)
+{
+    assert(!Memory->Handles);
+    
+    // Slot 0 is reserved so that a free list link of 0 can end the list
+    Capacity += 1;
+    
+    spin_lock_acquire(&Memory->Lock);
+    memory_handle_entry *Handles = (memory_handle_entry*)memory_heap_alloc(Memory, Capacity * sizeof(memory_handle_entry),
+                                                                           MemoryTag_Untagged);
+    spin_lock_release(&Memory->Lock);
+    
+    if (!Handles)
+    {
+        printf("Failed to allocate the handle table for movable allocations!\n");
+        return;
+    }
+    
+    memset(Handles, 0, Capacity * sizeof(memory_handle_entry));
+    
+    Memory->Handles        = Handles;
+    Memory->HandleCapacity = Capacity;
+    Memory->HandleBrkp     = 1;
+    Memory->HandleFreeList = 0;
+    Memory->MovableCount   = 0;
+}
+
+void memory_handle_table_free(memory *Memory)
+{
+    if (!Memory->Handles) return;
+    
+    if (Memory->MovableCount)
+    {
+        printf("Freeing the handle table, but there are still %d movable allocations.\n", Memory->MovableCount);
+    }
+    
+    spin_lock_acquire(&Memory->Lock);
+    memory_heap_release(Memory, Memory->Handles);
+    spin_lock_release(&Memory->Lock);
+    
+    Memory->Handles        = NULL;
+    Memory->HandleCapacity = 0;
+    Memory->HandleBrkp     = 0;
+    Memory->HandleFreeList = 0;
+    Memory->MovableCount   = 0;
+}
+
+memory_handle memory_alloc_movable(memory *Memory, u64 Size, memory_tag Tag)
+{
+    if (Size == 0 || !Memory->Handles) return 0;
+    
+    memory_handle Result = 0;
+    
+    spin_lock_acquire(&Memory->Lock);
+    
+    u32 Index = Memory->HandleFreeList;
+    if (!Index && Memory->HandleBrkp < Memory->HandleCapacity)
+    {
+        Index = Memory->HandleBrkp;
+    }
+    
+    if (!Index)
+    {
+        printf("Out of handles for movable allocations! All %d handles are in use.\n", Memory->HandleCapacity - 1);
+    }
+    else
+    {
+        u64 *Slot = (u64*)memory_heap_alloc(Memory, sizeof(u64) + Size, Tag);
+        if (Slot)
+        {
+            memory_handle_entry *Entry = Memory->Handles + Index;
+            
+            if (Index == Memory->HandleFreeList) Memory->HandleFreeList = Entry->NextFree;
+            else                                 Memory->HandleBrkp++;
+            
+            // Generations start at 1, so a valid handle is never 0
+            if (!Entry->Generation) Entry->Generation = 1;
+            Entry->Ptr      = Slot + 1;
+            Entry->NextFree = 0;
+            
+            header_t Header = mem_to_header(Slot);
+            Header->Movable = 1;
+            *Slot = Index;
+            Memory->MovableCount++;
+            
+            Result = handle_make(Entry->Generation, Index);
+        }
+    }
+    
+    spin_lock_release(&Memory->Lock);
+    
+    return Result;
+}
+
+void* memory_handle_get(memory *Memory, memory_handle Handle)
+{
+    u32 Index = handle_index(Handle);
+    if (!Index || Index >= Memory->HandleBrkp) return NULL;
+    
+    memory_handle_entry *Entry = Memory->Handles + Index;
+    return (Entry->Generation == handle_generation(Handle)) ? Entry->Ptr : NULL;
+}
+
+void memory_release_movable(memory *Memory, memory_handle Handle)
+{
+    if (!Handle) return;
+    
+    spin_lock_acquire(&Memory->Lock);
+    
+    u32 Index = handle_index(Handle);
+    memory_handle_entry *Entry = Memory->Handles + Index;
+    
+    if (Index && Index < Memory->HandleBrkp && Entry->Ptr && Entry->Generation == handle_generation(Handle))
+    {
+        memory_heap_release(Memory, (u64*)Entry->Ptr - 1);
+        Memory->MovableCount--;
+        
+        Entry->Ptr = NULL;
+        // Skip 0 when the generation wraps
+        if (++Entry->Generation == 0) Entry->Generation = 1;
+        Entry->NextFree = Memory->HandleFreeList;
+        Memory->HandleFreeList = Index;
+    }
+    
+    spin_lock_release(&Memory->Lock);
+}
+
+// Slides the run of movable blocks directly after the free block Hole down by the
+// size of the hole, until a block that is not movable is reached or Budget bytes
+// have been moved. The hole ends up after the last moved block, where it is merged
+// with its new neighbours. Hole must already be out of the free lists.
+file_internal u64 memory_compact_chain(memory *Memory, header_t Hole, u64 Budget)
+{
+    u64 HoleSize = Hole->Size;
+    u64 Moved    = 0;
+    
+    header_t Dst = Hole;
+    header_t Src = header_next(Hole);
+    
+    while ((void*)Src < Memory->Brkp && Src->Used && Src->Movable && Moved < Budget)
+    {
+        u64 BlockSize = HEADER_SIZE + Src->Size;
+        memmove(Dst, Src, BlockSize);
+        // The block before a free block is always used
+        Dst->PrevFree = 0;
+        
+        u64 *Slot = (u64*)header_to_mem(Dst);
+        Memory->Handles[*Slot].Ptr = Slot + 1;
+        
+        Moved += BlockSize;
+        Dst = header_next(Dst);
+        Src = (header_t)((char*)Dst + HEADER_SIZE + HoleSize);
+    }
+    
+    Dst->Size     = HoleSize;
+    Dst->Tag      = MemoryTag_Untagged;
+    Dst->Movable  = 0;
+    Dst->Used     = 0;
+    Dst->PrevFree = 0;
+    memory_block_coalesce(Memory, Dst);
+    
+    return Moved;
+}
+
+u64 memory_compact(memory *Memory, u64 Budget)
+{
+    if (!Memory->MovableCount) return 0;
+    
+    u64 Moved = 0;
+    
+    spin_lock_acquire(&Memory->Lock);
+    
+    while (Moved < Budget)
+    {
+        // Find any free block with a movable block right after it.
+        // This walks every free list, which is fine for the
+        // few thousand free blocks a fragmented heap ends up with.
+        header_t Hole = NULL;
+        
+        u64 FlBitmap = Memory->FlBitmap;
+        while (FlBitmap && !Hole)
+        {
+            u32 Fl = memory_ctzl(FlBitmap);
+            FlBitmap &= FlBitmap - 1;
+            
+            u32 SlBitmap = Memory->SlBitmap[Fl];
+            while (SlBitmap && !Hole)
+            {
+                u32 Sl = memory_ctz(SlBitmap);
+                SlBitmap &= SlBitmap - 1;
+                
+                for (header_t Free = Memory->FreeLists[Fl][Sl]; Free; Free = Free->Next)
+                {
+                    header_t Next = header_next(Free);
+                    if ((void*)Next < Memory->Brkp && Next->Used && Next->Movable)
+                    {
+                        Hole = Free;
+                        break;
+                    }
+                }
+            }
+        }
+        
+        if (!Hole) break;
+        
+        memory_free_list_remove(Memory, Hole);
+        Moved += memory_compact_chain(Memory, Hole, Budget - Moved);
+    }
+    
+    spin_lock_release(&Memory->Lock);
+    
+    return Moved;
+}
+
+#undef handle_generation
+#undef handle_index
+#undef handle_make
+
+//~ Statistics
+
+file_internal u32 memory_histogram_bucket(u64 Size)
+{
+    u32 Bucket = memory_flsl(Size);
+    Bucket = (Bucket < 4) ? 0 : Bucket - 4;
+    
+    return (Bucket < MEMORY_HISTOGRAM_BUCKET_COUNT) ? Bucket : MEMORY_HISTOGRAM_BUCKET_COUNT - 1;
+}
+
+file_internal void memory_tag_stats_add(memory *Memory, u32 Tag, u64 Size)
+{
+    memory_tag_stats *Stats = Memory->TagStats + Tag;
+    
+    Stats->LiveBytes += Size;
+    Stats->LiveCount++;
+    Stats->TotalCount++;
+    Stats->Histogram[memory_histogram_bucket(Size)]++;
+    
+    if (Stats->LiveBytes > Stats->PeakBytes) Stats->PeakBytes = Stats->LiveBytes;
+}
+
+file_internal void memory_tag_stats_remove(memory *Memory, u32 Tag, u64 Size)
+{
+    memory_tag_stats *Stats = Memory->TagStats + Tag;
+    
+    Stats->LiveBytes -= Size;
+    Stats->LiveCount--;
+}
+
+const char* memory_tag_name(memory_tag Tag)
+{
+    switch (Tag)
+    {
+        case MemoryTag_Untagged:    return "untagged";
+        case MemoryTag_AssetSys:    return "assetsys";
+        case MemoryTag_Renderer:    return "renderer";
+        case MemoryTag_CommandPool: return "command_pool";
+        case MemoryTag_Mstr:        return "mstr";
+        case MemoryTag_Game:        return "game";
+        case MemoryTag_Strings:     return "strings";
+        default:                    return "unknown";
+    }
+}
+
+void memory_get_report(memory *Memory, memory_report *Report)
+{
+    spin_lock_acquire(&Memory->Lock);
+    
+    Report->Size             = Memory->Size;
+    Report->CommittedMemory  = Memory->Committed;
+    Report->PageSize         = Memory->PageSize;
+    Report->UsedMemory       = Memory->UsedMemory;
+    Report->NumAllocations   = Memory->NumAllocations;
+    Report->FreeMemory       = Memory->FreeMemory;
+    Report->FreeBlockCount   = Memory->FreeBlockCount;
+    Report->LargestFreeBlock = 0;
+    Report->UnusedMemory     = ((char*)Memory->Start + Memory->Size) - (char*)Memory->Brkp;
+    
+    // The largest free block lives in the highest non-empty list, so only
+    // that one list has to be walked.
+    if (Memory->FlBitmap)
+    {
+        u32 Fl = memory_flsl(Memory->FlBitmap);
+        u32 Sl = memory_flsl(Memory->SlBitmap[Fl]);
+        
+        for (header_t Header = Memory->FreeLists[Fl][Sl]; Header; Header = Header->Next)
+        {
+            if (Header->Size > Report->LargestFreeBlock) Report->LargestFreeBlock = Header->Size;
+        }
+    }
+    
+    memcpy(Report->TagStats, Memory->TagStats, sizeof(Report->TagStats));
+    
+    spin_lock_release(&Memory->Lock);
+    
+    Report->Fragmentation = 0.0f;
+    if (Report->FreeMemory)
+    {
+        Report->Fragmentation = 1.0f - (r32)Report->LargestFreeBlock / (r32)Report->FreeMemory;
+    }
+}
+
+file_internal void memory_json_append(char *Buffer, u32 BufferSize, i32 *Offset, const char *Fmt, ...)
+{
+    va_list Args;
+    va_start(Args, Fmt);
+    
+    if (Buffer && (u32)*Offset < BufferSize)
+    {
+        *Offset += vsnprintf(Buffer + *Offset, BufferSize - *Offset, Fmt, Args);
+    }
+    else
+    {
+        *Offset += vsnprintf(NULL, 0, Fmt, Args);
+    }
+    
+    va_end(Args);
+}
+
+i32 memory_report_to_json(memory_report *Report, char *Buffer, u32 BufferSize)
+{
+    i32 Offset = 0;
+    
+    memory_json_append(Buffer, BufferSize, &Offset, 
+                       "{\n"
+                       "    \"size\": %llu,\n"
+                       "    \"committed\": %llu,\n"
+                       "    \"page_size\": %llu,\n"
+                       "    \"used\": %llu,\n"
+                       "    \"allocations\": %llu,\n"
+                       "    \"free\": %llu,\n"
+                       "    \"free_blocks\": %llu,\n"
+                       "    \"largest_free_block\": %llu,\n"
+                       "    \"unused\": %llu,\n"
+                       "    \"fragmentation\": %f,\n",
+                       Report->Size, Report->CommittedMemory, Report->PageSize, Report->UsedMemory, Report->NumAllocations,
+                       Report->FreeMemory, Report->FreeBlockCount, Report->LargestFreeBlock,
+                       Report->UnusedMemory, Report->Fragmentation);
+    
+    // Lower bound of each histogram bucket
+    memory_json_append(Buffer, BufferSize, &Offset, "    \"histogram_buckets\": [");
+    for (u32 Bucket = 0; Bucket < MEMORY_HISTOGRAM_BUCKET_COUNT; ++Bucket)
+    {
+        memory_json_append(Buffer, BufferSize, &Offset, (Bucket) ? ", %llu" : "%llu", 16ULL << Bucket);
+    }
+    memory_json_append(Buffer, BufferSize, &Offset, "],\n");
+    
+    memory_json_append(Buffer, BufferSize, &Offset, "    \"tags\": {\n");
+    for (u32 Tag = 0; Tag < MemoryTag_Count; ++Tag)
+    {
+        memory_tag_stats *Stats = Report->TagStats + Tag;
+        
+        memory_json_append(Buffer, BufferSize, &Offset,
+                           "        \"%s\": { \"live_bytes\": %llu, \"peak_bytes\": %llu, "
+                           "\"live_count\": %llu, \"total_count\": %llu, \"histogram\": [",
+                           memory_tag_name((memory_tag)Tag), Stats->LiveBytes, Stats->PeakBytes,
+                           Stats->LiveCount, Stats->TotalCount);
+        
+        for (u32 Bucket = 0; Bucket < MEMORY_HISTOGRAM_BUCKET_COUNT; ++Bucket)
+        {
+            memory_json_append(Buffer, BufferSize, &Offset, (Bucket) ? ", %llu" : "%llu", Stats->Histogram[Bucket]);
+        }
+        
+        memory_json_append(Buffer, BufferSize, &Offset, (Tag + 1 < MemoryTag_Count) ? "] },\n" : "] }\n");
+    }
+    memory_json_append(Buffer, BufferSize, &Offset, "    }\n}\n");
+    
+    return Offset;
+}
+
+//~ Allocation tracing
+
+#ifdef MAPLE_MEMORY_TRACE
+
+void memory_trace_begin(memory *Memory, memory_trace *Trace, memory_trace_event *Events, u64 Capacity)
+{
+    Trace->Events       = Events;
+    Trace->Capacity     = Capacity;
+    Trace->Count        = 0;
+    Trace->DroppedCount = 0;
+    
+    spin_lock_acquire(&Memory->Lock);
+    Memory->Trace = Trace;
+    spin_lock_release(&Memory->Lock);
+}
+
+void memory_trace_end(memory *Memory)
+{
+    spin_lock_acquire(&Memory->Lock);
+    Memory->Trace = NULL;
+    spin_lock_release(&Memory->Lock);
+}
+
+// Called with the heap lock held, so events are in the order the heap saw them
+file_internal void memory_trace_record(memory *Memory, u32 Op, u32 Tag, u64 Alignment,
+                                       void *Ptr, void *Result, u64 Size)
+{
+    memory_trace *Trace = Memory->Trace;
+    if (!Trace) return;
+    
+    if (Trace->Count == Trace->Capacity)
+    {
+        Trace->DroppedCount++;
+        return;
+    }
+    
+    memory_trace_event *Event = Trace->Events + Trace->Count++;
+    Event->Size          = Size;
+    Event->Tag           = Tag;
+    Event->AlignmentLog2 = (Alignment) ? memory_ctzl(Alignment) : 0;
+    Event->Op            = Op;
+    Event->Ptr           = (Ptr)    ? (u64)((char*)Ptr - (char*)Memory->Start)    : 0;
+    Event->Result        = (Result) ? (u64)((char*)Result - (char*)Memory->Start) : 0;
+}
+
+#endif
+
+//~ Thread Cache
+
+#define cache_bin(size)         ((size) >> 3)
+
+void memory_cache_init(memory_cache *Cache, memory *Heap)
+{
+    Cache->Heap = Heap;
+    memset(Cache->Bins, 0, sizeof(Cache->Bins));
+    memset(Cache->BinCounts, 0, sizeof(Cache->BinCounts));
+}
+
+void memory_cache_flush(memory_cache *Cache)
+{
+    spin_lock_acquire(&Cache->Heap->Lock);
+    
+    for (u32 Bin = 0; Bin < MEMORY_CACHE_BIN_COUNT; ++Bin)
+    {
+        void *Block = Cache->Bins[Bin];
+        while (Block)
+        {
+            void *Next = *(void**)Block;
+            memory_heap_release(Cache->Heap, Block);
+            Block = Next;
+        }
+        
+        Cache->Bins[Bin]      = NULL;
+        Cache->BinCounts[Bin] = 0;
+    }
+    
+    spin_lock_release(&Cache->Heap->Lock);
+}
+
+void* memory_cache_alloc(memory_cache *Cache, u64 Size)
+{
+    if (Size == 0) return NULL;
+    
+    Size = mem_align(Size);
+    if (Size < MIN_BLOCK_SIZE) Size = MIN_BLOCK_SIZE;
+    
+    if (Size > MEMORY_CACHE_MAX_SIZE)
+    {
+        return memory_alloc(Cache->Heap, Size);
+    }
+    
+    u32 Bin = cache_bin(Size);
+    if (!Cache->Bins[Bin])
+    {
+        // Refill the bin. Blocks handed out by the heap can be slightly
+        // larger than requested when the leftover is too small to split,
+        // so place each block in the bin that matches its real size.
+        spin_lock_acquire(&Cache->Heap->Lock);
+        for (u32 i = 0; i < MEMORY_CACHE_BATCH_COUNT; ++i)
+        {
+            void *Block = memory_heap_alloc(Cache->Heap, Size, MemoryTag_Untagged);
+            if (!Block) break;
+            
+            u32 BlockBin = cache_bin(((header_t)mem_to_header(Block))->Size);
+            if (BlockBin >= MEMORY_CACHE_BIN_COUNT)
+            {
+                memory_heap_release(Cache->Heap, Block);
+                continue;
+            }
+            
+            *(void**)Block = Cache->Bins[BlockBin];
+            Cache->Bins[BlockBin] = Block;
+            Cache->BinCounts[BlockBin]++;
+        }
+        spin_lock_release(&Cache->Heap->Lock);
+        
+        // The heap could not give out a single block of this exact size
+        if (!Cache->Bins[Bin]) return memory_alloc(Cache->Heap, Size);
+    }
     
-    // When there is an 8 byte allocation, the total allocated size ends up being
-    // 24 bytes, and only 8 bytes are reserved (16 bytes are for the Free List and are
-    // only needed when in the Free List). So if this block were to be allocated again,
-    // there are actually 16 bytes that are usable. This will adjust the header data size
-    // to reflect this extra usable space.
-    if (Header->Size < LIST_HEADER_SIZE)
-        Header->Size = LIST_HEADER_SIZE;
+    void *Result = Cache->Bins[Bin];
+    Cache->Bins[Bin] = *(void**)Result;
+    Cache->BinCounts[Bin]--;
     
-    memory_free_list_add(&Memory->FreeList, Header);
+    return Result;
+}
+
+void memory_cache_release(memory_cache *Cache, void *Ptr)
+{
+    if (!Ptr) return;
+    
+    // The header is read without the heap lock. The Size of a used
+    // block is only ever changed by its owner, a neighbour can flip PrevFree
+    // while holding the lock but that rewrites the word with the same Size.
+    header_t Header = mem_to_header(Ptr);
+    if (Header->Size > MEMORY_CACHE_MAX_SIZE)
+    {
+        memory_release(Cache->Heap, Ptr);
+        return;
+    }
+    
+    u32 Bin = cache_bin(Header->Size);
+    *(void**)Ptr = Cache->Bins[Bin];
+    Cache->Bins[Bin] = Ptr;
+    Cache->BinCounts[Bin]++;
+    
+    // Give half of the bin back so a thread that only frees does not
+    // hoard the heap.
+    if (Cache->BinCounts[Bin] > MEMORY_CACHE_BIN_MAX)
+    {
+        spin_lock_acquire(&Cache->Heap->Lock);
+        while (Cache->BinCounts[Bin] > MEMORY_CACHE_BATCH_COUNT)
+        {
+            void *Block = Cache->Bins[Bin];
+            Cache->Bins[Bin] = *(void**)Block;
+            Cache->BinCounts[Bin]--;
+            
+            memory_heap_release(Cache->Heap, Block);
+        }
+        spin_lock_release(&Cache->Heap->Lock);
+    }
 }
 
+#ifndef MAPLE_MEMORY_TRACE
+#undef memory_trace_record
+#endif
+#undef cache_bin
+#undef header_prev
+#undef header_footer
+#undef header_next
 #undef mem_to_header
 #undef header_to_mem
-#undef header_adjusted_size
 #undef mem_align
-#undef LIST_HEADER_SIZE
-#undef MIN_LINK_SIZE
+#undef SMALL_BLOCK_SIZE
+#undef MIN_BLOCK_SIZE
 #undef HEADER_SIZE
 #undef BLOCK_SIZE
@@ -3,25 +3,259 @@
 
 typedef struct header* header_t;
 
+// Free blocks are binned into segregated size classes using a two level
+// bitmap (TLSF). The first level splits sizes into power of two ranges,
+// the second level linearly subdivides each range. A set bit in a bitmap
+// means the matching list has at least one free block, so finding a fit
+// is a couple of bit scans rather than a list walk.
+#define MEMORY_SL_INDEX_COUNT_LOG2 4
+#define MEMORY_SL_INDEX_COUNT      (1 << MEMORY_SL_INDEX_COUNT_LOG2)
+#define MEMORY_FL_INDEX_MAX        40 // largest block class is 1TB
+#define MEMORY_FL_INDEX_SHIFT      (MEMORY_SL_INDEX_COUNT_LOG2 + 3)
+#define MEMORY_FL_INDEX_COUNT      (MEMORY_FL_INDEX_MAX - MEMORY_FL_INDEX_SHIFT + 1)
+
+// Subsystem an allocation belongs to. Stored in the block header, so it
+// costs nothing per allocation. Must fit in 6 bits.
+typedef enum memory_tag
+{
+    MemoryTag_Untagged,
+    MemoryTag_AssetSys,
+    MemoryTag_Renderer,
+    MemoryTag_CommandPool,
+    MemoryTag_Mstr,
+    MemoryTag_Game,
+    MemoryTag_Strings,
+    
+    MemoryTag_Count,
+} memory_tag;
+
+// Allocation sizes are bucketed by power of two, starting at 16 bytes.
+// The last bucket holds everything from 512KB up.
+#define MEMORY_HISTOGRAM_BUCKET_COUNT 16
+
+typedef struct memory_tag_stats
+{
+    u64 LiveBytes;
+    u64 PeakBytes;
+    u64 LiveCount;
+    u64 TotalCount; // Allocations made over the lifetime of the heap
+    
+    u64 Histogram[MEMORY_HISTOGRAM_BUCKET_COUNT];
+} memory_tag_stats;
+
+// Hooks used by heaps that are backed by reserved virtual memory. Match the
+// platform's commit/decommit functions so they can be passed in directly.
+typedef bool (*pfn_memory_commit)(void *Ptr, u64 Size);
+typedef void (*pfn_memory_decommit)(void *Ptr, u64 Size);
+
+// Pages are committed/decommitted in chunks of this size
+#define MEMORY_COMMIT_GRANULARITY _KB(64)
+// Trailing free memory is only decommitted once this much is committed past
+// the break point, so a heap hovering around a chunk boundary does not thrash.
+#define MEMORY_DECOMMIT_THRESHOLD _MB(1)
+
+// Handle to a movable allocation: generation in the high 32 bits, slot in the
+// table in the low 32 bits. 0 is never a valid handle.
+typedef u64 memory_handle;
+
+typedef struct memory_handle_entry
+{
+    void *Ptr;        // NULL while the slot is free
+    u32   Generation; // Bumped every time the slot is released
+    u32   NextFree;   // Free list link, 0 ends the list
+} memory_handle_entry;
+
 typedef struct memory
 {
-    u64   Size;
+    // Spin lock guarding the heap, every heap call takes it.
+    spin_lock Lock;
     
+    u64   Size;      // Reserved size for a virtual heap
+    u64   Committed; // Bytes backed by memory, starting at Start
+    u64   PageSize;  // Large page size when backed by large pages, 0 for regular pages
+
     void *Start;
     void *Brkp;
-    
-    header_t FreeList;
-    
+
+    pfn_memory_commit   Commit;   // NULL if the heap is fully committed
+    pfn_memory_decommit Decommit;
+
+    // Only written to in MAPLE_MEMORY_TRACE builds, but always part of the
+    // struct so that binaries built with and without tracing agree on the layout.
+    struct memory_trace *Trace;
+
+    // Indirection table for movable allocations. Slot 0 is never used.
+    memory_handle_entry *Handles;
+    u32 HandleCapacity;
+    u32 HandleBrkp;     // Slots past this have never been handed out
+    u32 HandleFreeList;
+    u32 MovableCount;   // Live movable blocks, compaction is skipped when 0
+
+    // Segregated free lists
+    u64      FlBitmap;
+    u32      SlBitmap[MEMORY_FL_INDEX_COUNT];
+    header_t FreeLists[MEMORY_FL_INDEX_COUNT][MEMORY_SL_INDEX_COUNT];
+
     // Memory Usage tracking
     u64 NumAllocations;
     u64 UsedMemory;
+    u64 FreeMemory;     // Bytes sitting in the free lists
+    u64 FreeBlockCount;
+    
+    memory_tag_stats TagStats[MemoryTag_Count];
 } memory;
 
+// Snapshot of a heap, cheap enough to query every frame.
+typedef struct memory_report
+{
+    u64 Size;
+    u64 CommittedMemory;
+    u64 PageSize;
+    u64 UsedMemory;
+    u64 NumAllocations;
+    
+    u64 FreeMemory;
+    u64 FreeBlockCount;
+    u64 LargestFreeBlock;
+    u64 UnusedMemory;   // Never touched memory past the break point
+    
+    // 0 when all free memory is one block, approaches 1 as the
+    // free memory is split into many small blocks.
+    r32 Fragmentation;
+    
+    memory_tag_stats TagStats[MemoryTag_Count];
+} memory_report;
+
 void memory_init(memory *Memory, u64 Size, void *Ptr);
+// Ptr is a reserved, uncommitted range of Size bytes. Pages are committed as
+// the heap grows and trailing pages are decommitted when the heap shrinks.
+void memory_init_virtual(memory *Memory, u64 Size, void *Ptr,
+                         pfn_memory_commit Commit, pfn_memory_decommit Decommit);
 void memory_free(memory *Memory);
 
 void* memory_alloc(memory *Memory, u64 Size);
+void* memory_alloc_tagged(memory *Memory, u64 Size, memory_tag Tag);
+// Alignment must be a power of two. The block is released through memory_release
+// like any other, but memory_realloc does not preserve the alignment.
+void* memory_alloc_aligned(memory *Memory, u64 Size, u64 Alignment);
+void* memory_alloc_aligned_tagged(memory *Memory, u64 Size, u64 Alignment, memory_tag Tag);
+// The block keeps its tag when resized
 void* memory_realloc(memory *Memory, void *Ptr, u64 Size);
 void memory_release(memory *Memory, void *Ptr);
 
+const char* memory_tag_name(memory_tag Tag);
+void memory_get_report(memory *Memory, memory_report *Report);
+// Formats the report as JSON. Same behavior as snprintf: returns the number of
+// chars the full report needs, excluding the null terminator.
+i32 memory_report_to_json(memory_report *Report, char *Buffer, u32 BufferSize);
+
+//~ Movable allocations
+//
+// Long lived data that is only ever reached through a handle (mesh CPU copies,
+// large strings, asset buffers) can be allocated as movable. memory_compact
+// slides movable blocks down into the free blocks below them, so the holes
+// left behind by released allocations bubble up towards the break point and
+// are handed back to it, instead of fragmenting the heap forever.
+//
+// Pointers returned by memory_handle_get are valid until the next call to
+// memory_compact. memory_handle_get does not take the heap lock, so it must
+// not race with memory_compact. Movable blocks must be released through
+// memory_release_movable and cannot be passed to memory_realloc.
+
+// Capacity is the most movable blocks that can be alive at once. The table
+// is allocated from the heap itself.
+void memory_handle_table_init(memory *Memory, u32 Capacity);
+void memory_handle_table_free(memory *Memory);
+
+// Returns 0 if the heap or the handle table is full
+memory_handle memory_alloc_movable(memory *Memory, u64 Size, memory_tag Tag);
+// Returns NULL if the handle has been released
+void* memory_handle_get(memory *Memory, memory_handle Handle);
+void memory_release_movable(memory *Memory, memory_handle Handle);
+
+// Moves at most Budget bytes of movable blocks towards the start of the heap.
+// Meant to be called once per frame. Returns the number of bytes moved.
+u64 memory_compact(memory *Memory, u64 Budget);
+
+//~ Allocation tracing
+//
+// Builds with MAPLE_MEMORY_TRACE defined append every call into the public heap
+// api (alloc, realloc, release) to the heap's trace while one is attached.
+// Blocks are recorded as offsets from the start of the heap, so a trace can be
+// replayed against any allocator by maple_alloc_bench.
+
+typedef enum memory_trace_op
+{
+    MemoryTraceOp_Alloc,
+    MemoryTraceOp_AllocAligned,
+    MemoryTraceOp_Realloc,
+    MemoryTraceOp_Release,
+} memory_trace_op;
+
+typedef struct memory_trace_event
+{
+    u64 Size:48;
+    u64 Tag:6;
+    u64 AlignmentLog2:6; // MemoryTraceOp_AllocAligned only
+    u64 Op:4;            // memory_trace_op
+    
+    u64 Ptr;    // Block passed in (realloc, release). 0 for NULL
+    u64 Result; // Block handed back (alloc, realloc). 0 for NULL
+} memory_trace_event;
+
+#define MEMORY_TRACE_MAGIC   0x4352544D // "MTRC"
+#define MEMORY_TRACE_VERSION 1
+
+// A trace file is this header followed by EventCount events
+typedef struct memory_trace_file_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 HeapSize;
+    u64 EventCount;
+    u64 DroppedCount;
+} memory_trace_file_header;
+
+typedef struct memory_trace
+{
+    memory_trace_event *Events;
+    u64                 Capacity;
+    u64                 Count;
+    // Events recorded after the trace filled up. A trace that dropped
+    // events cannot be replayed faithfully.
+    u64                 DroppedCount;
+} memory_trace;
+
+#ifdef MAPLE_MEMORY_TRACE
+// The event buffer must not come from the heap being traced
+void memory_trace_begin(memory *Memory, memory_trace *Trace, memory_trace_event *Events, u64 Capacity);
+void memory_trace_end(memory *Memory);
+#endif
+
+// Per-thread cache of small blocks sitting in front of a shared heap. Each
+// thread owns its own cache, so the fast path never touches the heap lock.
+// Empty bins are refilled from the heap in batches and full bins return
+// half of their blocks, so the lock is taken once per batch rather than
+// once per allocation. Blocks in a cache are still "used" as far as the
+// heap is concerned and can be released through any cache or the heap.
+#define MEMORY_CACHE_MAX_SIZE     256
+#define MEMORY_CACHE_BIN_COUNT    (MEMORY_CACHE_MAX_SIZE / 8 + 1)
+#define MEMORY_CACHE_BATCH_COUNT  32
+#define MEMORY_CACHE_BIN_MAX      (2 * MEMORY_CACHE_BATCH_COUNT)
+
+typedef struct memory_cache
+{
+    memory *Heap;
+    
+    void   *Bins[MEMORY_CACHE_BIN_COUNT]; // blocks are linked through their data
+    u32     BinCounts[MEMORY_CACHE_BIN_COUNT];
+} memory_cache;
+
+void memory_cache_init(memory_cache *Cache, memory *Heap);
+// Returns every cached block to the heap. Must be called before the thread exits.
+void memory_cache_flush(memory_cache *Cache);
+
+void* memory_cache_alloc(memory_cache *Cache, u64 Size);
+void memory_cache_release(memory_cache *Cache, void *Ptr);
+
 #endif //MEMORY_H
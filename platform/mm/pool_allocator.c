@@ -0,0 +1,122 @@
+#define pool_align(n)           (((n) + sizeof(void*) - 1) & ~(u64)(sizeof(void*) - 1))
+
+u64 pool_allocator_size(u64 ElementSize, u32 Capacity, bool TrackGenerations)
+{
+    u64 Result = pool_align(ElementSize) * Capacity;
+    if (TrackGenerations) Result += sizeof(u32) * Capacity;
+    
+    return Result;
+}
+
+void pool_allocator_init(pool_allocator *Pool, u64 ElementSize, u32 Capacity, bool TrackGenerations, void *Ptr)
+{
+    // A free slot has to be able to hold the free list link
+    if (ElementSize < sizeof(void*)) ElementSize = sizeof(void*);
+    
+    Pool->ElementSize    = pool_align(ElementSize);
+    Pool->Capacity       = Capacity;
+    Pool->Start          = Ptr;
+    Pool->FreeList       = NULL;
+    Pool->Brkp           = 0;
+    Pool->Generations    = NULL;
+    Pool->NumAllocations = 0;
+    
+    if (!Ptr)
+    {
+        Pool->Capacity = 0;
+    }
+    else if (TrackGenerations)
+    {
+        Pool->Generations = (u32*)((char*)Ptr + Pool->ElementSize * Capacity);
+        memset(Pool->Generations, 0, sizeof(u32) * Capacity);
+    }
+}
+
+void pool_allocator_free(pool_allocator *Pool)
+{
+    if (Pool->NumAllocations != 0)
+    {
+        printf("Freeing Pool allocator, but not all memory has been freed. There are still %d allocations.\n",
+               Pool->NumAllocations);
+    }
+    
+    Pool->ElementSize    = 0;
+    Pool->Capacity       = 0;
+    Pool->Start          = NULL;
+    Pool->FreeList       = NULL;
+    Pool->Brkp           = 0;
+    Pool->Generations    = NULL;
+    Pool->NumAllocations = 0;
+}
+
+void* pool_alloc(pool_allocator *Pool)
+{
+    void *Result = NULL;
+    
+    if (Pool->FreeList)
+    {
+        Result = Pool->FreeList;
+        Pool->FreeList = *(void**)Result;
+    }
+    else if (Pool->Brkp < Pool->Capacity)
+    {
+        Result = (char*)Pool->Start + Pool->ElementSize * Pool->Brkp;
+        Pool->Brkp++;
+    }
+    else
+    {
+        mprinte("Pool allocator is full! Capacity is %u elements.\n", Pool->Capacity);
+    }
+    
+    if (Result)
+    {
+        if (Pool->Generations) Pool->Generations[pool_index(Pool, Result)]++;
+        Pool->NumAllocations++;
+    }
+    
+    return Result;
+}
+
+void pool_release(pool_allocator *Pool, void *Ptr)
+{
+    if (!Ptr) return;
+    
+    assert((char*)Ptr >= (char*)Pool->Start && 
+           (char*)Ptr <  (char*)Pool->Start + Pool->ElementSize * Pool->Brkp);
+    
+    if (Pool->Generations)
+    {
+        u32 Index = pool_index(Pool, Ptr);
+        assert(Pool->Generations[Index] & 1 && "Double free of a pool element!");
+        Pool->Generations[Index]++;
+    }
+    
+    *(void**)Ptr = Pool->FreeList;
+    Pool->FreeList = Ptr;
+    
+    Pool->NumAllocations--;
+}
+
+u32 pool_index(pool_allocator *Pool, void *Ptr)
+{
+    return (u32)(((char*)Ptr - (char*)Pool->Start) / Pool->ElementSize);
+}
+
+void* pool_get(pool_allocator *Pool, u32 Index)
+{
+    return (char*)Pool->Start + Pool->ElementSize * Index;
+}
+
+bool pool_is_live(pool_allocator *Pool, u32 Index)
+{
+    assert(Pool->Generations);
+    return Index < Pool->Brkp && (Pool->Generations[Index] & 1);
+}
+
+u32 pool_generation(pool_allocator *Pool, void *Ptr)
+{
+    assert(Pool->Generations);
+    return Pool->Generations[pool_index(Pool, Ptr)];
+}
+
+#undef pool_align
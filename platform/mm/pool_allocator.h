@@ -0,0 +1,47 @@
+#ifndef ENGINE_MM_POOL_ALLOCATOR_H
+#define ENGINE_MM_POOL_ALLOCATOR_H
+
+// A fixed size pool of equally sized elements stored contiguously. Free
+// slots are chained through their own memory, so alloc and release are a
+// list pop/push. Slots that have never been handed out are taken from the
+// end of the used range, so initializing a pool is O(1).
+//
+// When generations are tracked, every slot has a counter that is bumped on
+// alloc and on release. An odd generation means the slot is live, which
+// allows iterating the pool and detecting stale handles.
+typedef struct pool_allocator
+{
+    u64   ElementSize; // Stride between elements
+    u32   Capacity;
+    
+    void *Start;
+    void *FreeList;
+    u32   Brkp;        // Index of the first never used slot
+    
+    u32  *Generations; // NULL if generations are not tracked
+    
+    // Memory Usage tracking
+    u32   NumAllocations;
+} pool_allocator;
+
+// Size of the memory that needs to be passed to pool_allocator_init
+u64 pool_allocator_size(u64 ElementSize, u32 Capacity, bool TrackGenerations);
+
+void pool_allocator_init(pool_allocator *Pool, u64 ElementSize, u32 Capacity, bool TrackGenerations, void *Ptr);
+void pool_allocator_free(pool_allocator *Pool);
+
+// Returns NULL if the pool is full
+void* pool_alloc(pool_allocator *Pool);
+void pool_release(pool_allocator *Pool, void *Ptr);
+
+u32 pool_index(pool_allocator *Pool, void *Ptr);
+void* pool_get(pool_allocator *Pool, u32 Index);
+
+// Requires generations to be tracked. Use to iterate the pool:
+//
+// for (u32 i = 0; i < Pool->Brkp; ++i)
+//     if (pool_is_live(Pool, i)) foo(pool_get(Pool, i));
+bool pool_is_live(pool_allocator *Pool, u32 Index);
+u32 pool_generation(pool_allocator *Pool, void *Ptr);
+
+#endif //ENGINE_MM_POOL_ALLOCATOR_H
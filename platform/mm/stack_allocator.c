@@ -0,0 +1,88 @@
+#define stack_align(n)          (((n) + STACK_ALLOCATOR_ALIGNMENT - 1) & ~(u64)(STACK_ALLOCATOR_ALIGNMENT - 1))
+
+void stack_allocator_init(stack_allocator *Stack, u64 Size, void *Ptr)
+{
+    Stack->Size      = 0;
+    Stack->Start     = NULL;
+    Stack->Bottom    = NULL;
+    Stack->Top       = NULL;
+    Stack->HighWater = 0;
+    
+    if (Ptr)
+    {
+        // Keep both ends aligned, so aligning the size keeps every allocation aligned
+        char *Start = (char*)stack_align((u64)Ptr);
+        char *End   = (char*)(((u64)Ptr + Size) & ~(u64)(STACK_ALLOCATOR_ALIGNMENT - 1));
+        
+        Stack->Size   = End - Start;
+        Stack->Start  = Start;
+        Stack->Bottom = Start;
+        Stack->Top    = End;
+    }
+}
+
+void stack_allocator_free(stack_allocator *Stack)
+{
+    Stack->Size      = 0;
+    Stack->Start     = NULL;
+    Stack->Bottom    = NULL;
+    Stack->Top       = NULL;
+    Stack->HighWater = 0;
+}
+
+void* stack_alloc(stack_allocator *Stack, u64 Size, stack_side Side)
+{
+    if (Size == 0) return NULL;
+    
+    void *Result = NULL;
+    
+    Size = stack_align(Size);
+    
+    if ((u64)((char*)Stack->Top - (char*)Stack->Bottom) >= Size)
+    {
+        if (Side == StackSide_Bottom)
+        {
+            Result = Stack->Bottom;
+            Stack->Bottom = (char*)Stack->Bottom + Size;
+        }
+        else
+        {
+            Stack->Top = (char*)Stack->Top - Size;
+            Result = Stack->Top;
+        }
+        
+        u64 Used = Stack->Size - ((char*)Stack->Top - (char*)Stack->Bottom);
+        if (Used > Stack->HighWater) Stack->HighWater = Used;
+    }
+    else
+    {
+        mprinte("Stack allocator is out of memory! Requested %llu bytes.\n", Size);
+    }
+    
+    return Result;
+}
+
+stack_marker stack_get_marker(stack_allocator *Stack, stack_side Side)
+{
+    stack_marker Result;
+    Result.Side = Side;
+    Result.Ptr  = (Side == StackSide_Bottom) ? Stack->Bottom : Stack->Top;
+    
+    return Result;
+}
+
+void stack_free_to_marker(stack_allocator *Stack, stack_marker Marker)
+{
+    if (Marker.Side == StackSide_Bottom)
+    {
+        assert(Marker.Ptr <= Stack->Bottom && "Stack marker is above the bottom of the stack!");
+        Stack->Bottom = Marker.Ptr;
+    }
+    else
+    {
+        assert(Marker.Ptr >= Stack->Top && "Stack marker is below the top of the stack!");
+        Stack->Top = Marker.Ptr;
+    }
+}
+
+#undef stack_align
@@ -0,0 +1,45 @@
+#ifndef ENGINE_MM_STACK_ALLOCATOR_H
+#define ENGINE_MM_STACK_ALLOCATOR_H
+
+#define STACK_ALLOCATOR_ALIGNMENT 16
+
+typedef enum stack_side
+{
+    StackSide_Bottom, // Persistent data
+    StackSide_Top,    // Temporaries
+} stack_side;
+
+// A double ended stack. Long lived data is allocated from the bottom and
+// temporaries from the top, so throwing the temporaries away never leaves
+// holes between the long lived allocations. Memory is released by rewinding
+// a side to a marker rather than per allocation.
+typedef struct stack_allocator
+{
+    u64   Size;
+    
+    void *Start;
+    void *Bottom; // Grows up
+    void *Top;    // Grows down
+    
+    // Memory Usage tracking
+    u64   HighWater; // Most memory used by both sides at once
+} stack_allocator;
+
+typedef struct stack_marker
+{
+    stack_side Side;
+    void      *Ptr;
+} stack_marker;
+
+void stack_allocator_init(stack_allocator *Stack, u64 Size, void *Ptr);
+void stack_allocator_free(stack_allocator *Stack);
+
+// Returns NULL if the two sides would overlap
+void* stack_alloc(stack_allocator *Stack, u64 Size, stack_side Side);
+
+// A marker saves the current position of one side. Freeing to the marker
+// releases everything allocated from that side since the marker was taken.
+stack_marker stack_get_marker(stack_allocator *Stack, stack_side Side);
+void stack_free_to_marker(stack_allocator *Stack, stack_marker Marker);
+
+#endif //ENGINE_MM_STACK_ALLOCATOR_H
@@ -0,0 +1,128 @@
+#define tagged_align(n)         (((n) + TAGGED_HEAP_ALIGNMENT - 1) & ~(u64)(TAGGED_HEAP_ALIGNMENT - 1))
+#define tagged_block(h, i)      ((char*)(h)->Start + (u64)(i) * TAGGED_HEAP_BLOCK_SIZE)
+
+void tagged_heap_init(tagged_heap *Heap, u64 Size, void *Ptr)
+{
+    Heap->Lock       = 0;
+    Heap->Start      = Ptr;
+    Heap->BlockCount = 0;
+    Heap->FreeCount  = 0;
+    Heap->HighWater  = 0;
+    
+    if (Ptr)
+    {
+        u64 BlockCount = Size / TAGGED_HEAP_BLOCK_SIZE;
+        if (BlockCount > TAGGED_HEAP_MAX_BLOCKS) BlockCount = TAGGED_HEAP_MAX_BLOCKS;
+        
+        Heap->BlockCount = (u32)BlockCount;
+        Heap->FreeCount  = (u32)BlockCount;
+        
+        // Lowest blocks are handed out first
+        for (u32 i = 0; i < Heap->BlockCount; ++i)
+        {
+            Heap->FreeBlocks[i] = Heap->BlockCount - i - 1;
+            Heap->Tags[i]       = TaggedHeapTag_None;
+        }
+    }
+}
+
+void tagged_heap_free(tagged_heap *Heap)
+{
+    if (Heap->FreeCount != Heap->BlockCount)
+    {
+        printf("Freeing Tagged Heap, but not all blocks have been released. There are still %d blocks in use.\n",
+               Heap->BlockCount - Heap->FreeCount);
+    }
+    
+    Heap->Start      = NULL;
+    Heap->BlockCount = 0;
+    Heap->FreeCount  = 0;
+    Heap->HighWater  = 0;
+}
+
+void* tagged_heap_request_block(tagged_heap *Heap, u64 Tag)
+{
+    assert(Tag != TaggedHeapTag_None);
+    
+    void *Result = NULL;
+    
+    spin_lock_acquire(&Heap->Lock);
+    
+    if (Heap->FreeCount)
+    {
+        u32 Block = Heap->FreeBlocks[--Heap->FreeCount];
+        Heap->Tags[Block] = Tag;
+        
+        u32 Used = Heap->BlockCount - Heap->FreeCount;
+        if (Used > Heap->HighWater) Heap->HighWater = Used;
+        
+        Result = tagged_block(Heap, Block);
+    }
+    
+    spin_lock_release(&Heap->Lock);
+    
+    if (!Result)
+    {
+        mprinte("Tagged Heap is out of blocks! All %u blocks are in use.\n", Heap->BlockCount);
+    }
+    
+    return Result;
+}
+
+void tagged_heap_release_tag(tagged_heap *Heap, u64 Tag)
+{
+    assert(Tag != TaggedHeapTag_None);
+    
+    spin_lock_acquire(&Heap->Lock);
+    
+    // There are at most a few hundred blocks, so walking the
+    // owners is cheaper than keeping a list per tag.
+    for (u32 Block = 0; Block < Heap->BlockCount; ++Block)
+    {
+        if (Heap->Tags[Block] == Tag)
+        {
+            Heap->Tags[Block] = TaggedHeapTag_None;
+            Heap->FreeBlocks[Heap->FreeCount++] = Block;
+        }
+    }
+    
+    spin_lock_release(&Heap->Lock);
+}
+
+void tag_block_init(tag_block *Block, tagged_heap *Heap, u64 Tag)
+{
+    Block->Heap  = Heap;
+    Block->Tag   = Tag;
+    Block->Start = NULL;
+    Block->Brkp  = NULL;
+}
+
+void* tag_block_alloc(tag_block *Block, u64 Size)
+{
+    if (Size == 0) return NULL;
+    
+    // Blocks are aligned, so aligning the size keeps every allocation aligned
+    Size = tagged_align(Size);
+    if (Size > TAGGED_HEAP_BLOCK_SIZE)
+    {
+        mprinte("Tag block allocations have to fit in a single block! Requested %llu bytes.\n", Size);
+        return NULL;
+    }
+    
+    if (!Block->Start || (char*)Block->Brkp + Size > (char*)Block->Start + TAGGED_HEAP_BLOCK_SIZE)
+    {
+        void *NewBlock = tagged_heap_request_block(Block->Heap, Block->Tag);
+        if (!NewBlock) return NULL;
+        
+        Block->Start = NewBlock;
+        Block->Brkp  = NewBlock;
+    }
+    
+    void *Result = Block->Brkp;
+    Block->Brkp = (char*)Block->Brkp + Size;
+    
+    return Result;
+}
+
+#undef tagged_block
+#undef tagged_align
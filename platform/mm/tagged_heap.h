@@ -0,0 +1,68 @@
+#ifndef ENGINE_MM_TAGGED_HEAP_H
+#define ENGINE_MM_TAGGED_HEAP_H
+
+// A heap of fixed size blocks where every block is owned by a tag. Memory is
+// never freed per allocation. Instead, every block owned by a tag is returned
+// in one go when the tag is retired, so data with a shared lifetime (a level,
+// a frame, a loader job) never touches the free lists of the general heap.
+#define TAGGED_HEAP_BLOCK_SIZE _2MB
+#define TAGGED_HEAP_MAX_BLOCKS 512   // 1GB
+#define TAGGED_HEAP_ALIGNMENT  16
+
+// Tags are plain integers, anything other than TaggedHeapTag_None can be used.
+// Frames get a tag per frame slot, see tagged_heap_frame_tag.
+typedef enum tagged_heap_tag
+{
+    TaggedHeapTag_None,     // Block is free
+    TaggedHeapTag_Platform, // Formatting scratch for print functions
+    TaggedHeapTag_Level,
+    TaggedHeapTag_Loader,
+    TaggedHeapTag_Frame,
+} tagged_heap_tag;
+
+#define tagged_heap_frame_tag(FrameIndex) ((u64)TaggedHeapTag_Frame + (u64)(FrameIndex))
+
+typedef struct tagged_heap
+{
+    // Spin lock guarding the block lists, blocks can be requested from any thread.
+    spin_lock Lock;
+    
+    void *Start;
+    u32   BlockCount;
+    
+    u32   FreeCount;
+    u32   FreeBlocks[TAGGED_HEAP_MAX_BLOCKS]; // Stack of free block indices
+    u64   Tags[TAGGED_HEAP_MAX_BLOCKS];       // Owner of each block
+    
+    // Memory Usage tracking
+    u32   HighWater; // Most blocks in use at once
+} tagged_heap;
+
+// Size is rounded down to a multiple of TAGGED_HEAP_BLOCK_SIZE. Ptr should be
+// aligned to at least TAGGED_HEAP_ALIGNMENT.
+void tagged_heap_init(tagged_heap *Heap, u64 Size, void *Ptr);
+void tagged_heap_free(tagged_heap *Heap);
+
+// Returns a block of TAGGED_HEAP_BLOCK_SIZE bytes owned by Tag, or NULL if
+// every block is in use.
+void* tagged_heap_request_block(tagged_heap *Heap, u64 Tag);
+// Returns every block owned by Tag to the heap.
+void tagged_heap_release_tag(tagged_heap *Heap, u64 Tag);
+
+// A bump pointer allocator over the blocks of a single tag. A new block is
+// requested whenever the current one fills up. Allocations have to fit in a
+// single block. Once the tag is released, the tag_block has to be
+// initialized again before it is used.
+typedef struct tag_block
+{
+    tagged_heap *Heap;
+    u64          Tag;
+    
+    void        *Start; // Current block, NULL until the first allocation
+    void        *Brkp;
+} tag_block;
+
+void tag_block_init(tag_block *Block, tagged_heap *Heap, u64 Tag);
+void* tag_block_alloc(tag_block *Block, u64 Size);
+
+#endif //ENGINE_MM_TAGGED_HEAP_H
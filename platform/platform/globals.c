@@ -1,12 +1,45 @@
 
 globals *Core;
 
+// Mount names, file and directory names in the asset tree, shader names...
+#define GLOBALS_STRING_TABLE_CAPACITY (1 << 16)
+
+#ifdef MAPLE_MEMORY_TRACE
+// ~400MB of events. Anything recorded past this is dropped.
+#define GLOBALS_MEMORY_TRACE_CAPACITY (1 << 24)
+#endif
+
 void globals_init(globals_create_info *CreateInfo)
 {
-    void *PlatformMemory = PlatformRequestMemory(CreateInfo->Memory.Size);
-    
     memory Memory = {0};
-    memory_init(&Memory, CreateInfo->Memory.Size, PlatformMemory);
+    void *PlatformMemory = NULL;
+    
+    if (CreateInfo->Memory.LargePages)
+    {
+        PlatformMemory = PlatformRequestLargeMemory(CreateInfo->Memory.LargePageHeapSize);
+        if (PlatformMemory)
+        {
+            memory_init(&Memory, CreateInfo->Memory.LargePageHeapSize, PlatformMemory);
+            Memory.PageSize = PlatformGetLargePageSize();
+        }
+    }
+    
+    if (!PlatformMemory)
+    {
+        // Only the address space is reserved up front. The heap commits pages
+        // as it grows, so Size is an upper bound rather than a cost.
+        PlatformMemory = PlatformReserveMemory(CreateInfo->Memory.Size);
+        memory_init_virtual(&Memory, CreateInfo->Memory.Size, PlatformMemory,
+                            PlatformCommitMemory, PlatformDecommitMemory);
+    }
+    
+#ifdef MAPLE_MEMORY_TRACE
+    // Traced from the very first allocation, so every release in the trace has
+    // a matching alloc. The trace lives outside of the heap it is recording.
+    memory_trace *Trace = (memory_trace*)PlatformRequestMemory(sizeof(memory_trace) +
+                                                               GLOBALS_MEMORY_TRACE_CAPACITY * sizeof(memory_trace_event));
+    memory_trace_begin(&Memory, Trace, (memory_trace_event*)(Trace + 1), GLOBALS_MEMORY_TRACE_CAPACITY);
+#endif
     
     memory *pMemory = (memory*)memory_alloc(&Memory, sizeof(memory));
     *pMemory = Memory;
@@ -14,28 +47,124 @@ void globals_init(globals_create_info *CreateInfo)
     Core = (globals*)memory_alloc(pMemory, sizeof(globals));
     Core->Memory = pMemory;
     
-    Core->AssetSys = (assetsys*)memory_alloc(Core->Memory, sizeof(assetsys));
+    // Allocated before anything else so the table sits at the bottom of the
+    // heap, out of the way of compaction.
+    memory_handle_table_init(Core->Memory, CreateInfo->Memory.MovableCount);
+    
+    // The asset system uses scratch memory while mounting,
+    // so the frame allocator has to be initialized first.
+    Core->Scratch = (frame_allocator*)memory_alloc(Core->Memory, sizeof(frame_allocator));
+    void *ScratchMemory = memory_alloc(Core->Memory, CreateInfo->Memory.ScratchSize);
+    frame_allocator_init(Core->Scratch, CreateInfo->Memory.ScratchSize, ScratchMemory);
+    
+    // The tagged heap gets its own pages so that its blocks stay aligned
+    // and never fragment the general heap.
+    Core->TaggedHeap = (tagged_heap*)memory_alloc(Core->Memory, sizeof(tagged_heap));
+    // Per-frame staging data lives here, and a tagged heap block is exactly
+    // one large page on x64.
+    void *TaggedHeapMemory = NULL;
+    if (CreateInfo->Memory.LargePages)
+    {
+        TaggedHeapMemory = PlatformRequestLargeMemory(CreateInfo->Memory.TaggedHeapSize);
+    }
+    
+    bool TaggedHeapLargePages = (TaggedHeapMemory != NULL);
+    if (!TaggedHeapMemory)
+    {
+        TaggedHeapMemory = PlatformRequestMemory(CreateInfo->Memory.TaggedHeapSize);
+    }
+    tagged_heap_init(Core->TaggedHeap, CreateInfo->Memory.TaggedHeapSize, TaggedHeapMemory);
+    
+    if (CreateInfo->Memory.LargePages)
+    {
+        u64 LargePageSize = PlatformGetLargePageSize();
+        if (!LargePageSize)
+        {
+            mprinte("Large pages are not available, \"Lock pages in memory\" has to be granted to the user. Using regular pages.\n");
+        }
+        else
+        {
+            mprint("Heap: %s large pages (%lldKB)\n", Core->Memory->PageSize ? "using" : "failed to get", LargePageSize / 1024);
+            mprint("Tagged Heap: %s large pages (%lldKB)\n", TaggedHeapLargePages ? "using" : "failed to get", LargePageSize / 1024);
+        }
+    }
+    
+    Core->Strings = (string_table*)memory_alloc_tagged(Core->Memory, sizeof(string_table), MemoryTag_Strings);
+    string_table_init(Core->Strings, Core->Memory, GLOBALS_STRING_TABLE_CAPACITY);
+    
+    Core->AssetSys = (assetsys*)memory_alloc_tagged(Core->Memory, sizeof(assetsys), MemoryTag_AssetSys);
     assetsys_init(Core->AssetSys, (char*)CreateInfo->AssetSystem.ExecutablePath);
     
+    Core->AsyncIo = (async_io*)memory_alloc_tagged(Core->Memory, sizeof(async_io), MemoryTag_AssetSys);
+    async_io_init(Core->AsyncIo);
+    
+    Core->AssetCache = (asset_cache*)memory_alloc_tagged(Core->Memory, sizeof(asset_cache), MemoryTag_AssetSys);
+    asset_cache_init(Core->AssetCache, CreateInfo->AssetSystem.CacheBudget);
+    
+    // Mounting a directory does not list it, directories are
+    // listed on the first lookup into them. The times here are for finding the
+    // mount and mapping packs, the listing cost shows up on first loads.
+    u64 MountStart = PlatformGetWallClock();
     mstr ExeDirectory = Win32GetExeFilepath();
     assetsys_mount(Core->AssetSys, mstr_to_cstr(&ExeDirectory), "root");
     mstr_free(&ExeDirectory);
+    mprint("Mounted \"root\" in %.2fms\n", PlatformGetSecondsElapsed(MountStart, PlatformGetWallClock()) * 1000.0f);
     
     for (u32 i = 0; i < CreateInfo->AssetSystem.MountPointsCount; ++i)
     {
         assetsys_mount_point_create_info *MountInfo = CreateInfo->AssetSystem.MountPoints + i;
+        
+        MountStart = PlatformGetWallClock();
         if (MountInfo->ParentMountName)
             assetsys_mountr(Core->AssetSys, MountInfo->Path, MountInfo->MountName, MountInfo->ParentMountName);
         else
             assetsys_mount(Core->AssetSys, MountInfo->Path, MountInfo->MountName);
+        
+        mprint("Mounted \"%s\" in %.2fms\n", MountInfo->MountName,
+               PlatformGetSecondsElapsed(MountStart, PlatformGetWallClock()) * 1000.0f);
     }
 }
 
 void globals_free()
 {
+#ifdef MAPLE_MEMORY_TRACE
+    memory_trace *Trace = Core->Memory->Trace;
+    memory_trace_end(Core->Memory);
+    PlatformReleaseMemory(Trace, 0);
+#endif
+    
+    // Reads in flight resolve their paths through the asset system
+    async_io_free(Core->AsyncIo);
+    memory_release(Core->Memory, Core->AsyncIo);
+    
+    // Cached files can point into the views of mounted packs
+    asset_cache_free(Core->AssetCache);
+    memory_release(Core->Memory, Core->AssetCache);
+    
     assetsys_free(Core->AssetSys);
     memory_release(Core->Memory, Core->AssetSys);
     
+    string_table_free(Core->Strings);
+    memory_release(Core->Memory, Core->Strings);
+    
+    // Tags that live for the whole run
+    tagged_heap_release_tag(Core->TaggedHeap, TaggedHeapTag_Platform);
+    for (u32 Frame = 0; Frame < FRAME_ALLOCATOR_FRAME_COUNT; ++Frame)
+    {
+        tagged_heap_release_tag(Core->TaggedHeap, tagged_heap_frame_tag(Frame));
+    }
+    
+    void *TaggedHeapMemory = Core->TaggedHeap->Start;
+    tagged_heap_free(Core->TaggedHeap);
+    memory_release(Core->Memory, Core->TaggedHeap);
+    PlatformReleaseMemory(TaggedHeapMemory, 0);
+    
+    memory_release(Core->Memory, Core->Scratch->Start);
+    frame_allocator_free(Core->Scratch);
+    memory_release(Core->Memory, Core->Scratch);
+    
+    memory_handle_table_free(Core->Memory);
+    
     memory Memory = *Core->Memory;
     void *MemoryPtr = Memory.Start;;
     
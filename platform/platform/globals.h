@@ -3,7 +3,16 @@
 
 typedef struct 
 {
-    u64 Size;
+    u64 Size;        // Reserved address space, committed as the heap grows
+    u64 ScratchSize; // Per-frame scratch memory, carved from the heap
+    u64 TaggedHeapSize;
+    u32 MovableCount; // Most movable allocations alive at once
+    
+    // Back the heap and the tagged heap with large pages when the OS allows it.
+    // Large pages are committed up front, so the heap is LargePageHeapSize
+    // bytes rather than Size.
+    bool LargePages;
+    u64  LargePageHeapSize;
 } memory_create_info;
 
 typedef struct
@@ -22,6 +31,9 @@ typedef struct
     assetsys_mount_point_create_info *MountPoints;
     u32                               MountPointsCount;
     
+    // Bytes of files the asset cache keeps in memory, 0 for the default
+    u64                               CacheBudget;
+    
 } assetsys_create_info;
 
 typedef struct 
@@ -32,8 +44,13 @@ typedef struct
 
 typedef struct
 {
-    struct memory   *Memory;
-    struct assetsys *AssetSys;
+    struct memory          *Memory;
+    struct frame_allocator *Scratch;
+    struct tagged_heap     *TaggedHeap;
+    struct string_table    *Strings;
+    struct assetsys        *AssetSys;
+    struct async_io        *AsyncIo;
+    struct asset_cache     *AssetCache;
 } globals;
 
 extern globals *Core;
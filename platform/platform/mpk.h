@@ -0,0 +1,138 @@
+#ifndef PLATFORM_MPK_H
+#define PLATFORM_MPK_H
+
+// Maple pack (.mpk): a directory of assets stored as one file. A pack is
+// mounted like a directory, but the whole pack is mapped once and every file
+// in it is found and read inside that view, without a file open per asset.
+//
+// Layout, every offset is from the start of the pack:
+//
+//   mpk_header
+//   mpk_entry[EntryCount]  sorted by PathHash
+//   names                  the path of each entry, not null terminated
+//   data                   see the alignment below
+//
+// The path of an entry is relative to the directory the pack was built from,
+// with '/' separators and no leading or trailing separator, the same form
+// assetsys_normalize_path produces. PathHash is mpk_path_hash of that path.
+//
+// A file of at least MPK_ALIGNMENT bytes starts on a MPK_ALIGNMENT boundary,
+// so reading or prefetching it touches no page of another file. Smaller files
+// are packed together on MPK_SMALL_ALIGNMENT boundaries, many to a page.
+
+#define MPK_MAGIC           0x314B504D // "MPK1"
+#define MPK_VERSION         1
+#define MPK_ALIGNMENT       4096
+#define MPK_SMALL_ALIGNMENT 16
+#define MPK_HASH_SEED       0x6B61706D // "mpak"
+
+typedef enum mpk_compression
+{
+    MpkCompression_None,   // stored as is, Size == RawSize
+    MpkCompression_Blocks, // a block stream, see utils/block_compress.h
+    
+    MpkCompression_Count,
+} mpk_compression;
+
+typedef struct mpk_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 EntryCount;
+    u32 Alignment;
+    
+    u64 EntriesOffset;
+    u64 NamesOffset;
+    u64 NamesSize;
+    u64 DataOffset;
+    u64 Size; // of the whole pack
+    u64 Reserved;
+} mpk_header;
+
+typedef struct mpk_entry
+{
+    u64 PathHash;
+    u64 Offset;
+    u64 Size;    // bytes stored in the pack
+    u64 RawSize; // bytes once decompressed
+    
+    u32 NameOffset; // from NamesOffset
+    u16 NameLen;
+    u16 Compression;
+} mpk_entry;
+
+#define mpk_entries(h)   ((const mpk_entry*)((const u8*)(h) + (h)->EntriesOffset))
+#define mpk_names(h)     ((const char*)(h) + (h)->NamesOffset)
+#define mpk_name(h, e)   (mpk_names(h) + (e)->NameOffset)
+#define mpk_data(h, e)   ((const u8*)(h) + (e)->Offset)
+
+file_internal u64 mpk_path_hash(const char *Path, u32 PathLen)
+{
+    return hash64_seeded(Path, PathLen, MPK_HASH_SEED);
+}
+
+// Checks that everything the header and the entries point at is inside the
+// Size bytes of the pack, so entries can be read without further checks.
+file_internal bool mpk_validate(const mpk_header *Pack, u64 Size)
+{
+    if (Size < sizeof(mpk_header)) return false;
+    if (Pack->Magic != MPK_MAGIC || Pack->Version != MPK_VERSION || Pack->Size != Size) return false;
+    
+    u64 EntriesSize = (u64)Pack->EntryCount * sizeof(mpk_entry);
+    if (Pack->EntriesOffset > Size || EntriesSize > Size - Pack->EntriesOffset) return false;
+    if (Pack->NamesOffset > Size || Pack->NamesSize > Size - Pack->NamesOffset) return false;
+    
+    const mpk_entry *Entries = mpk_entries(Pack);
+    for (u32 i = 0; i < Pack->EntryCount; ++i)
+    {
+        const mpk_entry *Entry = Entries + i;
+        
+        if (Entry->Offset > Size || Entry->Size > Size - Entry->Offset) return false;
+        if ((u64)Entry->NameOffset + Entry->NameLen > Pack->NamesSize)  return false;
+        if (i > 0 && Entries[i - 1].PathHash > Entry->PathHash)         return false;
+        
+        if (Entry->Compression == MpkCompression_None)
+        {
+            if (Entry->Size != Entry->RawSize) return false;
+        }
+        else if (Entry->Compression == MpkCompression_Blocks)
+        {
+            // Only the seek table is checked, a corrupt block fails its read
+            const block_stream_header *Stream = (const block_stream_header*)mpk_data(Pack, Entry);
+            if (!block_stream_validate(Stream, Entry->Size) || Stream->RawSize != Entry->RawSize) return false;
+        }
+        else return false;
+    }
+    
+    return true;
+}
+
+// Binary search for the entry of a path, which has to be in the form described
+// above. Returns NULL if the pack does not have it.
+file_internal const mpk_entry* mpk_find(const mpk_header *Pack, const char *Path, u32 PathLen)
+{
+    const mpk_entry *Entries = mpk_entries(Pack);
+    u64 Hash = mpk_path_hash(Path, PathLen);
+    
+    // First entry with a hash >= Hash
+    u32 Low  = 0;
+    u32 High = Pack->EntryCount;
+    while (Low < High)
+    {
+        u32 Mid = Low + (High - Low) / 2;
+        if (Entries[Mid].PathHash < Hash) Low = Mid + 1;
+        else                              High = Mid;
+    }
+    
+    // The builder refuses colliding paths, the name is compared anyway so a
+    // path that is not in the pack can never match
+    for (; Low < Pack->EntryCount && Entries[Low].PathHash == Hash; ++Low)
+    {
+        const mpk_entry *Entry = Entries + Low;
+        if (Entry->NameLen == PathLen && memcmp(mpk_name(Pack, Entry), Path, PathLen) == 0) return Entry;
+    }
+    
+    return NULL;
+}
+
+#endif //PLATFORM_MPK_H
@@ -93,6 +93,17 @@ typedef enum
 // (i.e. VirtualAlloc or mmap)
 void* PlatformRequestMemory(u64 Size);
 void PlatformReleaseMemory(void *Ptr, u64 Size);
+// Reserves address space without backing it. Pages have to be committed
+// before use and the range is released with PlatformReleaseMemory.
+void* PlatformReserveMemory(u64 Size);
+bool PlatformCommitMemory(void *Ptr, u64 Size);
+void PlatformDecommitMemory(void *Ptr, u64 Size);
+// Same as PlatformRequestMemory, but backs the range with large pages to cut
+// down on TLB misses. Returns NULL when the OS refuses, callers are expected
+// to fall back to regular pages. Released with PlatformReleaseMemory.
+void* PlatformRequestLargeMemory(u64 Size);
+// 0 if large pages are not available to the process
+u64 PlatformGetLargePageSize();
 
 //~ Log/Printing
 #define mformat PlatformFormatString
@@ -188,6 +199,9 @@ window_rect PlatformGetClientWindowRect();
 // System Memory allocations
 typedef void* (*pfn_platform_request_memory)(u64 Size);
 typedef void (*pfn_platform_release_memory)(void *Ptr, u64 Size);
+typedef void* (*pfn_platform_reserve_memory)(u64 Size);
+typedef bool (*pfn_platform_commit_memory)(void *Ptr, u64 Size);
+typedef void (*pfn_platform_decommit_memory)(void *Ptr, u64 Size);
 
 // get window information
 typedef void (*pfn_get_client_window_dimensions)(u32 *Width, u32 *Height);
@@ -198,6 +212,12 @@ typedef file_id (*pfn_platform_open_file)(const char *Filepath, bool IsRelative,
 typedef file_error (*pfn_platform_load_file)(const char *Filepath, bool IsRelative, const char *MountName,
                                              void *Buffer, u64 Size);
 typedef void (*pfn_platform_close_file)(file_id Fid);
+typedef file_view (*pfn_platform_map_file)(const char *Filepath, bool IsRelative, const char *MountName, file_map_hint Hint);
+typedef void (*pfn_platform_unmap_file)(file_view *View);
+typedef cached_file (*pfn_platform_acquire_file)(const char *Filepath, const char *MountName);
+typedef void (*pfn_platform_release_file)(cached_file *File);
+typedef u32 (*pfn_platform_io_submit)(io_request *Requests, u32 Count);
+typedef u32 (*pfn_platform_io_poll)(io_completion *Completions, u32 MaxCount, u32 TimeoutMs);
 typedef u64 (*pfn_platform_get_file_size)(file_id Fid);
 typedef u64 (*pfn_platform_get_file_fsize)(const char *Filename, const char *MounName);
 
@@ -207,10 +227,15 @@ typedef void (*pfn_platform_mprint)(char *Fmt, ...);
 typedef struct platform
 {
     struct memory                   *Memory;
+    struct frame_allocator          *Scratch; // reset by the platform every frame
+    struct tagged_heap              *TaggedHeap;
     
     // System Memory Allocation
     pfn_platform_request_memory      request_memory;
     pfn_platform_release_memory      release_memory;
+    pfn_platform_reserve_memory      reserve_memory;
+    pfn_platform_commit_memory       commit_memory;
+    pfn_platform_decommit_memory     decommit_memory;
     
     // Acquire window information
     pfn_get_client_window_dimensions get_client_window_dimensions;
@@ -224,9 +249,17 @@ typedef struct platform
     pfn_platform_open_file           open_file;
     pfn_platform_load_file           load_file;
     pfn_platform_close_file          close_file;
+    pfn_platform_map_file            map_file;
+    pfn_platform_unmap_file          unmap_file;
+    pfn_platform_acquire_file        acquire_file;
+    pfn_platform_release_file        release_file;
     pfn_platform_get_file_size       file_get_size;
     pfn_platform_get_file_fsize      file_get_fsize;
     
+    // Async File Api
+    pfn_platform_io_submit           io_submit;
+    pfn_platform_io_poll             io_poll;
+    
 } platform;
 
 extern platform *Platform;
@@ -9,7 +9,10 @@
 #include <strsafe.h>
 
 #include "win32/platform_win32.c"
+#include "platform/win32/block_decoder_win32.c"
 #include "platform/win32/assetsys_win32.c"
+#include "platform/win32/async_io_win32.c"
+#include "platform/win32/asset_cache_win32.c"
 #include "platform/globals.c"
 
 #elif defined(linux) || defined(__unix__)
@@ -0,0 +1,66 @@
+#ifndef PLATFORM_ASSET_CACHE_H
+#define PLATFORM_ASSET_CACHE_H
+
+// Keeps whole files in memory so loading the same asset again does not go back
+// to the disk. A file is read once, into a buffer that is shared by everyone
+// that acquires it and is read only. The cache holds files up to a byte
+// budget, and when it is over budget it evicts files that are neither in use
+// nor pinned, least recently used first (CLOCK, see asset_cache_evict).
+//
+// Files are keyed by their assetsys_file_id, so any path that leads to the
+// same file shares its entry. Files in a pack have no assetsys_file_id, they
+// are keyed by their pack and table of contents entry instead.
+//
+// Opening a file for writing drops it from the cache, pins included. Buffers
+// that are still acquired keep the old contents until they are released.
+//
+// Like the asset system, the cache is used from the thread that owns it.
+
+// Budget when globals_create_info does not set one
+#define ASSET_CACHE_DEFAULT_BUDGET _MB(64)
+
+// A file in the cache. Data is NULL if the file could not be loaded, and for
+// an empty file.
+typedef struct cached_file
+{
+    const void *Data;
+    u64         Size;
+    u32         Entry; // index in the cache, used to release the file
+} cached_file;
+
+typedef struct asset_cache_stats
+{
+    u64 Hits;
+    u64 Misses;
+    u64 Evictions;
+    
+    u64 ResidentBytes; // charged against the budget, see asset_cache_entry::Charge
+    u64 BudgetBytes;
+    u32 ResidentFiles;
+    u32 PinnedFiles;
+} asset_cache_stats;
+
+typedef struct asset_cache* asset_cache_t;
+
+void asset_cache_init(asset_cache_t Cache, u64 Budget);
+// Files that are still acquired are released as well
+void asset_cache_free(asset_cache_t Cache);
+
+//~ Cached File Api
+
+// Returns the contents of a file, loading it on a miss. Every acquire is
+// paired with a release, the file can't be evicted while it is acquired.
+cached_file file_acquire(const char *Filepath, const char *MountName);
+void file_release(cached_file *File);
+
+// A pinned file stays in the cache, even with no one holding it, until it is
+// unpinned. Pinning loads the file if it is not in the cache yet. Returns
+// false if the file could not be loaded.
+bool file_pin(const char *Filepath, const char *MountName);
+void file_unpin(const char *Filepath, const char *MountName);
+
+// Lowering the budget evicts right away, down to the files in use and pinned
+void asset_cache_set_budget(u64 Budget);
+asset_cache_stats asset_cache_get_stats();
+
+#endif //PLATFORM_ASSET_CACHE_H
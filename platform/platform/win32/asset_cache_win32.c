@@ -0,0 +1,372 @@
+
+// Entry index of a cached_file that holds nothing
+#define ASSET_CACHE_NO_ENTRY 0xFFFFFFFF
+
+// Cache key -> index into asset_cache::Entries
+HASH_MAP_DEFINE(asset_cache_map, u64, u32)
+
+typedef struct asset_cache_entry
+{
+    u64   Key;
+    void *Data;
+    u64   Size;
+    // Bytes counted against the budget: the pages holding Data, or 0 when
+    // Data is a file's part of a pack's view and was never copied
+    u64   Charge;
+    
+    u32   Refs; // acquires not yet released
+    u32   Pins;
+    
+    bool  Used;       // free entries are on the free list
+    bool  Referenced; // CLOCK bit, set on every hit and cleared as the hand passes
+    bool  Detached;   // dropped from the index while acquired, freed on its last release
+} asset_cache_entry;
+
+typedef struct asset_cache
+{
+    asset_cache_entry *Entries;     // dyn_array
+    u32               *FreeEntries; // dyn_array
+    asset_cache_map    Index;
+    
+    u32                Hand; // next entry the CLOCK looks at
+    asset_cache_stats  Stats;
+} asset_cache;
+
+//~ Entries
+
+// Finds the key of a file, see asset_cache.h. Returns false if the mount or
+// the file do not exist.
+file_internal bool asset_cache_key(assetsys *AssetSys, const char *Filepath, const char *MountName, u64 *Key)
+{
+    string_id MountId = (MountName) ? string_find(Core->Strings, MountName, strlen(MountName)) : StringId_Root;
+    
+    assetsys_mount_point *Mount = assetsys_get_mount_point(AssetSys, MountId);
+    if (!Mount) return false;
+    
+    if (Mount->Type == MountType_Pack)
+    {
+        const mpk_entry *Entry = assetsys_find_pack_entry(AssetSys, Mount, Filepath);
+        if (!Entry) return false;
+        
+        // Above the 16 bits of an assetsys_file_id
+        const mpk_header *Pack = AssetSys->Packs[Mount->Pack];
+        *Key = ((u64)(Mount->Pack + 1) << 32) | (u64)(Entry - mpk_entries(Pack));
+        return true;
+    }
+    
+    assetsys_file_id Fid = assetsys_lookup(AssetSys, Mount, Filepath);
+    if (!assetsys_valid_file_id(Fid)) return false;
+    
+    *Key = Fid.Mask;
+    return true;
+}
+
+// Reads a whole file into Entry. The copy is made read only, so a caller
+// writing to a shared buffer faults instead of changing the file for everyone
+// else. A file stored as is in a pack is not copied at all, its data already
+// sits in the pack's view.
+file_internal bool asset_cache_read(assetsys *AssetSys, const char *Filepath, const char *MountName, asset_cache_entry *Entry)
+{
+    file_id Fid = assetsys_open(AssetSys, Filepath, true, MountName, FileMode_Read);
+    if (Fid == file_id_invalid) return false;
+    
+    file_info *File = AssetSys->OpenFiles + Fid;
+    bool Result = true;
+    
+    Entry->Data   = NULL;
+    Entry->Size   = File->Size;
+    Entry->Charge = 0;
+    
+    // An empty file is cached with no data
+    if (File->Size > 0 && File->Handle == INVALID_HANDLE_VALUE && File->Compression == MpkCompression_None)
+    {
+        Entry->Data = *File->Memory;
+    }
+    else if (File->Size > 0)
+    {
+        Entry->Data = VirtualAlloc(NULL, File->Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        
+        if (!Entry->Data || assetsys_read(AssetSys, Fid, File->Size, Entry->Data, File->Size) != File_Success)
+        {
+            mprinte("Unable to load \"%s\" into the asset cache!\n", Filepath);
+            
+            if (Entry->Data) VirtualFree(Entry->Data, 0, MEM_RELEASE);
+            Entry->Data = NULL;
+            Result = false;
+        }
+        else
+        {
+            DWORD OldProtect;
+            VirtualProtect(Entry->Data, File->Size, PAGE_READONLY, &OldProtect);
+            
+            Entry->Charge = (File->Size + AssetSys->PageSize - 1) & ~(AssetSys->PageSize - 1);
+        }
+    }
+    
+    assetsys_close(AssetSys, Fid);
+    
+    return Result;
+}
+
+// Frees an entry's data and returns it to the free list
+file_internal void asset_cache_drop(asset_cache *Cache, u32 Index)
+{
+    asset_cache_entry *Entry = Cache->Entries + Index;
+    
+    if (Entry->Charge > 0) VirtualFree(Entry->Data, 0, MEM_RELEASE);
+    if (!Entry->Detached) asset_cache_map_remove(&Cache->Index, Entry->Key);
+    if (Entry->Pins > 0) Cache->Stats.PinnedFiles--;
+    
+    Cache->Stats.ResidentBytes -= Entry->Charge;
+    Cache->Stats.ResidentFiles--;
+    
+    memset(Entry, 0, sizeof(asset_cache_entry));
+    arr_put(Cache->FreeEntries, Index);
+}
+
+// Evicts files until the cache is back under budget. The hand sweeps over the
+// entries: a file that was used since the hand last passed it has its bit
+// cleared and stays for another sweep, a file that was not is evicted. Files
+// that are acquired, pinned, or cost nothing to keep are passed over. After
+// two sweeps every file that could be evicted has been.
+file_internal void asset_cache_evict(asset_cache *Cache)
+{
+    u32 Count = arr_len(Cache->Entries);
+    
+    for (u32 Step = 0; Step < 2 * Count && Cache->Stats.ResidentBytes > Cache->Stats.BudgetBytes; ++Step)
+    {
+        u32 Index = Cache->Hand;
+        Cache->Hand = (Cache->Hand + 1 < Count) ? Cache->Hand + 1 : 0;
+        
+        asset_cache_entry *Entry = Cache->Entries + Index;
+        if (!Entry->Used || Entry->Refs > 0 || Entry->Pins > 0 || Entry->Charge == 0) continue;
+        
+        if (Entry->Referenced)
+        {
+            Entry->Referenced = false;
+            continue;
+        }
+        
+        asset_cache_drop(Cache, Index);
+        Cache->Stats.Evictions++;
+    }
+}
+
+// Returns the entry of a file, loading it on a miss, or ASSET_CACHE_NO_ENTRY.
+// Nothing is evicted here: callers take their reference or pin first, so the
+// file they asked for is not the one that goes.
+file_internal u32 asset_cache_fetch(asset_cache *Cache, const char *Filepath, const char *MountName)
+{
+    assetsys *AssetSys = Core->AssetSys;
+    
+    u64 Key;
+    if (!asset_cache_key(AssetSys, Filepath, MountName, &Key)) return ASSET_CACHE_NO_ENTRY;
+    
+    u32 *Found = asset_cache_map_find(&Cache->Index, Key);
+    if (Found)
+    {
+        Cache->Entries[*Found].Referenced = true;
+        Cache->Stats.Hits++;
+        return *Found;
+    }
+    
+    Cache->Stats.Misses++;
+    
+    asset_cache_entry Loaded = {0};
+    if (!asset_cache_read(AssetSys, Filepath, MountName, &Loaded)) return ASSET_CACHE_NO_ENTRY;
+    
+    Loaded.Key        = Key;
+    Loaded.Used       = true;
+    Loaded.Referenced = true;
+    
+    u32 Index;
+    if (arr_len(Cache->FreeEntries) > 0)
+    {
+        Index = arr_pop(Cache->FreeEntries);
+    }
+    else
+    {
+        Index = arr_len(Cache->Entries);
+        arr_put(Cache->Entries, Loaded);
+        
+        if (arr_len(Cache->Entries) == Index)
+        {
+            mprinte("Unable to grow the asset cache, \"%s\" is not cached!\n", Filepath);
+            if (Loaded.Charge > 0) VirtualFree(Loaded.Data, 0, MEM_RELEASE);
+            return ASSET_CACHE_NO_ENTRY;
+        }
+    }
+    
+    Cache->Entries[Index] = Loaded;
+    asset_cache_map_put(&Cache->Index, Key, Index);
+    
+    Cache->Stats.ResidentBytes += Loaded.Charge;
+    Cache->Stats.ResidentFiles++;
+    
+    return Index;
+}
+
+//~ Asset system hooks
+
+// Called when a file is opened for writing, see asset_cache.h
+file_internal void asset_cache_invalidate(asset_cache *Cache, u64 Key)
+{
+    u32 *Found = asset_cache_map_find(&Cache->Index, Key);
+    if (!Found) return;
+    
+    u32 Index = *Found;
+    asset_cache_entry *Entry = Cache->Entries + Index;
+    
+    if (Entry->Refs == 0)
+    {
+        asset_cache_drop(Cache, Index);
+        return;
+    }
+    
+    asset_cache_map_remove(&Cache->Index, Key);
+    if (Entry->Pins > 0) Cache->Stats.PinnedFiles--;
+    
+    Entry->Pins     = 0;
+    Entry->Detached = true;
+}
+
+// Serves file_load from the cache when the file is in it. Returns false on a
+// miss, the load then goes to the file as usual and the file is not cached.
+file_internal bool asset_cache_copy(asset_cache *Cache, const char *Filepath, const char *MountName,
+                                    void *Buffer, u64 BufferSize, file_error *Result)
+{
+    u64 Key;
+    if (!asset_cache_key(Core->AssetSys, Filepath, MountName, &Key)) return false;
+    
+    u32 *Found = asset_cache_map_find(&Cache->Index, Key);
+    if (!Found) return false;
+    
+    asset_cache_entry *Entry = Cache->Entries + *Found;
+    Entry->Referenced = true;
+    Cache->Stats.Hits++;
+    
+    if (Entry->Size > BufferSize)
+    {
+        *Result = File_BufferTooSmall;
+    }
+    else
+    {
+        if (Entry->Size > 0) memcpy(Buffer, Entry->Data, Entry->Size);
+        *Result = File_Success;
+    }
+    
+    return true;
+}
+
+//~ Cache
+
+void asset_cache_init(asset_cache *Cache, u64 Budget)
+{
+    memset(Cache, 0, sizeof(asset_cache));
+    
+    arr_init(Cache->Entries, allocator_heap(Core->Memory, MemoryTag_AssetSys), 64);
+    arr_init(Cache->FreeEntries, allocator_heap(Core->Memory, MemoryTag_AssetSys), 64);
+    asset_cache_map_init(&Cache->Index, allocator_heap(Core->Memory, MemoryTag_AssetSys), 64);
+    
+    Cache->Stats.BudgetBytes = (Budget) ? Budget : ASSET_CACHE_DEFAULT_BUDGET;
+}
+
+void asset_cache_free(asset_cache *Cache)
+{
+    for (u32 i = 0; i < arr_len(Cache->Entries); ++i)
+    {
+        asset_cache_entry *Entry = Cache->Entries + i;
+        if (Entry->Used && Entry->Charge > 0) VirtualFree(Entry->Data, 0, MEM_RELEASE);
+    }
+    
+    arr_free(Cache->Entries);
+    arr_free(Cache->FreeEntries);
+    asset_cache_map_free(&Cache->Index);
+}
+
+//~ User API
+
+cached_file file_acquire(const char *Filepath, const char *MountName)
+{
+    asset_cache *Cache = Core->AssetCache;
+    
+    cached_file Result;
+    Result.Data  = NULL;
+    Result.Size  = 0;
+    Result.Entry = asset_cache_fetch(Cache, Filepath, MountName);
+    
+    if (Result.Entry == ASSET_CACHE_NO_ENTRY) return Result;
+    
+    asset_cache_entry *Entry = Cache->Entries + Result.Entry;
+    Entry->Refs++;
+    
+    Result.Data = Entry->Data;
+    Result.Size = Entry->Size;
+    
+    asset_cache_evict(Cache);
+    
+    return Result;
+}
+
+void file_release(cached_file *File)
+{
+    asset_cache *Cache = Core->AssetCache;
+    
+    if (File->Entry != ASSET_CACHE_NO_ENTRY)
+    {
+        asset_cache_entry *Entry = Cache->Entries + File->Entry;
+        Entry->Refs--;
+        
+        if (Entry->Refs == 0 && Entry->Detached) asset_cache_drop(Cache, File->Entry);
+        else if (Entry->Refs == 0) asset_cache_evict(Cache);
+    }
+    
+    File->Data  = NULL;
+    File->Size  = 0;
+    File->Entry = ASSET_CACHE_NO_ENTRY;
+}
+
+bool file_pin(const char *Filepath, const char *MountName)
+{
+    asset_cache *Cache = Core->AssetCache;
+    
+    u32 Index = asset_cache_fetch(Cache, Filepath, MountName);
+    if (Index == ASSET_CACHE_NO_ENTRY) return false;
+    
+    asset_cache_entry *Entry = Cache->Entries + Index;
+    if (Entry->Pins++ == 0) Cache->Stats.PinnedFiles++;
+    
+    asset_cache_evict(Cache);
+    
+    return true;
+}
+
+void file_unpin(const char *Filepath, const char *MountName)
+{
+    asset_cache *Cache = Core->AssetCache;
+    
+    u64 Key;
+    if (!asset_cache_key(Core->AssetSys, Filepath, MountName, &Key)) return;
+    
+    // Not there when the file was written to since it was pinned
+    u32 *Found = asset_cache_map_find(&Cache->Index, Key);
+    if (!Found || Cache->Entries[*Found].Pins == 0) return;
+    
+    asset_cache_entry *Entry = Cache->Entries + *Found;
+    if (--Entry->Pins == 0)
+    {
+        Cache->Stats.PinnedFiles--;
+        asset_cache_evict(Cache);
+    }
+}
+
+void asset_cache_set_budget(u64 Budget)
+{
+    Core->AssetCache->Stats.BudgetBytes = Budget;
+    asset_cache_evict(Core->AssetCache);
+}
+
+asset_cache_stats asset_cache_get_stats()
+{
+    return Core->AssetCache->Stats;
+}
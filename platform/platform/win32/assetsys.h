@@ -15,6 +15,7 @@ typedef enum assetsys_mount_type
 {
     MountType_Directory,
     MountType_Zip, // NOTE(Dustin): Not implemented, and won't be for a while
+    MountType_Pack, // Maple pack (.mpk), see mpk.h
     
     MountType_Count,
     MountType_Unknown = MountType_Count, 
@@ -93,6 +94,14 @@ typedef enum file_mode
     FileMode_Append,
 } file_mode;
 
+// How a mapped file is going to be read. Only a hint, a platform can ignore it.
+typedef enum file_map_hint
+{
+    FileMapHint_None,
+    FileMapHint_Sequential, // read once, front to back
+    FileMapHint_WillNeed,   // all of it, soon
+} file_map_hint;
+
 typedef u32                   file_id;
 typedef struct assetsys_file* assetsys_file_t;
 typedef struct assetsys*      assetsys_t;
@@ -103,6 +112,16 @@ typedef struct assetsys*      assetsys_t;
 #define file_id_is_valid(id) id != file_id_invalid
 #define assetsys_valid_file_id(id) (id.Minor != 0) 
 
+// A read-only view of a whole file, mapped from the OS file cache rather than
+// copied into a buffer. Data is NULL when the file could not be mapped, and
+// for an empty file.
+typedef struct file_view
+{
+    const void *Data;
+    u64         Size;
+    file_id     Fid;
+} file_view;
+
 //~ Exposed assetsys api
 
 void assetsys_init(assetsys_t AssetSys, char *Root);
@@ -129,6 +148,11 @@ file_error file_load(const char *Filepath, bool IsRelative, const char *MountNam
                      void *Buffer, u64 Size);
 void file_close(file_id Fid);
 
+// Map a file instead of loading it. The view holds an open file, and is valid
+// until it is unmapped.
+file_view file_map(const char *Filepath, bool IsRelative, const char *MountName, file_map_hint Hint);
+void file_unmap(file_view *View);
+
 // Gets the size of a file that has been opened
 u64 file_get_size(file_id Fid);
 // Get size of a file without having to open it.
@@ -1,7 +1,8 @@
 
 #define MAX_ASSETSYS_POOL_COUNT      256
-#define MAX_ASSETSYS_POOL_FILE_COUNT 256
+#define MAX_ASSETSYS_POOL_FILE_COUNT 255 // assetsys_file_id::Minor is 1-based and a u8
 #define MAX_OPEN_FILES               128
+#define MAX_ASSETSYS_PATH            2048
 
 typedef struct file_info
 {
@@ -15,6 +16,11 @@ typedef struct file_info
     u64              FileOffset;
     
     assetsys_file_id Fid;
+    
+    // A file in a pack can be compressed. Memory is then the stored data,
+    // and Decoded is the copy assetsys_map decodes it into.
+    mpk_compression  Compression;
+    void            *Decoded;
 } file_info;
 
 typedef struct assetsys_file
@@ -22,27 +28,32 @@ typedef struct assetsys_file
     assetsys_file_id   Id; // backpointer to the file array
     assetsys_file_type Type;
     
-    BY_HANDLE_FILE_INFORMATION Win32FileInfo;
-    file_id                    FileInfo;
+    WIN32_FILE_ATTRIBUTE_DATA Win32FileInfo;
+    file_id                   FileInfo;
     
     // A directory can have 0 or more files.
     // ".", "..", and hidden files/directories are ignored
-    assetsys_file_id  *ChildFiles;
-    u32                ChildFileCount;
+    assetsys_file_id  *ChildFiles; // dyn_array
+    assetsys_file_id   Parent;     // invalid for the root of a mount
+    
+    // A directory is listed the first time a lookup walks into it, until then
+    // it has no children. See assetsys_enumerate_directory.
+    bool               Enumerated;
     
     // File info
-    mstr Name;
-    u128 HashedName;
+    mstr      Name;
+    string_id NameId; // Name interned in Core->Strings, compared instead of the string
     
 } assetsys_file;
 
 typedef struct assetsys_mount_point
 {
     assetsys_mount_type Type;
-    u128                Name;
+    string_id           Name;
     
     mstr                AbsolutePath;
     assetsys_file_id    File; // backpointer to the zip/directory
+    u32                 Pack; // index into assetsys::Packs for a MountType_Pack
 } assetsys_mount_point;
 
 typedef struct assetsys_file_pool
@@ -51,20 +62,35 @@ typedef struct assetsys_file_pool
     u8              AllocatedFiles;
 } assetsys_file_pool;
 
+// Mount name -> index into assetsys::MountedFiles
+HASH_MAP_DEFINE(mount_map, string_id, u32)
+
+// Path of a file relative to a mount -> the file. The key is the normalized
+// path hashed with the mount's name as the seed, see assetsys_path_key.
+HASH_MAP_DEFINE(path_map, u64, assetsys_file_id)
+
 typedef struct assetsys
 {
-    mstr   RootStr;
-    u128   Root;
+    mstr      RootStr;
+    string_id Root;
     
     // By default, the root is a mounted file at idx = 0
-    u32                   MountedFilesCount;
-    u32                   MountedFilesCap;
-    assetsys_mount_point *MountedFiles;
+    assetsys_mount_point *MountedFiles; // dyn_array
+    mount_map             MountIndex;
+    
+    // Every file that has been looked up, under every mount, so looking it
+    // up again is a single probe instead of a walk down the directory tree
+    path_map              PathIndex;
     
     // File pool for file allocations
-    u32                   FilePoolCount;
-    u32                   FilePoolCap;
-    assetsys_file_pool   *FilePool;
+    assetsys_file_pool   *FilePool; // dyn_array
+    
+    // The mapped view of each mounted pack. Files in a pack are not in the
+    // file tree, they are found and read through the pack's table of contents.
+    const mpk_header    **Packs; // dyn_array
+    
+    // Decodes the blocks of compressed files in packs on worker threads
+    block_decoder         Decoder;
     
     // Track open files...
     u64                   PageSize;
@@ -109,6 +135,8 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
 file_error assetsys_load(assetsys *AssetSys, const char *Filepath, bool IsRelative, const char *MountName,
                          void *Buffer, u64 Size);
 file_error assetsys_read(assetsys *AssetSys, file_id Fid, u64 ReadSize, void *Buffer, u64 BufferSize);
+file_view assetsys_map(assetsys *AssetSys, const char *Filepath, bool IsRelative, const char *MountName, file_map_hint Hint);
+void assetsys_unmap(assetsys *AssetSys, file_view *View);
 void assetsys_close(assetsys *AssetSys, file_id File);
 
 
@@ -116,15 +144,17 @@ void assetsys_close(assetsys *AssetSys, file_id File);
 // Minor Idx = 0 is the invalid case, so always subtract by one when indexing
 #define assetsys_get_file(sys, id) sys->FilePool[id.Major].Handles + (id.Minor - 1)
 
-// When looking for a file id, it will be common that the 
-// file is nested within several directories. However, the absolute paths
-// of the directories are not stored. Therefore, preprocess the filepath
-// into a list of comparators and search for the directories.
+// Files are normally found through the path index. When a file is not in
+// the index, the directory tree is searched instead: the filepath is
+// preprocessed into a list of comparators, one per directory in the path.
+//
+// Comparators are the interned names of each directory in the path. A name
+// that was never interned cannot match a file, so it is StringId_None.
 typedef struct comparator_list
 {
-    u32   Count;
-    u32   Idx;
-    u128 *Comparators;
+    u32        Count;
+    u32        Idx;
+    string_id *Comparators;
 } comparator_list;
 
 // Error functions
@@ -135,15 +165,38 @@ file_internal void assetsys_get_err_str(char *Buffer, u32 BufferLen, assetsys_er
 file_internal void assetsys_build_comparator_list(comparator_list *List, const char *Filepath);
 
 file_internal void assetsys_internal_traverse_tree(assetsys *AssetSys, assetsys_file_id Fid, u32 Depth);
-file_internal assetsys_file_id assetsys_find_fid(assetsys *AssetSys, assetsys_file_id CurrentId, comparator_list *CompList);
-file_internal assetsys_mount_point assetsys_find_mount_point(assetsys *AssetSys, const char *MountName);
-file_internal void assetsys_file_init_recurse_directory(assetsys *AssetSys, assetsys_file_id ParentFid, const char *Filepath);
+file_internal assetsys_file_id assetsys_find_fid(assetsys *AssetSys, assetsys_file_id Fid, const char *Path, u32 PathLen);
+file_internal assetsys_mount_point assetsys_find_mount_point(assetsys *AssetSys, string_id MountName);
+file_internal u32 assetsys_file_path(assetsys *AssetSys, assetsys_file_id Fid, char *Buffer);
+file_internal void assetsys_enumerate_directory(assetsys *AssetSys, assetsys_file_id Fid);
 file_internal assetsys_file_id assetsys_insert_file_in_tree(assetsys *AssetSys, 
                                                             comparator_list *CompList, 
                                                             assetsys_file_id MountFid, 
+                                                            u64 PathKey,
                                                             const char *Filename, u32 FilenameLen,
                                                             const char *Directory, u32 DirectoryLen);
 
+// Path index
+file_internal u32 assetsys_normalize_path(char *Buffer, const char *Path, u32 PathLen);
+file_internal u64 assetsys_path_key(string_id MountName, const char *Path, u32 PathLen);
+file_internal void assetsys_index_file(assetsys *AssetSys, u64 PathKey, assetsys_file_id Fid);
+file_internal assetsys_file_id assetsys_lookup(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Filepath);
+
+// Packs
+file_internal bool assetsys_mount_pack(assetsys *AssetSys, const char *Filename, assetsys_mount_point *Mount);
+file_internal const mpk_entry* assetsys_find_pack_entry(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Filepath);
+file_internal file_id assetsys_open_pack_entry(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Filepath, file_mode Mode);
+file_internal file_error assetsys_read_pack_data(assetsys *AssetSys, const void *Stored, mpk_compression Compression,
+                                                 u64 Offset, u64 Size, void *Buffer);
+
+// Open files
+file_internal file_id assetsys_acquire_open_file(assetsys *AssetSys);
+
+// Asset cache, see asset_cache_win32.c
+file_internal void asset_cache_invalidate(struct asset_cache *Cache, u64 Key);
+file_internal bool asset_cache_copy(struct asset_cache *Cache, const char *Filepath, const char *MountName,
+                                    void *Buffer, u64 BufferSize, file_error *Result);
+
 // File
 file_internal assetsys_file_id assetsys_allocate_file(assetsys *AssetSys, assetsys_file_type FileType);
 file_internal assetsys_file_id assetsys_file_init(assetsys *AssetSys, const char *Filename, u32 FilenameLen, 
@@ -217,7 +270,9 @@ file_internal void assetsys_internal_traverse_tree(assetsys *AssetSys, assetsys_
     
     if (File->Type == FileType_Directory)
     {
-        for (u32 i = 0; i < File->ChildFileCount; ++i) 
+        assetsys_enumerate_directory(AssetSys, Fid);
+        
+        for (u32 i = 0; i < arr_len(File->ChildFiles); ++i) 
             assetsys_internal_traverse_tree(AssetSys, File->ChildFiles[i], Depth + 1);
     }
 }
@@ -232,7 +287,7 @@ void assetsys_init(assetsys *AssetSys, char *Root)
     else
     {
         // Verify the root directory exists
-        BY_HANDLE_FILE_INFORMATION FileInfo;
+        WIN32_FILE_ATTRIBUTE_DATA FileInfo;
         BOOL Err = GetFileAttributesEx(Root,
                                        GetFileExInfoStandard,
                                        &FileInfo);
@@ -251,25 +306,20 @@ void assetsys_init(assetsys *AssetSys, char *Root)
         AssetSys->RootStr = mstr_init(Root, strlen(Root));
     }
     
-    AssetSys->Root = hash_bytes(mstr_to_cstr(&AssetSys->RootStr), AssetSys->RootStr.Len);
+    AssetSys->Root = string_intern(Core->Strings, mstr_to_cstr(&AssetSys->RootStr), mstr_len(&AssetSys->RootStr));
     
     // Setup the file_pool major list
-    AssetSys->FilePoolCount = 1;
-    AssetSys->FilePoolCap   = 1;
-    AssetSys->FilePool = (assetsys_file_pool*)memory_alloc(Core->Memory, 
-                                                           sizeof(assetsys_file_pool) * AssetSys->FilePoolCap);
-    assetsys_file_pool_init(AssetSys->FilePool + 0);
+    assetsys_file_pool FilePool;
+    assetsys_file_pool_init(&FilePool);
     
-    // Setup the Mounted files list
-    AssetSys->MountedFilesCap   = 10;
-    AssetSys->MountedFilesCount = 0;
-    AssetSys->MountedFiles = memory_alloc(Core->Memory, 
-                                          AssetSys->MountedFilesCap * sizeof(assetsys_mount_point));
+    arr_init(AssetSys->FilePool, allocator_heap(Core->Memory, MemoryTag_AssetSys), 1);
+    arr_put(AssetSys->FilePool, FilePool);
     
-    for (u32 i = 0; i < AssetSys->MountedFilesCap; ++i)
-    {
-        AssetSys->MountedFiles[i].Type = MountType_Unknown;
-    }
+    // Setup the Mounted files list
+    arr_init(AssetSys->MountedFiles, allocator_heap(Core->Memory, MemoryTag_AssetSys), 10);
+    mount_map_init(&AssetSys->MountIndex, allocator_heap(Core->Memory, MemoryTag_AssetSys), 10);
+    path_map_init(&AssetSys->PathIndex, allocator_heap(Core->Memory, MemoryTag_AssetSys), 1024);
+    arr_init(AssetSys->Packs, allocator_heap(Core->Memory, MemoryTag_AssetSys), 4);
     
     AssetSys->OpenFilesMask[0] = 0;
     AssetSys->OpenFilesMask[1] = 0;
@@ -282,6 +332,10 @@ void assetsys_init(assetsys *AssetSys, char *Root)
         AssetSys->OpenFiles[i].MemoryOffset = 0;
         AssetSys->OpenFiles[i].FileOffset   = 0;
         AssetSys->OpenFiles[i].Fid          = assetsys_file_id_invalid;
+        AssetSys->OpenFiles[i].Compression  = MpkCompression_None;
+        AssetSys->OpenFiles[i].Decoded      = NULL;
+        
+        AssetSys->FileMemory[i] = NULL;
     }
     
     SYSTEM_INFO sSysInfo;
@@ -289,73 +343,101 @@ void assetsys_init(assetsys *AssetSys, char *Root)
     
     GetSystemInfo(&sSysInfo);
     AssetSys->PageSize = sSysInfo.dwPageSize;
+    
+    block_decoder_init(&AssetSys->Decoder, 0);
 }
 
 void assetsys_free(assetsys *AssetSys)
 {
     mstr_free(&AssetSys->RootStr);
     
-    if (AssetSys->MountedFiles) memory_release(Core->Memory, AssetSys->MountedFiles);
-    AssetSys->MountedFilesCap = 0;
-    AssetSys->MountedFilesCount = 0;
+    arr_free(AssetSys->MountedFiles);
+    mount_map_free(&AssetSys->MountIndex);
+    path_map_free(&AssetSys->PathIndex);
     
-    for (u32 i = 0; i < AssetSys->FilePoolCount; ++i)
+    for (u32 i = 0; i < arr_len(AssetSys->FilePool); ++i)
     {
         assetsys_file_pool_free(AssetSys->FilePool + i);
     }
     
-    if (AssetSys->FilePool) memory_release(Core->Memory, AssetSys->FilePool);
-    AssetSys->FilePoolCap = 0;
-    AssetSys->FilePoolCount = 0;
+    arr_free(AssetSys->FilePool);
+    
+    for (u32 i = 0; i < arr_len(AssetSys->Packs); ++i)
+    {
+        UnmapViewOfFile(AssetSys->Packs[i]);
+    }
+    
+    arr_free(AssetSys->Packs);
+    
+    block_decoder_free(&AssetSys->Decoder);
 }
 
-file_internal assetsys_file_id assetsys_find_fid(assetsys *AssetSys, assetsys_file_id CurrentId, comparator_list *CompList)
+file_internal void assetsys_add_child_file(assetsys_file *File, assetsys_file_id Child)
 {
-    assetsys_file_id Result = assetsys_file_id_invalid;
-    
-    assetsys_file *File = assetsys_get_file(AssetSys, CurrentId);
-    u128 Comparator = CompList->Comparators[CompList->Idx];
-    
-    for (u32 i = 0; i < File->ChildFileCount; ++i)
+    if (!File->ChildFiles) arr_init(File->ChildFiles, allocator_heap(Core->Memory, MemoryTag_AssetSys), 8);
+    arr_put(File->ChildFiles, Child);
+}
+
+// Walks down the directory tree from Fid, one component of Path at a time.
+// Path has to be normalized. Directories are listed as the walk enters them,
+// so a name is only looked up in the string table once the files it could
+// match have been interned.
+file_internal assetsys_file_id assetsys_find_fid(assetsys *AssetSys, assetsys_file_id Fid, const char *Path, u32 PathLen)
+{
+    for (u32 Start = 0; Start < PathLen;)
     {
-        assetsys_file *ChildFile = assetsys_get_file(AssetSys, File->ChildFiles[i]);
+        u32 End = Start;
+        while (End < PathLen && Path[End] != '/') ++End;
+        
+        assetsys_enumerate_directory(AssetSys, Fid);
+        
+        // A name that was never interned is not the name of any file
+        string_id Name = string_find(Core->Strings, Path + Start, End - Start);
+        if (Name == StringId_None) return assetsys_file_id_invalid;
         
-        if (compare_hash(ChildFile->HashedName, Comparator))
+        assetsys_file *File = assetsys_get_file(AssetSys, Fid);
+        assetsys_file_id Child = assetsys_file_id_invalid;
+        
+        for (u32 i = 0; i < arr_len(File->ChildFiles); ++i)
         {
-            if (CompList->Idx + 1 == CompList->Count)
-            {
-                Result = ChildFile->Id;
-            }
-            else
+            assetsys_file *ChildFile = assetsys_get_file(AssetSys, File->ChildFiles[i]);
+            if (ChildFile->NameId == Name)
             {
-                CompList->Idx++;
-                Result = assetsys_find_fid(AssetSys, File->ChildFiles[i], CompList);
+                Child = File->ChildFiles[i];
+                break;
             }
-            
-            break;
         }
+        
+        if (!assetsys_valid_file_id(Child)) return assetsys_file_id_invalid;
+        
+        Fid   = Child;
+        Start = End + 1;
     }
     
-    return Result;
+    return Fid;
 }
 
 
 file_internal assetsys_file_id assetsys_insert_file_in_tree(assetsys *AssetSys, 
                                                             comparator_list *CompList, 
                                                             assetsys_file_id MountFid, 
+                                                            u64 PathKey,
                                                             const char *Filename, u32 FilenameLen,
                                                             const char *Directory, u32 DirectoryLen)
 {
     assetsys_file_id Result = assetsys_file_id_invalid;
     
+    // The directories on the way are listed first, otherwise listing one later
+    // would add the new file a second time
+    assetsys_enumerate_directory(AssetSys, MountFid);
     assetsys_file *File = assetsys_get_file(AssetSys, MountFid);
-    u128 Comparator = CompList->Comparators[CompList->Idx];
+    string_id Comparator = CompList->Comparators[CompList->Idx];
     
-    for (u32 i = 0; i < File->ChildFileCount; ++i)
+    for (u32 i = 0; i < arr_len(File->ChildFiles); ++i)
     {
         assetsys_file *ChildFile = assetsys_get_file(AssetSys, File->ChildFiles[i]);
         
-        if (compare_hash(ChildFile->HashedName, Comparator))
+        if (ChildFile->NameId == Comparator)
         {
             if (CompList->Idx + 1 == CompList->Count)
             {
@@ -363,6 +445,9 @@ file_internal assetsys_file_id assetsys_insert_file_in_tree(assetsys *AssetSys,
                 break;
             }
             
+            assetsys_enumerate_directory(AssetSys, File->ChildFiles[i]);
+            ChildFile = assetsys_get_file(AssetSys, File->ChildFiles[i]);
+            
             CompList->Idx++;
             File = ChildFile;
             i = 0;
@@ -370,62 +455,162 @@ file_internal assetsys_file_id assetsys_insert_file_in_tree(assetsys *AssetSys,
     }
     
     Result = assetsys_file_init(AssetSys, Filename, FilenameLen, true, Directory, DirectoryLen);
+    if (!assetsys_valid_file_id(Result)) return Result;
+    
+    assetsys_file *NewFile = assetsys_get_file(AssetSys, Result);
+    NewFile->Parent = File->Id;
     
     // Insert the new file into the asset list
-    assetsys_file_id *ChildFilesCpy = memory_alloc(Core->Memory, sizeof(assetsys_file_id) * File->ChildFileCount + 1);
-    memcpy(ChildFilesCpy, File->ChildFiles, sizeof(assetsys_file_id) * File->ChildFileCount);
-    File->ChildFiles[File->ChildFileCount++] = Result;
+    assetsys_add_child_file(File, Result);
+    assetsys_index_file(AssetSys, PathKey, Result);
     
     return Result;
 }
 
-file_internal assetsys_mount_point assetsys_find_mount_point(assetsys *AssetSys, const char *MountName)
+//~ Path index
+
+// Rewrites a path relative to a mount into the form used by the path index:
+// '/' separators, no "." components, no leading, trailing or repeated
+// separators. Buffer has to hold MAX_ASSETSYS_PATH characters, longer paths
+// are cut off. Returns the length of the normalized path.
+file_internal u32 assetsys_normalize_path(char *Buffer, const char *Path, u32 PathLen)
 {
-    assetsys_mount_point Result;
-    
-    u128 MountHash = hash_bytes((void*)MountName, strlen(MountName));
+    u32 Len = 0;
     
-    for (u32 i = 0; i < AssetSys->MountedFilesCount; ++i)
+    for (u32 i = 0; i < PathLen;)
     {
-        if (compare_hash(MountHash, AssetSys->MountedFiles[i].Name))
+        while (i < PathLen && (Path[i] == '/' || Path[i] == '\\')) ++i;
+        
+        u32 Start = i;
+        while (i < PathLen && Path[i] != '/' && Path[i] != '\\') ++i;
+        
+        u32 ComponentLen = i - Start;
+        if (ComponentLen == 0 || (ComponentLen == 1 && Path[Start] == '.')) continue;
+        
+        // Room for the separator and a null terminator
+        if (Len + ComponentLen + 2 > MAX_ASSETSYS_PATH)
         {
-            Result = AssetSys->MountedFiles[i];
+            mprinte("Path is too long for the asset system: \"%.*s\"\n", PathLen, Path);
             break;
         }
+        
+        if (Len > 0) Buffer[Len++] = '/';
+        memcpy(Buffer + Len, Path + Start, ComponentLen);
+        Len += ComponentLen;
     }
     
+    return Len;
+}
+
+// Path has to be normalized. The key is a 64 bit hash and is trusted without
+// comparing paths: at the 65k files an asset system can hold, the odds of two
+// paths colliding are around 1 in 10 billion.
+file_internal u64 assetsys_path_key(string_id MountName, const char *Path, u32 PathLen)
+{
+    return hash64_seeded(Path, PathLen, MountName);
+}
+
+// The first file added for a key wins
+file_internal void assetsys_index_file(assetsys *AssetSys, u64 PathKey, assetsys_file_id Fid)
+{
+    bool Inserted;
+    assetsys_file_id *Slot = path_map_insert(&AssetSys->PathIndex, PathKey, &Inserted);
+    if (Slot && Inserted) *Slot = Fid;
+}
+
+// Finds a file from its path relative to a mount. The first lookup of a path
+// walks the directory tree, listing the directories on the way, and adds the
+// file to the index so the next lookups of the path don't.
+file_internal assetsys_file_id assetsys_lookup(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Filepath)
+{
+    if (!assetsys_valid_file_id(Mount->File)) return assetsys_file_id_invalid;
+    
+    char Path[MAX_ASSETSYS_PATH];
+    u32 PathLen = assetsys_normalize_path(Path, Filepath, (u32)strlen(Filepath));
+    Path[PathLen] = 0;
+    
+    u64 PathKey = assetsys_path_key(Mount->Name, Path, PathLen);
+    
+    assetsys_file_id *Indexed = path_map_find(&AssetSys->PathIndex, PathKey);
+    if (Indexed) return *Indexed;
+    
+    assetsys_file_id Result = assetsys_find_fid(AssetSys, Mount->File, Path, PathLen);
+    if (assetsys_valid_file_id(Result)) assetsys_index_file(AssetSys, PathKey, Result);
+    
+    return Result;
+}
+
+file_internal assetsys_mount_point* assetsys_get_mount_point(assetsys *AssetSys, string_id MountName)
+{
+    u32 *Index = mount_map_find(&AssetSys->MountIndex, MountName);
+    return (Index) ? AssetSys->MountedFiles + *Index : NULL;
+}
+
+file_internal assetsys_mount_point assetsys_find_mount_point(assetsys *AssetSys, string_id MountName)
+{
+    assetsys_mount_point Result = {0};
+    
+    assetsys_mount_point *Mount = assetsys_get_mount_point(AssetSys, MountName);
+    if (Mount) Result = *Mount;
+    
     return Result;
 }
 
+// The first mount with a name wins, later mounts with the same name are kept
+// but can not be looked up by name
+file_internal void assetsys_add_mount_point(assetsys *AssetSys, assetsys_mount_point *Mount)
+{
+    u32 Index = arr_len(AssetSys->MountedFiles);
+    arr_put(AssetSys->MountedFiles, *Mount);
+    
+    bool Inserted;
+    u32 *Slot = mount_map_insert(&AssetSys->MountIndex, Mount->Name, &Inserted);
+    if (Slot && Inserted) *Slot = Index;
+}
+
 // Mount a file (file/directory/zip) from a name
 void assetsys_mount(assetsys *AssetSys, const char *Filename, const char *MountName)
 {
-    assetsys_file_id Root = assetsys_file_init(AssetSys, Filename, strlen(Filename), false, NULL, 0);
-    
-    if (AssetSys->MountedFilesCount + 1 > AssetSys->MountedFilesCap)
+    u32 FilenameLen = strlen(Filename);
+    if (FilenameLen > 4 && strcmp(Filename + FilenameLen - 4, ".mpk") == 0)
     {
-        u32 NewCap = AssetSys->MountedFilesCap * 2;
-        assetsys_mount_point *MountedFiles = memory_alloc(Core->Memory, sizeof(assetsys_mount_point) * NewCap);
+        assetsys_mount_point Mount = {0};
+        Mount.Name = string_intern_cstr(Core->Strings, MountName);
+        Mount.AbsolutePath = mstr_init((char*)Filename, FilenameLen);
         
-        for (u32 i = 0; i < AssetSys->MountedFilesCount; ++i) MountedFiles[i] = AssetSys->MountedFiles[i];
-        memory_release(Core->Memory, AssetSys->MountedFiles);
+        if (assetsys_mount_pack(AssetSys, Filename, &Mount)) assetsys_add_mount_point(AssetSys, &Mount);
+        else mstr_free(&Mount.AbsolutePath);
         
-        AssetSys->MountedFilesCap = NewCap;
-        AssetSys->MountedFiles = MountedFiles;
+        return;
+    }
+    
+    assetsys_file_id Root = assetsys_file_init(AssetSys, Filename, strlen(Filename), false, NULL, 0);
+    if (!assetsys_valid_file_id(Root))
+    {
+        mprinte("Unable to mount \"%s\"!\n", Filename);
+        return;
     }
     
     assetsys_mount_point Mount = {0};
     Mount.Type = MountType_Directory;
-    Mount.Name = hash_bytes((void*)MountName, strlen(MountName));
+    Mount.Name = string_intern_cstr(Core->Strings, MountName);
     Mount.File = Root;
     Mount.AbsolutePath = mstr_init((char*)Filename, strlen(Filename));
     
-    AssetSys->MountedFiles[AssetSys->MountedFilesCount++] = Mount;
+    assetsys_add_mount_point(AssetSys, &Mount);
 }
 
 void assetsys_mountr(assetsys *AssetSys, const char *Filename, const char *MountName, const char *RelativeMountName)
 {
-    assetsys_file_id ParentMountFid = assetsys_find_mount_point(AssetSys, RelativeMountName).File;
+    string_id RelativeMountId = string_find(Core->Strings, RelativeMountName, strlen(RelativeMountName));
+    assetsys_mount_point ParentMount = assetsys_find_mount_point(AssetSys, RelativeMountId);
+    assetsys_file_id ParentMountFid = ParentMount.File;
+    
+    if (ParentMount.Type == MountType_Pack)
+    {
+        mprinte("Unable to mount \"%s\", mounts can not be relative to a pack!\n", Filename);
+        return;
+    }
     
     if (!assetsys_valid_file_id(ParentMountFid))
     {
@@ -435,79 +620,199 @@ void assetsys_mountr(assetsys *AssetSys, const char *Filename, const char *Mount
     
     // File is relative to the above mount point, files are already allocated.
     // Find the assetsys_file_id to mount it.
-    u128 HashedMountName = hash_bytes((void*)MountName, strlen(MountName));
+    string_id MountNameId = string_intern_cstr(Core->Strings, MountName);
     
-    u32 Count = 1;
-    char *pch;
+    char Path[MAX_ASSETSYS_PATH];
+    u32 PathLen = assetsys_normalize_path(Path, Filename, (u32)strlen(Filename));
     
-    // how many directories are there?
-    pch = strchr(Filename, '/');
+    assetsys_file_id MountFid = assetsys_find_fid(AssetSys, ParentMountFid, Path, PathLen);
     
-    while (pch != NULL)
+    if (assetsys_valid_file_id(MountFid))
     {
-        pch = strchr(pch + 1, '/');
-        Count++;
-    };
+        assetsys_mount_point Mount = {0};
+        Mount.Type = MountType_Directory;
+        Mount.Name = MountNameId;
+        Mount.File = MountFid;
+        
+        
+        assetsys_file *ParentFile = assetsys_get_file(AssetSys, ParentMountFid);
+        
+        mstr_builder PathBuilder;
+        mstr_builder_init(&PathBuilder, Core->Scratch, 0);
+        mstr_format(&PathBuilder, "%s/%s", mstr_to_cstr(&ParentFile->Name), Filename);
+        Mount.AbsolutePath = mstr_init(PathBuilder.Buffer, PathBuilder.Len);
+        
+        assetsys_add_mount_point(AssetSys, &Mount);
+    }
+    else
+    {
+        mprinte("Unable to mount \"%s\"!\n", Filename);
+    }
+}
+
+//~ Packs
+
+// The whole pack is mapped once. Finding a file in it is a search of the
+// table of contents, and reading one is a copy out of the view, so neither
+// goes to the OS.
+file_internal bool assetsys_mount_pack(assetsys *AssetSys, const char *Filename, assetsys_mount_point *Mount)
+{
+    HANDLE File = CreateFileA(Filename,
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              0,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_READONLY | FILE_FLAG_RANDOM_ACCESS, 0);
+    
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        mprinte("Unable to open the pack \"%s\"!\n", Filename);
+        return false;
+    }
     
-    // Build the comparator list
-    comparator_list CompList = {0};
-    CompList.Count = Count;
-    CompList.Idx = 0;
-    CompList.Comparators = memory_alloc(Core->Memory, CompList.Count * sizeof(u128));
+    LARGE_INTEGER Size;
+    GetFileSizeEx(File, &Size);
     
-    pch = NULL;
-    pch = strchr(Filename, '/');
-    char *Offset = (char*)Filename;
+    // The view keeps the mapping and the file open, neither handle is needed
+    // once it exists
+    const mpk_header *Pack = NULL;
+    if ((u64)Size.QuadPart >= sizeof(mpk_header))
+    {
+        HANDLE Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (Mapping)
+        {
+            Pack = (const mpk_header*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(Mapping);
+        }
+    }
+    CloseHandle(File);
     
-    while (pch != NULL)
+    if (!Pack || !mpk_validate(Pack, (u64)Size.QuadPart))
     {
-        CompList.Comparators[CompList.Idx++] = hash_bytes(Offset, pch - Offset);
-        Offset += pch - Offset + 1;
-        pch = strchr(pch + 1, '/');
+        mprinte("\"%s\" is not a valid pack!\n", Filename);
+        if (Pack) UnmapViewOfFile(Pack);
+        return false;
     }
     
-    CompList.Comparators[CompList.Idx] = hash_bytes(Offset, strlen(Filename) - (Offset - Filename));
-    CompList.Idx = 0;
+    Mount->Type = MountType_Pack;
+    Mount->File = assetsys_file_id_invalid;
+    Mount->Pack = arr_len(AssetSys->Packs);
+    arr_put(AssetSys->Packs, Pack);
     
-    // Start the scan with the root.
-    assetsys_file_id RootFid = AssetSys->MountedFiles[MOUNT_ROOT_IDX].File;
-    assetsys_file_id MountFid = assetsys_find_fid(AssetSys, ParentMountFid, &CompList);
+    return true;
+}
+
+file_internal const mpk_entry* assetsys_find_pack_entry(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Filepath)
+{
+    char Path[MAX_ASSETSYS_PATH];
+    u32 PathLen = assetsys_normalize_path(Path, Filepath, (u32)strlen(Filepath));
     
-    // release comparator list
-    if (CompList.Comparators) memory_release(Core->Memory, CompList.Comparators);
+    return mpk_find(AssetSys->Packs[Mount->Pack], Path, PathLen);
+}
+
+// A file in a pack is opened without a handle, its memory is its part of the
+// pack's view. Reads copy out of it and closing it only releases the slot.
+file_internal file_id assetsys_open_pack_entry(assetsys *AssetSys, assetsys_mount_point *Mount, const char *Filepath, file_mode Mode)
+{
+    if (Mode != FileMode_Read)
+    {
+        mprinte("Unable to open \"%s\" for writing, packs are read only!\n", Filepath);
+        return file_id_invalid;
+    }
     
-    if (assetsys_valid_file_id(MountFid))
+    const mpk_entry *Entry = assetsys_find_pack_entry(AssetSys, Mount, Filepath);
+    if (!Entry)
     {
-        if (AssetSys->MountedFilesCount + 1 > AssetSys->MountedFilesCap)
-        {
-            u32 NewCap = AssetSys->MountedFilesCap * 2;
-            assetsys_mount_point *MountedFiles = memory_alloc(Core->Memory, sizeof(assetsys_mount_point) * NewCap);
-            
-            for (u32 i = 0; i < AssetSys->MountedFilesCount; ++i) MountedFiles[i] = AssetSys->MountedFiles[i];
-            memory_release(Core->Memory, AssetSys->MountedFiles);
-            
-            AssetSys->MountedFilesCap = NewCap;
-            AssetSys->MountedFiles = MountedFiles;
-        }
-        
-        assetsys_mount_point Mount = {0};
-        Mount.Type = MountType_Directory;
-        Mount.Name = HashedMountName;
-        Mount.File = MountFid;
-        
-        
-        assetsys_file *ParentFile = assetsys_get_file(AssetSys, ParentMountFid);
+        mprinte("Could not find the file at the specified mount point! File: \"%s\"\n", Filepath);
+        return file_id_invalid;
+    }
+    
+    file_id FileIndex = assetsys_acquire_open_file(AssetSys);
+    if (FileIndex == file_id_invalid)
+    {
+        mprinte("Unable to open file \"%s\"! Too many open files!\n", Filepath);
+        return file_id_invalid;
+    }
+    
+    const mpk_header *Pack = AssetSys->Packs[Mount->Pack];
+    AssetSys->FileMemory[FileIndex] = (void*)mpk_data(Pack, Entry);
+    
+    file_info *FileInfo = AssetSys->OpenFiles + FileIndex;
+    FileInfo->Mode         = Mode;
+    FileInfo->Handle       = INVALID_HANDLE_VALUE;
+    FileInfo->Size         = Entry->RawSize;
+    FileInfo->Memory       = AssetSys->FileMemory + FileIndex;
+    FileInfo->MemoryOffset = 0;
+    FileInfo->FileOffset   = 0;
+    FileInfo->Fid          = assetsys_file_id_invalid;
+    FileInfo->Compression  = (mpk_compression)Entry->Compression;
+    FileInfo->Decoded      = NULL;
+    
+    return FileIndex;
+}
+
+// Copies Size bytes from Offset of a file in a pack to Buffer. For a block
+// stream, the blocks the range covers whole are decoded in place on the
+// decoder's threads, and the partial blocks at either end through a scratch
+// block.
+file_internal file_error assetsys_read_pack_data(assetsys *AssetSys, const void *Stored, mpk_compression Compression,
+                                                 u64 Offset, u64 Size, void *Buffer)
+{
+    if (Compression == MpkCompression_None)
+    {
+        memcpy(Buffer, (const u8*)Stored + Offset, Size);
+        return File_Success;
+    }
+    
+    if (Size == 0) return File_Success;
+    
+    const block_stream_header *Stream = (const block_stream_header*)Stored;
+    u64 BlockSize = Stream->BlockSize;
+    u64 End       = Offset + Size;
+    
+    u32 FirstBlock = (u32)(Offset / BlockSize);
+    u32 EndBlock   = (u32)((End + BlockSize - 1) / BlockSize);
+    
+    u32 FirstWhole = (Offset % BlockSize) ? FirstBlock + 1 : FirstBlock;
+    u32 EndWhole   = (End % BlockSize && End != Stream->RawSize) ? EndBlock - 1 : EndBlock;
+    
+    bool Decoded = true;
+    if (FirstWhole < EndWhole)
+    {
+        u8 *Dst = (u8*)Buffer + ((u64)FirstWhole * BlockSize - Offset);
+        Decoded = block_decoder_run(&AssetSys->Decoder, Stream, FirstWhole, EndWhole, Dst);
+    }
+    
+    // At most two partial blocks, or one when the range is inside a block
+    u32 Partial[2];
+    u32 PartialCount = 0;
+    if (FirstBlock < FirstWhole) Partial[PartialCount++] = FirstBlock;
+    if (EndWhole < EndBlock && (PartialCount == 0 || Partial[0] != EndWhole)) Partial[PartialCount++] = EndWhole;
+    
+    u8 *Scratch = NULL;
+    if (PartialCount > 0) Scratch = (u8*)memory_alloc_tagged(Core->Memory, BlockSize, MemoryTag_AssetSys);
+    
+    for (u32 i = 0; Decoded && i < PartialCount; ++i)
+    {
+        u64 BlockStart = (u64)Partial[i] * BlockSize;
+        u64 BlockEnd   = BlockStart + block_stream_raw_size(Stream, Partial[i]);
         
-        char Path[2048];
-        int WrittenChars = snprintf(Path, 2048, "%s/%s", mstr_to_cstr(&ParentFile->Name), Filename);
-        Mount.AbsolutePath = mstr_init(Path, WrittenChars);
+        u64 CopyStart = (Offset > BlockStart) ? Offset : BlockStart;
+        u64 CopyEnd   = (End < BlockEnd) ? End : BlockEnd;
         
-        AssetSys->MountedFiles[AssetSys->MountedFilesCount++] = Mount;
+        Decoded = block_stream_decode_block(Stream, Partial[i], Scratch);
+        if (Decoded) memcpy((u8*)Buffer + (CopyStart - Offset), Scratch + (CopyStart - BlockStart), CopyEnd - CopyStart);
     }
-    else
+    
+    if (Scratch) memory_release(Core->Memory, Scratch);
+    
+    if (!Decoded)
     {
-        mprinte("Unable to mount \"%s\"!\n", Filename);
+        mprinte("A compressed file in a pack is corrupt!\n");
+        return File_UnableToRead;
     }
+    
+    return File_Success;
 }
 
 file_internal assetsys_file_id assetsys_allocate_file(assetsys *AssetSys, assetsys_file_type FileType)
@@ -516,7 +821,7 @@ file_internal assetsys_file_id assetsys_allocate_file(assetsys *AssetSys, assets
     bool Found = false;
     
     // Scan through the existing File Pools to allocate a file
-    for (u32 i = 0; i < AssetSys->FilePoolCount; ++i)
+    for (u32 i = 0; i < arr_len(AssetSys->FilePool); ++i)
     {
         assetsys_file_pool_alloc(AssetSys->FilePool + i, &File);
         
@@ -526,7 +831,8 @@ file_internal assetsys_file_id assetsys_allocate_file(assetsys *AssetSys, assets
             File->Type           = FileType;
             File->FileInfo       = file_id_invalid;
             File->ChildFiles     = NULL;
-            File->ChildFileCount = 0;
+            File->Parent         = assetsys_file_id_invalid;
+            File->Enumerated     = false;
             
             Found = true;
             break;
@@ -537,97 +843,125 @@ file_internal assetsys_file_id assetsys_allocate_file(assetsys *AssetSys, assets
     // a new Pool and allocate from that one.
     if (!Found)
     {
-        if (AssetSys->FilePoolCount + 1 > AssetSys->FilePoolCap)
+        u32 PoolIdx = arr_len(AssetSys->FilePool);
+        if (PoolIdx < MAX_ASSETSYS_POOL_COUNT)
         {
-            u32 NewCap = AssetSys->FilePoolCap;
-            NewCap = (NewCap > MAX_ASSETSYS_POOL_COUNT) ? MAX_ASSETSYS_POOL_COUNT : NewCap; 
-            assetsys_file_pool *FilePool = (assetsys_file_pool*)memory_alloc(Core->Memory, 
-                                                                             sizeof(assetsys_file_pool) * NewCap);
-            
-            for (u32 i = 0; i < AssetSys->FilePoolCount; ++i) FilePool[i] = AssetSys->FilePool[i];
+            assetsys_file_pool FilePool;
+            assetsys_file_pool_init(&FilePool);
+            arr_put(AssetSys->FilePool, FilePool);
             
-            memory_release(Core->Memory, AssetSys->FilePool);
-            AssetSys->FilePool = FilePool;
+            if (PoolIdx < arr_len(AssetSys->FilePool)) assetsys_file_pool_alloc(AssetSys->FilePool + PoolIdx, &File);
         }
         
-        assetsys_file_pool_init(AssetSys->FilePool + AssetSys->FilePoolCount);
-        assetsys_file_pool_alloc(AssetSys->FilePool + AssetSys->FilePoolCount, &File);
-        
         if (!File) 
+        {
             mprinte("Failed to allocate file memory. Probably ran out of it.\n");
+            return assetsys_file_id_invalid;
+        }
         else 
         {
-            File->Id.Major       = AssetSys->FilePoolCount;
+            File->Id.Major       = PoolIdx;
             File->Type           = FileType;
             File->FileInfo       = file_id_invalid;
             File->ChildFiles     = NULL;
-            File->ChildFileCount = 0;
-            
-            AssetSys->FilePoolCount++;
+            File->Parent         = assetsys_file_id_invalid;
+            File->Enumerated     = false;
         }
     }
     
     return File->Id;
 }
 
-file_internal void assetsys_file_init_recurse_directory(assetsys *AssetSys, assetsys_file_id ParentFid, const char *Filepath)
+// Writes the path of a file on disk to Buffer, which has to hold
+// MAX_ASSETSYS_PATH characters: the path the root of its mount was mounted
+// with, then the names of the directories down to the file. Returns the length
+// of the path, or 0 if it is too long.
+file_internal u32 assetsys_file_path(assetsys *AssetSys, assetsys_file_id Fid, char *Buffer)
 {
-    assetsys_file *ParentFile = assetsys_get_file(AssetSys, ParentFid);
-    
-    WIN32_FIND_DATA FindFileData;
-    char Path[2048];
-    
-    snprintf(Path, 2048, "%s/*", Filepath);
+    // Built from the end, up the parents, and moved to the front after
+    u32 Start = MAX_ASSETSYS_PATH;
     
-    // Preprocess the directory file count
-    HANDLE Handle = FindFirstFileEx(Path, FindExInfoStandard, &FindFileData,
-                                    FindExSearchNameMatch, NULL, 0);
-    
-    u32 ChildCount = 0;
-    if (Handle != INVALID_HANDLE_VALUE)
+    for (;;)
     {
-        do
+        assetsys_file *File = assetsys_get_file(AssetSys, Fid);
+        bool IsRoot = !assetsys_valid_file_id(File->Parent);
+        
+        // Room for the separator and a null terminator
+        u32 NameLen = mstr_len(&File->Name);
+        if (NameLen + 2 > Start)
         {
-            if (strcmp(FindFileData.cFileName, ".") != 0 &&
-                strcmp(FindFileData.cFileName, "..") != 0 &&
-                FindFileData.cFileName[0] != '.' ) // don't allow hidden files or folders
-            {
-                ++ChildCount;
-            }
+            mprinte("Path is too long for the asset system: \"%s\"\n", mstr_to_cstr(&File->Name));
+            return 0;
         }
-        while (FindNextFile(Handle, &FindFileData) != 0);
+        
+        Start -= NameLen;
+        memcpy(Buffer + Start, mstr_to_cstr(&File->Name), NameLen);
+        
+        if (IsRoot) break;
+        
+        Buffer[--Start] = '/';
+        Fid = File->Parent;
     }
-    FindClose(Handle);
     
-    ParentFile->ChildFileCount = ChildCount;
-    ParentFile->ChildFiles = (assetsys_file_id*)memory_alloc(Core->Memory, sizeof(assetsys_file_id) * ParentFile->ChildFileCount);
+    u32 Len = MAX_ASSETSYS_PATH - Start;
+    memmove(Buffer, Buffer + Start, Len);
+    Buffer[Len] = 0;
     
-    // Now, load the files
-    ChildCount = 0;
+    return Len;
+}
+
+// Lists a directory the first time a lookup needs its children. Everything a
+// file keeps comes with the listing, so a directory costs one pass of
+// FindFirstFileEx/FindNextFile and no call per file.
+file_internal void assetsys_enumerate_directory(assetsys *AssetSys, assetsys_file_id Fid)
+{
+    assetsys_file *Directory = assetsys_get_file(AssetSys, Fid);
+    if (Directory->Type != FileType_Directory || Directory->Enumerated) return;
+    
+    // Only tried once, a directory that can't be listed stays empty
+    Directory->Enumerated = true;
+    
+    char Path[MAX_ASSETSYS_PATH];
+    u32 PathLen = assetsys_file_path(AssetSys, Fid, Path);
+    if (PathLen == 0 || PathLen + 3 > MAX_ASSETSYS_PATH) return;
     
-    Handle = FindFirstFileEx(Path, FindExInfoStandard, &FindFileData,
-                             FindExSearchNameMatch, NULL, 0);
+    memcpy(Path + PathLen, "/*", 3);
     
-    if (Handle != INVALID_HANDLE_VALUE)
+    // Basic info skips the 8.3 short names, which are never used, and a large
+    // fetch returns more entries per trip to the file system
+    WIN32_FIND_DATA FindData;
+    HANDLE Handle = FindFirstFileEx(Path, FindExInfoBasic, &FindData,
+                                    FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (Handle == INVALID_HANDLE_VALUE) return;
+    
+    do
     {
-        do
-        {
-            if (strcmp(FindFileData.cFileName, ".") != 0 &&
-                strcmp(FindFileData.cFileName, "..") != 0 &&
-                FindFileData.cFileName[0] != '.' ) // don't allow hidden files or folders
-            {
-                snprintf(Path, 2048, "%s/%s", Filepath, FindFileData.cFileName);
-                
-                assetsys_file_id ChildFid = assetsys_file_init(AssetSys, 
-                                                               FindFileData.cFileName, strlen(FindFileData.cFileName), 
-                                                               true, 
-                                                               Filepath, strlen(Filepath));
-                
-                ParentFile->ChildFiles[ChildCount++] = ChildFid;
-            }
-        }
-        while (FindNextFile(Handle, &FindFileData) != 0);
+        // ".", "..", and hidden files or folders are not added
+        if (FindData.cFileName[0] == '.') continue;
+        
+        bool IsDirectory = (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        assetsys_file_id ChildFid = assetsys_allocate_file(AssetSys, (IsDirectory) ? FileType_Directory : FileType_File);
+        
+        // Out of file memory, the rest of the directory is left out
+        if (!assetsys_valid_file_id(ChildFid)) continue;
+        
+        u32 NameLen = (u32)strlen(FindData.cFileName);
+        
+        assetsys_file *Child = assetsys_get_file(AssetSys, ChildFid);
+        Child->Name   = mstr_init(FindData.cFileName, NameLen);
+        Child->NameId = string_intern(Core->Strings, FindData.cFileName, NameLen);
+        Child->Parent = Fid;
+        
+        Child->Win32FileInfo.dwFileAttributes = FindData.dwFileAttributes;
+        Child->Win32FileInfo.ftCreationTime   = FindData.ftCreationTime;
+        Child->Win32FileInfo.ftLastAccessTime = FindData.ftLastAccessTime;
+        Child->Win32FileInfo.ftLastWriteTime  = FindData.ftLastWriteTime;
+        Child->Win32FileInfo.nFileSizeHigh    = FindData.nFileSizeHigh;
+        Child->Win32FileInfo.nFileSizeLow     = FindData.nFileSizeLow;
+        
+        assetsys_add_child_file(Directory, ChildFid);
     }
+    while (FindNextFile(Handle, &FindData) != 0);
     
     FindClose(Handle);
 }
@@ -637,7 +971,7 @@ file_internal assetsys_file_id assetsys_file_init(assetsys *AssetSys, const char
 {
     assetsys_file_id Result = {0};
     
-    BY_HANDLE_FILE_INFORMATION FileInfo;
+    WIN32_FILE_ATTRIBUTE_DATA FileInfo;
     BOOL Err;
     
     // If the filepath is a relative path, need to build the fullpath based on the
@@ -675,22 +1009,24 @@ file_internal assetsys_file_id assetsys_file_init(assetsys *AssetSys, const char
             if (FileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
             {
                 Result = assetsys_allocate_file(AssetSys, FileType_Directory);
-                
-                assetsys_file *File = assetsys_get_file(AssetSys, Result);
-                File->Name = mstr_init((char*)Filename, FilenameLen);
-                File->HashedName = hash_bytes((void*)Filename, FilenameLen);
-                File->Win32FileInfo = FileInfo;
-                
-                assetsys_file_init_recurse_directory(AssetSys, Result, Path);
+                if (assetsys_valid_file_id(Result))
+                {
+                    assetsys_file *File = assetsys_get_file(AssetSys, Result);
+                    File->Name = mstr_init((char*)Filename, FilenameLen);
+                    File->NameId = string_intern(Core->Strings, Filename, FilenameLen);
+                    File->Win32FileInfo = FileInfo;
+                }
             }
             else
             {
                 Result = assetsys_allocate_file(AssetSys, FileType_File);
-                
-                assetsys_file *File = assetsys_get_file(AssetSys, Result);
-                File->Name = mstr_init((char*)Filename, FilenameLen);
-                File->HashedName = hash_bytes((void*)Filename, FilenameLen);
-                File->Win32FileInfo = FileInfo;
+                if (assetsys_valid_file_id(Result))
+                {
+                    assetsys_file *File = assetsys_get_file(AssetSys, Result);
+                    File->Name = mstr_init((char*)Filename, FilenameLen);
+                    File->NameId = string_intern(Core->Strings, Filename, FilenameLen);
+                    File->Win32FileInfo = FileInfo;
+                }
             }
         }
     }
@@ -707,22 +1043,24 @@ file_internal assetsys_file_id assetsys_file_init(assetsys *AssetSys, const char
             if (FileInfo.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
             {
                 Result = assetsys_allocate_file(AssetSys, FileType_Directory);
-                
-                assetsys_file *File = assetsys_get_file(AssetSys, Result);
-                File->Name = mstr_init((char*)Filename, FilenameLen);
-                File->HashedName = hash_bytes((void*)Filename, FilenameLen);
-                File->Win32FileInfo = FileInfo;
-                
-                assetsys_file_init_recurse_directory(AssetSys, Result, Filename);
+                if (assetsys_valid_file_id(Result))
+                {
+                    assetsys_file *File = assetsys_get_file(AssetSys, Result);
+                    File->Name = mstr_init((char*)Filename, FilenameLen);
+                    File->NameId = string_intern(Core->Strings, Filename, FilenameLen);
+                    File->Win32FileInfo = FileInfo;
+                }
             }
             else
             {
                 Result = assetsys_allocate_file(AssetSys, FileType_File);
-                
-                assetsys_file *File = assetsys_get_file(AssetSys, Result);
-                File->Name = mstr_init((char*)Filename, FilenameLen);
-                File->HashedName = hash_bytes((void*)Filename, FilenameLen);
-                File->Win32FileInfo = FileInfo;
+                if (assetsys_valid_file_id(Result))
+                {
+                    assetsys_file *File = assetsys_get_file(AssetSys, Result);
+                    File->Name = mstr_init((char*)Filename, FilenameLen);
+                    File->NameId = string_intern(Core->Strings, Filename, FilenameLen);
+                    File->Win32FileInfo = FileInfo;
+                }
             }
         }
     }
@@ -741,17 +1079,15 @@ file_internal void assetsys_file_free(assetsys_file *File)
     }
     
     
-    if (File->ChildFiles) memory_release(Core->Memory, File->ChildFiles);
-    File->ChildFileCount = 0;
+    arr_free(File->ChildFiles);
     mstr_free(&File->Name);
-    File->HashedName.Upper = 0;
-    File->HashedName.Lower = 0;
+    File->NameId = StringId_None;
 }
 
 file_internal void assetsys_file_pool_init(assetsys_file_pool *FilePool)
 {
-    FilePool->Handles = (assetsys_file_t)memory_alloc(Core->Memory, 
-                                                      sizeof(assetsys_file) * MAX_ASSETSYS_POOL_FILE_COUNT);
+    FilePool->Handles = (assetsys_file_t)memory_alloc_tagged(Core->Memory, 
+                                                             sizeof(assetsys_file) * MAX_ASSETSYS_POOL_FILE_COUNT, MemoryTag_AssetSys);
     
     FilePool->AllocatedFiles = 0;
     
@@ -819,19 +1155,20 @@ file_internal void assetsys_build_comparator_list(comparator_list *List, const c
     // Build the comparator list
     List->Count = Count;
     List->Idx = 0;
-    List->Comparators = memory_alloc(Core->Memory, List->Count * sizeof(u128));
+    List->Comparators = frame_alloc(Core->Scratch, List->Count * sizeof(string_id));
     
     pch = NULL;
     pch = strchr(Filepath, '/');
     char *Offset = (char*)Filepath;
     
+    // Lookups only, a path to a file that does not exist should not grow the table
     while (pch != NULL)
     {
-        List->Comparators[List->Idx++] = hash_bytes(Offset, pch - Offset);
+        List->Comparators[List->Idx++] = string_find(Core->Strings, Offset, pch - Offset);
         Offset += pch - Offset + 1;
         pch = strchr(pch + 1, '/');
     }
-    List->Comparators[List->Idx] = hash_bytes(Offset, strlen(Filepath) - (Offset - Filepath));
+    List->Comparators[List->Idx] = string_find(Core->Strings, Offset, strlen(Filepath) - (Offset - Filepath));
     List->Idx = 0;
 }
 
@@ -846,11 +1183,11 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
     {
         if (MountName)
         {
-            MountPoint = assetsys_find_mount_point(AssetSys, MountName);
+            MountPoint = assetsys_find_mount_point(AssetSys, string_find(Core->Strings, MountName, strlen(MountName)));
         }
         else
         {
-            MountPoint = assetsys_find_mount_point(AssetSys, "root");
+            MountPoint = assetsys_find_mount_point(AssetSys, StringId_Root);
         }
         
         // TODO(Dustin): Error mount point?
@@ -869,19 +1206,29 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
         
     }
     
-    comparator_list CompList = {0};
-    assetsys_build_comparator_list(&CompList, Filepath);
+    if (IsRelative && MountPoint.Type == MountType_Pack)
+    {
+        return assetsys_open_pack_entry(AssetSys, &MountPoint, Filepath, Mode);
+    }
     
-    assetsys_file_id Fid = assetsys_find_fid(AssetSys, MountPoint.File, &CompList);
+    assetsys_file_id Fid = assetsys_lookup(AssetSys, &MountPoint, Filepath);
     
-    assetsys_file *File = assetsys_get_file(AssetSys, Fid);
-    if (file_id_is_valid(File->FileInfo))
+    // A cached copy would no longer match the file
+    if (Mode != FileMode_Read && assetsys_valid_file_id(Fid) && Core->AssetCache)
     {
-        // File is already open
-        
+        asset_cache_invalidate(Core->AssetCache, Fid.Mask);
     }
     
-    if (!assetsys_valid_file_id(Fid))
+    if (assetsys_valid_file_id(Fid))
+    {
+        assetsys_file *File = assetsys_get_file(AssetSys, Fid);
+        if (file_id_is_valid(File->FileInfo))
+        {
+            // File is already open
+            
+        }
+    }
+    else
     {
         // NOTE(Dustin): This means the file does not current exist in the filesystem. If the 
         // FileMode is set to Read, then return an invalid file id. Otherwise open the file with 
@@ -895,8 +1242,11 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
     
     // Open the file
     
-    char Path[2048];
-    snprintf(Path, 2048, "%s/%s", mstr_to_cstr(&MountPoint.AbsolutePath), Filepath);
+    // Built in scratch memory, the path is only needed until the file is open
+    mstr_builder PathBuilder;
+    mstr_builder_init(&PathBuilder, Core->Scratch, 0);
+    mstr_format(&PathBuilder, "%s/%s", mstr_to_cstr(&MountPoint.AbsolutePath), Filepath);
+    char *Path = mstr_builder_to_cstr(&PathBuilder);
     
     HANDLE FileHandle = INVALID_HANDLE_VALUE;
     bool FileDoesNotExist = false;
@@ -955,8 +1305,11 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
             comparator_list CompList;
             assetsys_build_comparator_list(&CompList, Filepath);
             
+            char RelativePath[MAX_ASSETSYS_PATH];
+            u32 RelativeLen = assetsys_normalize_path(RelativePath, Filepath, strlen(Filepath));
+            
             char *Filename = strrchr(Path, '/') + 1;
-            u32 FileLen = strlen(Path) - strlen(Filename);
+            u32 FileLen = strlen(Filename);
             
             char *Directory = Path;
             u32 DirLen = Filename - Directory - 1;
@@ -964,6 +1317,7 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
             Fid = assetsys_insert_file_in_tree(AssetSys, 
                                                &CompList, 
                                                MountPoint.File, 
+                                               assetsys_path_key(MountPoint.Name, RelativePath, RelativeLen),
                                                Filename, FileLen,
                                                Directory, DirLen);
         }
@@ -975,68 +1329,70 @@ file_id assetsys_open(assetsys *AssetSys, const char *Filepath, bool IsRelative,
         return file_id_invalid;
     }
     
-    file_info *FileInfo = NULL;
-    void* FileMemory = NULL;
-    u32 FileIndex = 0;
+    file_id FileIndex = assetsys_acquire_open_file(AssetSys);
     
-    for (u32 i = 0; i < 2; ++i)
-    {
-        // Negate the particular bitset. Ctz will find the first
-        // 1 starting from the the least significant digit. However,
-        // for the purposes of this bitlist, a 1 means an opened file,
-        // but we want to find unopened files. Negating the bitset will
-        // set all opened files to 0 and unopened files to 1.
-        // The found idx is the index of the file we want to open
-        u64 Mask = ~AssetSys->OpenFilesMask[i];
-        u32 Bit;
-        
-        if (Mask)
-            Bit = PlatformCtzl(Mask);
-        else
-            continue;
-        
-        FileIndex = i * 64 + Bit;
-        
-        FileInfo = AssetSys->OpenFiles + FileIndex;
-        
-        BIT_TOGGLE_1(AssetSys->OpenFilesMask[i], FileIndex);
-        
-        break;
-    }
-    
-    if (!FileInfo)
+    if (FileIndex == file_id_invalid)
     {
         mprinte("Unable to open file \"%s\"! Too many open files!\n", Filepath);
         CloseHandle(FileHandle);
         return Result;
     }
     
+    file_info *FileInfo = AssetSys->OpenFiles + FileIndex;
     FileInfo->Mode         = Mode;
     FileInfo->Handle       = FileHandle;
     FileInfo->Size         = GetFileSize(FileHandle, NULL);
-    FileInfo->Memory       = AssetSys->FileMemory + FileIndex; // NOTE(Dustin): Not guaranteed to be initialized
+    FileInfo->Memory       = AssetSys->FileMemory + FileIndex;
     FileInfo->MemoryOffset = 0;
     FileInfo->FileOffset   = 0;
     FileInfo->Fid          = Fid;
     
     Result = FileIndex;
     
-    // Now get the file and set the back pointer to the FileInfo
-    File->FileInfo = Result;
+    // Now get the file and set the back pointer to the FileInfo. A created
+    // file only has an id once it is in the tree.
+    if (assetsys_valid_file_id(Fid))
+    {
+        assetsys_file *File = assetsys_get_file(AssetSys, Fid);
+        File->FileInfo = Result;
+    }
     
     return Result;
 }
 
+// Finds a closed slot in OpenFiles and marks it open. Returns file_id_invalid
+// when every slot is taken.
+file_internal file_id assetsys_acquire_open_file(assetsys *AssetSys)
+{
+    for (u32 i = 0; i < 2; ++i)
+    {
+        // Negate the particular bitset. Ctz will find the first
+        // 1 starting from the the least significant digit. However,
+        // for the purposes of this bitlist, a 1 means an opened file,
+        // but we want to find unopened files. Negating the bitset will
+        // set all opened files to 0 and unopened files to 1.
+        // The found idx is the index of the file we want to open
+        u64 Mask = ~AssetSys->OpenFilesMask[i];
+        if (!Mask) continue;
+        
+        u32 Bit = PlatformCtzl(Mask);
+        AssetSys->OpenFilesMask[i] |= 1ULL << Bit;
+        
+        return i * 64 + Bit;
+    }
+    
+    return file_id_invalid;
+}
+
 file_error assetsys_load(assetsys *AssetSys, const char *Filepath, bool IsRelative, const char *MountName,
                          void *Buffer, u64 BufferSize)
 {
-    file_error Result = File_Success;
-    
     // TODO(Dustin): Load the file (or part of it) into memory
     file_id Fid = assetsys_open(AssetSys, Filepath, IsRelative, MountName, FileMode_Read);
+    if (Fid == file_id_invalid) return File_FileNotFound;
     
     file_info *File = AssetSys->OpenFiles + Fid;
-    assetsys_read(AssetSys, Fid, File->Size, Buffer, BufferSize);
+    file_error Result = assetsys_read(AssetSys, Fid, File->Size, Buffer, BufferSize);
     
     assetsys_close(AssetSys, Fid);
     
@@ -1049,6 +1405,15 @@ file_error assetsys_read(assetsys *AssetSys, file_id Fid, u64 ReadSize, void *Bu
     file_info *File = AssetSys->OpenFiles + Fid;
     
     if (ReadSize > BufferSize) Result = File_BufferTooSmall;
+    else if (File->Handle == INVALID_HANDLE_VALUE)
+    {
+        // A file in a pack, the read is a copy out of the pack's view
+        u64 Remaining = File->Size - File->FileOffset;
+        u64 CopySize  = (ReadSize < Remaining) ? ReadSize : Remaining;
+        
+        Result = assetsys_read_pack_data(AssetSys, *File->Memory, File->Compression, File->FileOffset, CopySize, Buffer);
+        if (Result == File_Success) File->FileOffset += CopySize;
+    }
     else
     {
         DWORD BytesRead;
@@ -1074,19 +1439,118 @@ file_error assetsys_fread(assetsys *AssetSys, file_id Fid, const char *Fmt, va_l
     return Result;
 }
 
+file_view assetsys_map(assetsys *AssetSys, const char *Filepath, bool IsRelative, const char *MountName, file_map_hint Hint)
+{
+    file_view Result;
+    Result.Data = NULL;
+    Result.Size = 0;
+    Result.Fid  = assetsys_open(AssetSys, Filepath, IsRelative, MountName, FileMode_Read);
+    
+    if (Result.Fid == file_id_invalid) return Result;
+    
+    file_info *File = AssetSys->OpenFiles + Result.Fid;
+    
+    // A mapping can't be created for an empty file, it gets an empty view
+    if (File->Size == 0) return Result;
+    
+    // A file in a pack is already in the pack's view, unless it is compressed.
+    // Then the view is a decoded copy, which lives until the file is closed.
+    if (File->Handle == INVALID_HANDLE_VALUE && File->Compression != MpkCompression_None)
+    {
+        File->Decoded = VirtualAlloc(NULL, File->Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        
+        if (!File->Decoded ||
+            assetsys_read_pack_data(AssetSys, *File->Memory, File->Compression, 0, File->Size, File->Decoded) != File_Success)
+        {
+            mprinte("Unable to map file \"%s\"!\n", Filepath);
+            assetsys_close(AssetSys, Result.Fid);
+            Result.Fid = file_id_invalid;
+            return Result;
+        }
+        
+        Result.Data = File->Decoded;
+        Result.Size = File->Size;
+        return Result;
+    }
+    else if (File->Handle == INVALID_HANDLE_VALUE)
+    {
+        Result.Data = *File->Memory;
+        Result.Size = File->Size;
+        return Result;
+    }
+    
+    // The view holds a reference to the mapping, so the mapping handle can be
+    // closed right away. The view itself is kept in the file's FileMemory slot
+    // and unmapped when the file is closed.
+    HANDLE Mapping = CreateFileMappingA(File->Handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (Mapping)
+    {
+        *File->Memory = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(Mapping);
+    }
+    
+    if (!*File->Memory)
+    {
+        mprinte("Unable to map file \"%s\"!\n", Filepath);
+        assetsys_close(AssetSys, Result.Fid);
+        Result.Fid = file_id_invalid;
+        return Result;
+    }
+    
+    // Win32 has no access pattern hint for a view. Faults on a mapped file are
+    // already read in clusters, which covers a sequential read, so only
+    // WillNeed does anything: the whole view is read in ahead of time.
+    if (Hint == FileMapHint_WillNeed)
+    {
+        WIN32_MEMORY_RANGE_ENTRY Range;
+        Range.VirtualAddress = *File->Memory;
+        Range.NumberOfBytes  = File->Size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+    }
+    
+    Result.Data = *File->Memory;
+    Result.Size = File->Size;
+    
+    return Result;
+}
+
+void assetsys_unmap(assetsys *AssetSys, file_view *View)
+{
+    if (View->Fid != file_id_invalid) assetsys_close(AssetSys, View->Fid);
+    
+    View->Data = NULL;
+    View->Size = 0;
+    View->Fid  = file_id_invalid;
+}
+
 void assetsys_close(assetsys *AssetSys, file_id Fid)
 {
     file_info *FileInfo = AssetSys->OpenFiles + Fid;
-    assetsys_file *File = assetsys_get_file(AssetSys, FileInfo->Fid);
     
-    if (FileInfo->Memory) FileInfo->Memory = NULL;
-    if (FileInfo->Handle) CloseHandle(FileInfo->Handle);
+    // Files in a pack have no handle, their memory is the pack's view
+    if (FileInfo->Memory)
+    {
+        if (*FileInfo->Memory && FileInfo->Handle != INVALID_HANDLE_VALUE) UnmapViewOfFile(*FileInfo->Memory);
+        *FileInfo->Memory = NULL;
+        FileInfo->Memory  = NULL;
+    }
+    if (FileInfo->Handle != INVALID_HANDLE_VALUE) CloseHandle(FileInfo->Handle);
+    if (FileInfo->Decoded) VirtualFree(FileInfo->Decoded, 0, MEM_RELEASE);
+    
+    // Files in a pack are not in the file tree
+    if (assetsys_valid_file_id(FileInfo->Fid))
+    {
+        assetsys_file *File = assetsys_get_file(AssetSys, FileInfo->Fid);
+        File->FileInfo = file_id_invalid;
+    }
+    
+    FileInfo->Handle       = INVALID_HANDLE_VALUE;
     FileInfo->Size         = 0;
     FileInfo->MemoryOffset = 0;
     FileInfo->FileOffset   = 0;
     FileInfo->Fid          = assetsys_file_id_invalid;
-    
-    File->FileInfo = file_id_invalid;
+    FileInfo->Compression  = MpkCompression_None;
+    FileInfo->Decoded      = NULL;
     
     u32 MaskIndex = Fid / 64;
     u32 BitIndex = Fid % 64;
@@ -1098,16 +1562,19 @@ void assetsys_close(assetsys *AssetSys, file_id Fid)
 void file_print_directory_tree(const char *MountName)
 {
     assetsys *AssetSys = Core->AssetSys;
-    u128 Comparator = hash_bytes((void*)MountName, strlen(MountName));
+    string_id Comparator = string_find(Core->Strings, MountName, strlen(MountName));
     
-    for (u32 i = 0; i < AssetSys->MountedFilesCount; ++i)
+    assetsys_mount_point *Mount = assetsys_get_mount_point(AssetSys, Comparator);
+    if (Mount && Mount->Type == MountType_Pack)
     {
-        if (compare_hash(Comparator, AssetSys->MountedFiles[i].Name))
-        {
-            assetsys_internal_traverse_tree(AssetSys, AssetSys->MountedFiles[i].File, 0);
-            break;
-        }
+        const mpk_header *Pack = AssetSys->Packs[Mount->Pack];
+        const mpk_entry *Entries = mpk_entries(Pack);
+        
+        mprint("%s\n", mstr_to_cstr(&Mount->AbsolutePath));
+        for (u32 i = 0; i < Pack->EntryCount; ++i)
+            mprint("\t%.*s\n", Entries[i].NameLen, mpk_name(Pack, Entries + i));
     }
+    else if (Mount) assetsys_internal_traverse_tree(AssetSys, Mount->File, 0);
 }
 
 file_id file_open(const char *Filepath, bool IsRelative, const char *MountName, file_mode Mode)
@@ -1118,6 +1585,10 @@ file_id file_open(const char *Filepath, bool IsRelative, const char *MountName,
 file_error file_load(const char *Filepath, bool IsRelative, const char *MountName,
                      void *Buffer, u64 Size)
 {
+    // A file already in the asset cache is copied from memory
+    file_error Result;
+    if (IsRelative && Core->AssetCache && asset_cache_copy(Core->AssetCache, Filepath, MountName, Buffer, Size, &Result)) return Result;
+    
     return assetsys_load(Core->AssetSys, Filepath, IsRelative, MountName, Buffer, Size);
 }
 
@@ -1126,34 +1597,39 @@ void file_close(file_id Fid)
     assetsys_close(Core->AssetSys, Fid);
 }
 
+file_view file_map(const char *Filepath, bool IsRelative, const char *MountName, file_map_hint Hint)
+{
+    return assetsys_map(Core->AssetSys, Filepath, IsRelative, MountName, Hint);
+}
+
+void file_unmap(file_view *View)
+{
+    assetsys_unmap(Core->AssetSys, View);
+}
+
 u64 file_get_fsize(const char *Filename, const char *MountName)
 {
     u64 Result = 0;
     
     assetsys *AssetSys = Core->AssetSys;
-    u128 MountNameHash = hash_bytes((void*)MountName, strlen(MountName)); 
+    string_id MountNameId = string_find(Core->Strings, MountName, strlen(MountName));
+    
+    assetsys_mount_point *Mount = assetsys_get_mount_point(AssetSys, MountNameId);
     
-    assetsys_mount_point *Mount = NULL;
-    for (u32 i = 0; i < AssetSys->MountedFilesCount; ++i)
+    if (Mount && Mount->Type == MountType_Pack)
     {
-        if (compare_hash(MountNameHash, AssetSys->MountedFiles[i].Name))
-        {
-            Mount = AssetSys->MountedFiles + i;
-            break;
-        }
+        const mpk_entry *Entry = assetsys_find_pack_entry(AssetSys, Mount, Filename);
+        if (Entry) Result = Entry->RawSize;
     }
-    
-    if (Mount)
+    else if (Mount)
     {
+        assetsys_file_id Fid = assetsys_lookup(AssetSys, Mount, Filename);
         
-        comparator_list CompList = {0};
-        assetsys_build_comparator_list(&CompList, Filename);
-        
-        assetsys_file_id Fid = assetsys_find_fid(AssetSys, Mount->File, &CompList);
-        
-        assetsys_file *File = assetsys_get_file(AssetSys, Fid);
-        
-        Result = ((u64)File->Win32FileInfo.nFileSizeHigh << 32) | ((u64)File->Win32FileInfo.nFileSizeLow);
+        if (assetsys_valid_file_id(Fid))
+        {
+            assetsys_file *File = assetsys_get_file(AssetSys, Fid);
+            Result = ((u64)File->Win32FileInfo.nFileSizeHigh << 32) | ((u64)File->Win32FileInfo.nFileSizeLow);
+        }
     }
     else
     {
@@ -1168,7 +1644,8 @@ u64 file_get_size(file_id Fid)
     u64 Result = 0;
     file_info *File = Core->AssetSys->OpenFiles + Fid;
     
-    if (File->Handle != INVALID_HANDLE_VALUE) Result = File->Size;
+    // A file in a pack has no handle, only its memory
+    if (File->Handle != INVALID_HANDLE_VALUE || File->Memory) Result = File->Size;
     
     return Result;
 }
@@ -0,0 +1,61 @@
+#ifndef PLATFORM_ASYNC_IO_H
+#define PLATFORM_ASYNC_IO_H
+
+// Asynchronous file reads. Requests are submitted in batches and their reads
+// are kept in flight by the OS, so a loader can decode one file while the
+// next ones are still coming off the disk. Reads complete in any order and
+// their completions are collected by polling.
+//
+// A request names a file the same way file_open does, and the buffer to read
+// it into. The buffer has to stay valid until the request's completion has
+// been collected.
+//
+// Requests are submitted from the thread that owns the asset system, as the
+// mount lookup is not thread safe. Completions can be polled from any thread.
+
+// Most reads in flight at once
+#define ASYNC_IO_MAX_REQUESTS 256
+
+typedef struct io_request
+{
+    const char *Filepath;
+    bool        IsRelative;
+    const char *MountName;
+    
+    void       *Buffer;
+    u64         BufferSize;
+    
+    u64         Offset; // where in the file to start reading
+    u64         Size;   // 0 reads from Offset to the end of the file
+    
+    void       *UserData; // handed back with the completion
+} io_request;
+
+typedef struct io_completion
+{
+    void       *UserData;
+    void       *Buffer;
+    u64         BytesRead;
+    file_error  Error;
+} io_completion;
+
+typedef struct async_io* async_io_t;
+
+void async_io_init(async_io_t Io);
+// Waits for the reads still in flight before releasing the queue
+void async_io_free(async_io_t Io);
+
+//~ Async File Api
+
+// Returns how many requests were submitted, starting from the first one. Fewer
+// than Count means the queue is full: collect some completions and submit the
+// rest. A request that fails to start (missing file, buffer too small) still
+// takes a slot and reports the error through its completion.
+u32 io_submit(io_request *Requests, u32 Count);
+// Collects up to MaxCount completions, waiting at most TimeoutMs for the first
+// one. A timeout of 0 never blocks, INFINITE waits for a completion.
+u32 io_poll(io_completion *Completions, u32 MaxCount, u32 TimeoutMs);
+// Requests submitted and not yet collected
+u32 io_pending();
+
+#endif //PLATFORM_ASYNC_IO_H
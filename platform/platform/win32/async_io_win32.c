@@ -0,0 +1,292 @@
+
+// Completions dequeued by a single call into the completion port
+#define ASYNC_IO_POLL_BATCH 64
+
+// Win32 backend: overlapped reads on a single I/O completion port. Every read
+// posts its completion to the port, and io_poll dequeues them in batches.
+typedef struct io_slot
+{
+    // First member, so the OVERLAPPED of a completion is its slot
+    OVERLAPPED  Overlapped;
+    
+    HANDLE      Handle;
+    void       *Buffer;
+    void       *UserData;
+    file_error  Error; // set when the read could not be started
+} io_slot;
+
+typedef struct async_io
+{
+    HANDLE        Port;
+    
+    io_slot       Slots[ASYNC_IO_MAX_REQUESTS];
+    
+    // Stack of free slot indices. Slots are taken on submit and returned on
+    // poll, which can be on different threads.
+    u16           FreeSlots[ASYNC_IO_MAX_REQUESTS];
+    u32           FreeCount;
+    spin_lock     Lock;
+} async_io;
+
+//~ Slots
+
+file_internal io_slot* async_io_acquire_slot(async_io *Io)
+{
+    io_slot *Result = NULL;
+    
+    spin_lock_acquire(&Io->Lock);
+    if (Io->FreeCount > 0) Result = Io->Slots + Io->FreeSlots[--Io->FreeCount];
+    spin_lock_release(&Io->Lock);
+    
+    return Result;
+}
+
+file_internal void async_io_release_slot(async_io *Io, io_slot *Slot)
+{
+    spin_lock_acquire(&Io->Lock);
+    Io->FreeSlots[Io->FreeCount++] = (u16)(Slot - Io->Slots);
+    spin_lock_release(&Io->Lock);
+}
+
+//~ Async IO
+
+void async_io_init(async_io *Io)
+{
+    Io->Port      = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
+    Io->FreeCount = ASYNC_IO_MAX_REQUESTS;
+    Io->Lock      = 0;
+    
+    if (!Io->Port) mprinte("Unable to create the completion port for async file reads!\n");
+    
+    for (u32 i = 0; i < ASYNC_IO_MAX_REQUESTS; ++i)
+    {
+        Io->Slots[i].Handle = INVALID_HANDLE_VALUE;
+        
+        // Popped from the back, so the first request gets the first slot
+        Io->FreeSlots[i] = (u16)(ASYNC_IO_MAX_REQUESTS - 1 - i);
+    }
+}
+
+file_internal assetsys_mount_point* async_io_find_mount(io_request *Request)
+{
+    string_id MountName = StringId_Root;
+    if (Request->MountName) MountName = string_find(Core->Strings, Request->MountName, strlen(Request->MountName));
+    
+    return assetsys_get_mount_point(Core->AssetSys, MountName);
+}
+
+// Builds the full path of a request the same way assetsys_open does. Returns
+// false if the mount does not exist or the path does not fit.
+file_internal bool async_io_build_path(char *Buffer, u32 BufferLen, io_request *Request, assetsys_mount_point *Mount)
+{
+    if (!Request->IsRelative)
+    {
+        return (u32)snprintf(Buffer, BufferLen, "%s", Request->Filepath) < BufferLen;
+    }
+    
+    if (!Mount) return false;
+    
+    return (u32)snprintf(Buffer, BufferLen, "%s/%s", mstr_to_cstr(&Mount->AbsolutePath), Request->Filepath) < BufferLen;
+}
+
+// A file in a pack is already mapped, so it is copied (or decoded) on the
+// submitting thread and its completion posted right away
+file_internal void async_io_read_pack(async_io *Io, io_slot *Slot, io_request *Request, assetsys_mount_point *Mount)
+{
+    u64 BytesRead = 0;
+    const mpk_entry *Entry = assetsys_find_pack_entry(Core->AssetSys, Mount, Request->Filepath);
+    
+    if (!Entry) Slot->Error = File_FileNotFound;
+    else
+    {
+        u64 Size = Request->Size;
+        if (Size == 0 && Entry->RawSize > Request->Offset) Size = Entry->RawSize - Request->Offset;
+        
+        // Same limits as a read of a loose file
+        bool InFile = (Request->Offset <= Entry->RawSize && Size <= Entry->RawSize - Request->Offset);
+        
+        if (Size > Request->BufferSize)          Slot->Error = File_BufferTooSmall;
+        else if (!InFile || Size > 0xFFFFFFFF)   Slot->Error = File_UnableToRead;
+        else
+        {
+            const mpk_header *Pack = Core->AssetSys->Packs[Mount->Pack];
+            Slot->Error = assetsys_read_pack_data(Core->AssetSys, mpk_data(Pack, Entry), (mpk_compression)Entry->Compression,
+                                                  Request->Offset, Size, Slot->Buffer);
+            
+            if (Slot->Error == File_Success) BytesRead = Size;
+        }
+    }
+    
+    PostQueuedCompletionStatus(Io->Port, (DWORD)BytesRead, 0, &Slot->Overlapped);
+}
+
+file_internal void async_io_start_read(async_io *Io, io_slot *Slot, io_request *Request)
+{
+    memset(&Slot->Overlapped, 0, sizeof(OVERLAPPED));
+    Slot->Handle   = INVALID_HANDLE_VALUE;
+    Slot->Buffer   = Request->Buffer;
+    Slot->UserData = Request->UserData;
+    Slot->Error    = File_Success;
+    
+    assetsys_mount_point *Mount = (Request->IsRelative) ? async_io_find_mount(Request) : NULL;
+    if (Mount && Mount->Type == MountType_Pack)
+    {
+        async_io_read_pack(Io, Slot, Request, Mount);
+        return;
+    }
+    
+    char Path[MAX_ASSETSYS_PATH];
+    
+    // Win32 has no asynchronous open, so the file is opened on
+    // the submitting thread and only the read is asynchronous.
+    if (async_io_build_path(Path, sizeof(Path), Request, Mount))
+    {
+        Slot->Handle = CreateFileA(Path,
+                                   GENERIC_READ,
+                                   FILE_SHARE_READ,
+                                   0,
+                                   OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_READONLY | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED, 0);
+    }
+    
+    if (Slot->Handle == INVALID_HANDLE_VALUE)
+    {
+        Slot->Error = File_FileNotFound;
+    }
+    else if (!CreateIoCompletionPort(Slot->Handle, Io->Port, 0, 0))
+    {
+        Slot->Error = File_UnableToRead;
+    }
+    else
+    {
+        u64 Size = Request->Size;
+        if (Size == 0)
+        {
+            LARGE_INTEGER FileSize;
+            GetFileSizeEx(Slot->Handle, &FileSize);
+            
+            if ((u64)FileSize.QuadPart > Request->Offset) Size = (u64)FileSize.QuadPart - Request->Offset;
+        }
+        
+        // ReadFile takes a 32 bit size
+        if (Size > Request->BufferSize) Slot->Error = File_BufferTooSmall;
+        else if (Size > 0xFFFFFFFF)     Slot->Error = File_UnableToRead;
+        else
+        {
+            Slot->Overlapped.Offset     = (DWORD)(Request->Offset & 0xFFFFFFFF);
+            Slot->Overlapped.OffsetHigh = (DWORD)(Request->Offset >> 32);
+            
+            // Whether it finishes right away or not, the read posts its
+            // completion to the port
+            if (ReadFile(Slot->Handle, Slot->Buffer, (DWORD)Size, NULL, &Slot->Overlapped) ||
+                GetLastError() == ERROR_IO_PENDING)
+            {
+                return;
+            }
+            
+            Slot->Error = File_UnableToRead;
+        }
+    }
+    
+    // The read never started, so nothing will complete it. Post the completion
+    // by hand, the error reaches the caller the same way a finished read does.
+    PostQueuedCompletionStatus(Io->Port, 0, 0, &Slot->Overlapped);
+}
+
+u32 async_io_submit(async_io *Io, io_request *Requests, u32 Count)
+{
+    u32 Result = 0;
+    
+    for (; Result < Count; ++Result)
+    {
+        io_slot *Slot = async_io_acquire_slot(Io);
+        if (!Slot) break;
+        
+        async_io_start_read(Io, Slot, Requests + Result);
+    }
+    
+    return Result;
+}
+
+u32 async_io_poll(async_io *Io, io_completion *Completions, u32 MaxCount, u32 TimeoutMs)
+{
+    u32 Result = 0;
+    OVERLAPPED_ENTRY Entries[ASYNC_IO_POLL_BATCH];
+    
+    while (Result < MaxCount)
+    {
+        ULONG Count   = (MaxCount - Result < ASYNC_IO_POLL_BATCH) ? MaxCount - Result : ASYNC_IO_POLL_BATCH;
+        ULONG Removed = 0;
+        
+        // Only wait for the first completion, then take whatever else is ready
+        DWORD Timeout = (Result == 0) ? TimeoutMs : 0;
+        if (!GetQueuedCompletionStatusEx(Io->Port, Entries, Count, &Removed, Timeout, FALSE)) break;
+        
+        for (u32 i = 0; i < Removed; ++i)
+        {
+            io_slot *Slot = (io_slot*)Entries[i].lpOverlapped;
+            io_completion *Completion = Completions + Result + i;
+            
+            Completion->UserData  = Slot->UserData;
+            Completion->Buffer    = Slot->Buffer;
+            Completion->BytesRead = Entries[i].dwNumberOfBytesTransferred;
+            Completion->Error     = Slot->Error;
+            
+            // Internal is the status of the read, 0 when it succeeded
+            if (Completion->Error == File_Success && Slot->Overlapped.Internal != 0)
+            {
+                Completion->Error = File_UnableToRead;
+            }
+            
+            if (Slot->Handle != INVALID_HANDLE_VALUE) CloseHandle(Slot->Handle);
+            Slot->Handle = INVALID_HANDLE_VALUE;
+            
+            async_io_release_slot(Io, Slot);
+        }
+        
+        Result += Removed;
+        if (Removed < Count) break;
+    }
+    
+    return Result;
+}
+
+u32 async_io_pending(async_io *Io)
+{
+    spin_lock_acquire(&Io->Lock);
+    u32 Result = ASYNC_IO_MAX_REQUESTS - Io->FreeCount;
+    spin_lock_release(&Io->Lock);
+    
+    return Result;
+}
+
+void async_io_free(async_io *Io)
+{
+    // Buffers of the reads in flight belong to the caller, the reads have to
+    // finish before the port goes away
+    io_completion Completions[ASYNC_IO_POLL_BATCH];
+    while (async_io_pending(Io) > 0)
+    {
+        async_io_poll(Io, Completions, ASYNC_IO_POLL_BATCH, INFINITE);
+    }
+    
+    if (Io->Port) CloseHandle(Io->Port);
+    Io->Port = NULL;
+}
+
+//~ User API
+
+u32 io_submit(io_request *Requests, u32 Count)
+{
+    return async_io_submit(Core->AsyncIo, Requests, Count);
+}
+
+u32 io_poll(io_completion *Completions, u32 MaxCount, u32 TimeoutMs)
+{
+    return async_io_poll(Core->AsyncIo, Completions, MaxCount, TimeoutMs);
+}
+
+u32 io_pending()
+{
+    return async_io_pending(Core->AsyncIo);
+}
@@ -0,0 +1,145 @@
+
+// Most worker threads a block decoder starts
+#define BLOCK_DECODER_MAX_THREADS 8
+
+// Decodes the blocks of a block stream (see utils/block_compress.h) on a small
+// pool of worker threads. A decode is a parallel for over the blocks: the
+// calling thread and the workers it wakes take blocks from a shared counter
+// until none are left, each one decoding straight into its place in the
+// destination buffer.
+//
+// One decode runs at a time, from the thread that owns the decoder.
+typedef struct block_decoder
+{
+    HANDLE        Threads[BLOCK_DECODER_MAX_THREADS];
+    u32           ThreadCount;
+    
+    // Released once for every worker that should help with the next decode
+    HANDLE        Wake;
+    volatile long Quit;
+    
+    // The decode in progress
+    const void   *Stream;
+    u8           *Dst;
+    u32           FirstBlock;
+    u32           EndBlock;
+    volatile long NextBlock;
+    volatile long Failed;
+    
+    // Workers that were woken for this decode and are done with it. The
+    // decode is not over until all of them are, or a late worker could pick
+    // up blocks of the next one with this one's stream.
+    volatile long WorkersDone;
+} block_decoder;
+
+//~ Decoding
+
+// Decodes blocks until the counter runs past the end
+file_internal void block_decoder_work(block_decoder *Decoder)
+{
+    const block_stream_header *Header = (const block_stream_header*)Decoder->Stream;
+    
+    for (;;)
+    {
+        u32 Block = Decoder->FirstBlock + (u32)(atomic_increment(&Decoder->NextBlock) - 1);
+        if (Block >= Decoder->EndBlock) break;
+        
+        u8 *Dst = Decoder->Dst + (u64)(Block - Decoder->FirstBlock) * Header->BlockSize;
+        if (!block_stream_decode_block(Decoder->Stream, Block, Dst)) atomic_store_long(&Decoder->Failed, 1);
+    }
+}
+
+file_internal DWORD WINAPI block_decoder_thread_proc(LPVOID Param)
+{
+    block_decoder *Decoder = (block_decoder*)Param;
+    
+    for (;;)
+    {
+        WaitForSingleObject(Decoder->Wake, INFINITE);
+        if (atomic_load_long(&Decoder->Quit)) break;
+        
+        block_decoder_work(Decoder);
+        atomic_increment(&Decoder->WorkersDone);
+    }
+    
+    return 0;
+}
+
+// ThreadCount of 0 starts one worker per core besides the calling thread
+void block_decoder_init(block_decoder *Decoder, u32 ThreadCount)
+{
+    memset(Decoder, 0, sizeof(block_decoder));
+    
+    if (ThreadCount == 0)
+    {
+        SYSTEM_INFO SystemInfo;
+        GetSystemInfo(&SystemInfo);
+        
+        ThreadCount = (SystemInfo.dwNumberOfProcessors > 1) ? SystemInfo.dwNumberOfProcessors - 1 : 0;
+    }
+    if (ThreadCount > BLOCK_DECODER_MAX_THREADS) ThreadCount = BLOCK_DECODER_MAX_THREADS;
+    
+    Decoder->Wake = CreateSemaphoreA(NULL, 0, BLOCK_DECODER_MAX_THREADS, NULL);
+    if (!Decoder->Wake)
+    {
+        mprinte("Unable to create the block decoder's semaphore, blocks will be decoded on one thread!\n");
+        return;
+    }
+    
+    for (u32 i = 0; i < ThreadCount; ++i)
+    {
+        Decoder->Threads[i] = CreateThread(NULL, 0, block_decoder_thread_proc, Decoder, 0, NULL);
+        if (!Decoder->Threads[i]) break;
+        
+        Decoder->ThreadCount++;
+    }
+}
+
+void block_decoder_free(block_decoder *Decoder)
+{
+    atomic_store_long(&Decoder->Quit, 1);
+    
+    if (Decoder->ThreadCount > 0)
+    {
+        ReleaseSemaphore(Decoder->Wake, Decoder->ThreadCount, NULL);
+        WaitForMultipleObjects(Decoder->ThreadCount, Decoder->Threads, TRUE, INFINITE);
+        
+        for (u32 i = 0; i < Decoder->ThreadCount; ++i) CloseHandle(Decoder->Threads[i]);
+    }
+    
+    if (Decoder->Wake) CloseHandle(Decoder->Wake);
+    
+    Decoder->ThreadCount = 0;
+    Decoder->Wake        = NULL;
+}
+
+// Decodes blocks [FirstBlock, EndBlock) of a validated stream. Dst is where
+// FirstBlock goes, the blocks after it follow every BlockSize bytes. Returns
+// false if a block is corrupt.
+bool block_decoder_run(block_decoder *Decoder, const void *Stream, u32 FirstBlock, u32 EndBlock, void *Dst)
+{
+    if (FirstBlock >= EndBlock) return true;
+    
+    Decoder->Stream      = Stream;
+    Decoder->Dst         = (u8*)Dst;
+    Decoder->FirstBlock  = FirstBlock;
+    Decoder->EndBlock    = EndBlock;
+    Decoder->NextBlock   = 0;
+    Decoder->Failed      = 0;
+    Decoder->WorkersDone = 0;
+    
+    // The calling thread takes a block as well, so a single block never
+    // wakes anyone
+    u32 Helpers = EndBlock - FirstBlock - 1;
+    if (Helpers > Decoder->ThreadCount) Helpers = Decoder->ThreadCount;
+    
+    // The semaphore orders the writes above before the workers' reads
+    if (Helpers > 0) ReleaseSemaphore(Decoder->Wake, Helpers, NULL);
+    
+    block_decoder_work(Decoder);
+    
+    // Every block is taken, only the blocks still being decoded are left
+    while ((u32)atomic_load_long(&Decoder->WorkersDone) < Helpers) SwitchToThread();
+    
+    return atomic_load_long(&Decoder->Failed) == 0;
+}
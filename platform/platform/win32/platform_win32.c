@@ -11,6 +11,11 @@
 #define LOG_BUFFER_SIZE 512
 #endif
 
+// Bytes of movable allocations the heap may move per frame
+#ifndef PLATFORM_COMPACT_BUDGET
+#define PLATFORM_COMPACT_BUDGET _KB(256)
+#endif
+
 // Library function declarations
 #include "library_loader.c"
 
@@ -68,6 +73,10 @@ void __Win32PrintMessage(console_color text_color, console_color background_colo
 void __Win32PrintError(console_color text_color, console_color background_color, char *fmt, va_list args);
 
 file_internal void MapleShutdown();
+file_internal void Win32DumpMemoryReport(const char *Filename);
+#ifdef MAPLE_MEMORY_TRACE
+file_internal void Win32DumpMemoryTrace(const char *Filename);
+#endif
 
 // source: Windows API doc: https://docs.microsoft.com/en-us/windows/win32/fileio/opening-a-file-for-reading-or-writing
 file_internal void DisplayError(LPTSTR lpszFunction)
@@ -111,6 +120,10 @@ file_internal void DisplayError(LPTSTR lpszFunction)
     LocalFree(lpDisplayBuf);
 }
 
+file_global tag_block PlatformHeap;
+// Messages are printed from worker threads too, the block is only touched under this
+file_global spin_lock  PlatformHeapLock;
+
 // An internal allocation scheme that allocates from the 2MB Platform Linear allcoator.
 // this functions is primarily used by print/formatting functions that need temporary,
 // dynamic memory. When the heap is filled, the allocator is reset.
@@ -118,25 +131,30 @@ file_internal void* PlatformLocalAlloc(u32 Size)
 {
     void* Result = NULL;
     
-#if 0
-    if (!PlatformHeap.Start)
-        PlatformHeap = TaggedHeapRequestAllocation(&Core->TaggedHeap, PlatformTag);
+    // Messages printed before the globals are initialized have nowhere
+    // to go but malloc, and are never freed.
+    if (!Core || !Core->TaggedHeap)
+    {
+        return malloc(Size);
+    }
+    
+    spin_lock_acquire(&PlatformHeapLock);
+    
+    if (!PlatformHeap.Heap)
+    {
+        tag_block_init(&PlatformHeap, Core->TaggedHeap, TaggedHeapTag_Platform);
+    }
     
-    Result = TaggedHeapBlockAlloc(&PlatformHeap, Size);
-    if (!Result)
+    // Rewind rather than requesting another block, messages are consumed right away
+    if (PlatformHeap.Start &&
+        (char*)PlatformHeap.Brkp + Size + TAGGED_HEAP_ALIGNMENT > (char*)PlatformHeap.Start + TAGGED_HEAP_BLOCK_SIZE)
     {
         PlatformHeap.Brkp = PlatformHeap.Start;
-        
-        Result = TaggedHeapBlockAlloc(&PlatformHeap, Size);
-        if (!Result)
-            mprinte("Error allocating from Platform Heap Allocator!\n");
     }
-#else
     
-    // TODO(Dustin): Temporary fix for not having a tagged heap/string right now
-    Result = malloc(Size);
+    Result = tag_block_alloc(&PlatformHeap, Size);
     
-#endif
+    spin_lock_release(&PlatformHeapLock);
     
     return Result;
 }
@@ -246,6 +264,72 @@ void Win32UnloadGameCode()
     
 }
 
+//~ Memory Reporting
+
+// Writes the heap statistics of the engine heap as JSON. The file is written
+// relative to the working directory.
+file_internal void Win32DumpMemoryReport(const char *Filename)
+{
+    memory_report Report;
+    memory_get_report(Core->Memory, &Report);
+    
+    i32 JsonLen = memory_report_to_json(&Report, NULL, 0) + 1;
+    char *Json = (char*)frame_alloc(Core->Scratch, JsonLen);
+    if (!Json) return;
+    
+    JsonLen = memory_report_to_json(&Report, Json, JsonLen);
+    
+    HANDLE FileHandle = CreateFileA(Filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (FileHandle == INVALID_HANDLE_VALUE)
+    {
+        mprinte("Unable to open \"%s\" to write the memory report!\n", Filename);
+        return;
+    }
+    
+    DWORD BytesWritten;
+    WriteFile(FileHandle, Json, JsonLen, &BytesWritten, NULL);
+    CloseHandle(FileHandle);
+    
+    mprint("Wrote memory report to \"%s\" (%lld bytes used in %lld allocations, %.2f fragmentation)\n",
+           Filename, Report.UsedMemory, Report.NumAllocations, Report.Fragmentation);
+}
+
+#ifdef MAPLE_MEMORY_TRACE
+// Writes the allocation trace of the engine heap so it can be replayed by
+// maple_alloc_bench. The file is written relative to the working directory.
+file_internal void Win32DumpMemoryTrace(const char *Filename)
+{
+    memory_trace *Trace = Core->Memory->Trace;
+    if (!Trace) return;
+    
+    memory_trace_file_header Header = {0};
+    Header.Magic        = MEMORY_TRACE_MAGIC;
+    Header.Version      = MEMORY_TRACE_VERSION;
+    Header.HeapSize     = Core->Memory->Size;
+    Header.EventCount   = Trace->Count;
+    Header.DroppedCount = Trace->DroppedCount;
+    
+    HANDLE FileHandle = CreateFileA(Filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (FileHandle == INVALID_HANDLE_VALUE)
+    {
+        mprinte("Unable to open \"%s\" to write the memory trace!\n", Filename);
+        return;
+    }
+    
+    DWORD BytesWritten;
+    WriteFile(FileHandle, &Header, sizeof(Header), &BytesWritten, NULL);
+    WriteFile(FileHandle, Trace->Events, (DWORD)(Header.EventCount * sizeof(memory_trace_event)), &BytesWritten, NULL);
+    CloseHandle(FileHandle);
+    
+    if (Header.DroppedCount)
+    {
+        mprinte("The memory trace filled up, %lld events were dropped!\n", Header.DroppedCount);
+    }
+    
+    mprint("Wrote memory trace to \"%s\" (%lld events)\n", Filename, Header.EventCount);
+}
+#endif
+
 
 //~ File I/O
 
@@ -258,20 +342,21 @@ mstr Win32NormalizePath(char* path)
     
     // Start with our relative path appended to the full executable path.
     mstr exe_path = Win32GetExeFilepath();
-    mstr result = cstr_add(mstr_to_cstr(&exe_path), exe_path.Len, path, strlen(path));
+    mstr result = cstr_add(mstr_to_cstr(&exe_path), mstr_len(&exe_path), path, strlen(path));
     
     char *Str = mstr_to_cstr(&result);
+    u32   Len = mstr_len(&result);
     
     // Swap any back slashes for forward slashes.
-    for (u32 i = 0; i < (u32)result.Len; ++i) if (Str[i] == '\\') Str[i] = '/';
+    for (u32 i = 0; i < Len; ++i) if (Str[i] == '\\') Str[i] = '/';
     
     // Strip double separators.
-    for (u32 i = 0; i < (u32)result.Len - 1; ++i)
+    for (u32 i = 0; i < Len - 1; ++i)
     {
         if (Str[i] == '/' && Str[i + 1] == '/')
         {
-            for (u32 j = i; j < (u32)result.Len; ++j) Str[j] = Str[j + 1];
-            --result.Len;
+            for (u32 j = i; j < Len; ++j) Str[j] = Str[j + 1];
+            --Len;
             --i;
         }
     }
@@ -279,33 +364,33 @@ mstr Win32NormalizePath(char* path)
     // Evaluate any relative specifiers (./).
     if (Str[0] == '.' && Str[1] == '/')
     {
-        for (u32 i = 0; i < (u32)result.Len - 1; ++i) Str[i] = Str[i + 2];
-        result.Len -= 2;
+        for (u32 i = 0; i < Len - 1; ++i) Str[i] = Str[i + 2];
+        Len -= 2;
     }
-    for (u32 i = 0; i < (u32)result.Len - 1; ++i)
+    for (u32 i = 0; i < Len - 1; ++i)
     {
         if (Str[i] != '.' && Str[i + 1] == '.' && Str[i + 2] == '/')
         {
             for (u32 j = i + 1; Str[j + 1]; ++j) Str[j] = Str[j + 2];
-            result.Len -= 2;
+            Len -= 2;
         }
     }
     
     // Evaluate any parent specifiers (../).
     u32 last_separator = 0;
-    for (u32 i = 0; (i < (u32)result.Len - 1); ++i)
+    for (u32 i = 0; (i < Len - 1); ++i)
     {
         if (Str[i] == '.' && Str[i + 1] == '.' && Str[i + 2] == '/')
         {
             u32 base = i + 2;
-            u32 count = result.Len - base;
+            u32 count = Len - base;
             
             for (u32 j = 0; j <= count; ++j)
             {
                 Str[last_separator + j] = Str[base + j];
             }
             
-            result.Len -= base - last_separator;
+            Len -= base - last_separator;
             i = last_separator;
             
             if (i > 0)
@@ -326,6 +411,8 @@ mstr Win32NormalizePath(char* path)
         if (i > 0 && Str[i - 1] == '/') last_separator = i - 1;
     }
     
+    mstr_set_len(&result, Len);
+    
     mstr_free(&exe_path);
     return result;
 }
@@ -1289,9 +1376,9 @@ u32 PlatformClzl(u64 Value)
     unsigned long LeadingZero = 0;
     
     if (_BitScanReverse64(&LeadingZero, Value))
-        return 31 - LeadingZero;
+        return 63 - LeadingZero;
     else
-        return 32;
+        return 64;
 }
 
 void* PlatformRequestMemory(u64 Size)
@@ -1322,6 +1409,75 @@ void PlatformReleaseMemory(void *Ptr, u64 Size)
     assert(bSuccess && "Unable to free a VirtualAlloc allocation!");
 }
 
+void* PlatformReserveMemory(u64 Size)
+{
+    SYSTEM_INFO SysInfo;
+    GetSystemInfo(&SysInfo);
+    
+    // Reservations are made in allocation granularity sized chunks (64KB)
+    u64 Granularity = (u64)SysInfo.dwAllocationGranularity;
+    u64 ActualSize  = (Size + Granularity - 1) & ~(Granularity - 1);
+    
+    return VirtualAlloc(NULL, ActualSize, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool PlatformCommitMemory(void *Ptr, u64 Size)
+{
+    return VirtualAlloc(Ptr, Size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void PlatformDecommitMemory(void *Ptr, u64 Size)
+{
+    BOOL bSuccess = VirtualFree(Ptr, Size, MEM_DECOMMIT);
+    assert(bSuccess && "Unable to decommit a VirtualAlloc range!");
+}
+
+// Large pages are only handed out to processes holding SeLockMemoryPrivilege.
+// The account has to be granted "Lock pages in memory" by an administrator,
+// this only enables it for the process.
+file_internal bool Win32EnableLockMemoryPrivilege()
+{
+    HANDLE Token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES|TOKEN_QUERY, &Token))
+    {
+        return false;
+    }
+    
+    TOKEN_PRIVILEGES Privileges = {0};
+    Privileges.PrivilegeCount           = 1;
+    Privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    
+    bool Result = false;
+    if (LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &Privileges.Privileges[0].Luid))
+    {
+        // Succeeds even if the privilege was not granted, so the last error has to be checked
+        AdjustTokenPrivileges(Token, FALSE, &Privileges, 0, NULL, NULL);
+        Result = (GetLastError() == ERROR_SUCCESS);
+    }
+    
+    CloseHandle(Token);
+    return Result;
+}
+
+u64 PlatformGetLargePageSize()
+{
+    local_persist i32 HasPrivilege = -1;
+    if (HasPrivilege < 0) HasPrivilege = Win32EnableLockMemoryPrivilege();
+    
+    return HasPrivilege ? (u64)GetLargePageMinimum() : 0;
+}
+
+void* PlatformRequestLargeMemory(u64 Size)
+{
+    u64 LargePageSize = PlatformGetLargePageSize();
+    if (!LargePageSize) return NULL;
+    
+    // Large pages cannot be reserved and committed later, the whole range
+    // is committed and locked up front.
+    u64 ActualSize = (Size + LargePageSize - 1) & ~(LargePageSize - 1);
+    return VirtualAlloc(NULL, ActualSize, MEM_COMMIT|MEM_RESERVE|MEM_LARGE_PAGES, PAGE_READWRITE);
+}
+
 u64 PlatformGetWallClock()
 {
     LARGE_INTEGER Result;
@@ -1370,6 +1526,9 @@ void PlatformGetClientWindow(platform_window **Window)
 file_internal void MapleShutdown()
 {
     Graphics->shutdown_graphics();
+#ifdef MAPLE_MEMORY_TRACE
+    Win32DumpMemoryTrace("memory_trace.bin");
+#endif
     globals_free();
 }
 
@@ -1431,10 +1590,17 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
     };
     
     globals_create_info GlobalInfo = {0};
-    GlobalInfo.Memory.Size                  = _MB(400);
+    GlobalInfo.Memory.Size                  = _GB(4);
+    GlobalInfo.Memory.ScratchSize           = _MB(16);
+    GlobalInfo.Memory.TaggedHeapSize        = _MB(256);
+    GlobalInfo.Memory.MovableCount          = 1 << 16;
+    // Large pages need "Lock pages in memory", so they are opt in
+    GlobalInfo.Memory.LargePages            = (strstr(lpCmdLine, "-large_pages") != NULL);
+    GlobalInfo.Memory.LargePageHeapSize     = _MB(512);
     GlobalInfo.AssetSystem.ExecutablePath   = NULL;
     GlobalInfo.AssetSystem.MountPoints      = MountInfos;
     GlobalInfo.AssetSystem.MountPointsCount = sizeof(MountInfos)/sizeof(MountInfos[0]);
+    GlobalInfo.AssetSystem.CacheBudget      = _MB(64);
     globals_init(&GlobalInfo);
     
     file_print_directory_tree("root");
@@ -1452,17 +1618,28 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
     
     PlatformApi = (platform*)memory_alloc(Core->Memory, sizeof(platform));
     PlatformApi->Memory          = Core->Memory;
+    PlatformApi->Scratch         = Core->Scratch;
+    PlatformApi->TaggedHeap      = Core->TaggedHeap;
     PlatformApi->open_file       = &file_open;
     PlatformApi->load_file       = &file_load;
     PlatformApi->close_file      = &file_close;
+    PlatformApi->map_file        = &file_map;
+    PlatformApi->unmap_file      = &file_unmap;
+    PlatformApi->acquire_file    = &file_acquire;
+    PlatformApi->release_file    = &file_release;
     PlatformApi->file_get_size   = &file_get_size;
     PlatformApi->file_get_fsize  = &file_get_fsize;
+    PlatformApi->io_submit       = &io_submit;
+    PlatformApi->io_poll         = &io_poll;
     PlatformApi->mprint          = &mprint;
     PlatformApi->mprinte         = &mprinte;
     PlatformApi->get_client_window_dimensions = &PlatformGetClientWindowDimensions;
     PlatformApi->get_client_window = &PlatformGetClientWindow;
     PlatformApi->request_memory = PlatformRequestMemory;
     PlatformApi->release_memory = PlatformReleaseMemory;
+    PlatformApi->reserve_memory  = PlatformReserveMemory;
+    PlatformApi->commit_memory   = PlatformCommitMemory;
+    PlatformApi->decommit_memory = PlatformDecommitMemory;
     
     //~ Load game code
     
@@ -1492,14 +1669,25 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
     
     u32 LoadDllCounter = 0;
     
+    tag_block FrameHeap;
+    
     ClientIsRunning = true;
     MSG msg = {0};
     while (ClientIsRunning)
     {
         GlobalPerFrameInput.KeyPress = 0;
         
+        frame_allocator_begin_frame(Core->Scratch);
+        
+        // Every block from the last time this frame slot was used is retired at once
+        u64 FrameTag = tagged_heap_frame_tag(FrameCount % FRAME_ALLOCATOR_FRAME_COUNT);
+        tagged_heap_release_tag(Core->TaggedHeap, FrameTag);
+        tag_block_init(&FrameHeap, Core->TaggedHeap, FrameTag);
+        
         frame_params FrameParams = {0};
-        FrameParams.Frame    = FrameCount;
+        FrameParams.Frame     = FrameCount;
+        FrameParams.Scratch   = Core->Scratch;
+        FrameParams.FrameHeap = &FrameHeap;
         FrameParams.Graphics = Graphics;
         FrameParams.Platform = PlatformApi;
         FrameParams.Camera   = &PlayerCamera;
@@ -1531,6 +1719,11 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
         
         FrameParams.Input = GlobalPerFrameInput;
         
+        if (FrameParams.Input.KeyPress & Key_F5)
+        {
+            Win32DumpMemoryReport("memory_report.json");
+        }
+        
         FrameParams.GameStageEndTime     = PlatformGetWallClock();
         FrameParams.RenderStageStartTime = FrameParams.GameStageEndTime;
         
@@ -1548,6 +1741,10 @@ INT WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
         
         FrameParams.RenderStageEndTime = PlatformGetWallClock();
         
+        // Slide a little of the movable data down every frame so the holes
+        // left by released blocks drift to the break point and get reclaimed.
+        memory_compact(Core->Memory, PLATFORM_COMPACT_BUDGET);
+        
         FrameCount++;
         
         //#endif
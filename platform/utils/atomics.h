@@ -0,0 +1,117 @@
+#ifndef ENGINE_UTILS_ATOMICS_H
+#define ENGINE_UTILS_ATOMICS_H
+
+// The few atomic operations the engine uses, on MSVC intrinsics or the
+// GCC/Clang builtins.
+//
+// A spin_lock is for critical sections that are a handful of writes (a free
+// list update, a slot push). Waiting on a plain load keeps the cache line
+// shared until the lock looks free, which is cheaper than an OS mutex there.
+
+typedef volatile long spin_lock;
+
+void spin_lock_acquire(spin_lock *Lock);
+void spin_lock_release(spin_lock *Lock);
+
+// Returns the incremented value
+long atomic_increment(volatile long *Value);
+long atomic_load_long(volatile long *Value);
+void atomic_store_long(volatile long *Value, long NewValue);
+
+// Acquire load and release store, for publishing data to lock-free readers
+u32  atomic_load_u32(volatile u32 *Value);
+void atomic_store_u32(volatile u32 *Value, u32 NewValue);
+
+#endif //ENGINE_UTILS_ATOMICS_H
+
+#if defined(MAPLE_ATOMICS_IMPLEMENTATION)
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+#include <intrin.h>
+
+void spin_lock_acquire(spin_lock *Lock)
+{
+    while (_InterlockedExchange(Lock, 1))
+    {
+        while (*Lock) _mm_pause();
+    }
+}
+
+void spin_lock_release(spin_lock *Lock)
+{
+    _InterlockedExchange(Lock, 0);
+}
+
+long atomic_increment(volatile long *Value)
+{
+    return _InterlockedIncrement(Value);
+}
+
+long atomic_load_long(volatile long *Value)
+{
+    return _InterlockedOr(Value, 0);
+}
+
+void atomic_store_long(volatile long *Value, long NewValue)
+{
+    _InterlockedExchange(Value, NewValue);
+}
+
+// x64 loads are acquire and stores are release, only the compiler has to be kept in check
+u32 atomic_load_u32(volatile u32 *Value)
+{
+    u32 Result = *Value;
+    _ReadWriteBarrier();
+    return Result;
+}
+
+void atomic_store_u32(volatile u32 *Value, u32 NewValue)
+{
+    _ReadWriteBarrier();
+    *Value = NewValue;
+}
+
+#else
+
+void spin_lock_acquire(spin_lock *Lock)
+{
+    while (__atomic_exchange_n(Lock, 1, __ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(Lock, __ATOMIC_RELAXED)) __builtin_ia32_pause();
+    }
+}
+
+void spin_lock_release(spin_lock *Lock)
+{
+    __atomic_store_n(Lock, 0, __ATOMIC_RELEASE);
+}
+
+long atomic_increment(volatile long *Value)
+{
+    return __atomic_add_fetch(Value, 1, __ATOMIC_ACQ_REL);
+}
+
+long atomic_load_long(volatile long *Value)
+{
+    return __atomic_load_n(Value, __ATOMIC_ACQUIRE);
+}
+
+void atomic_store_long(volatile long *Value, long NewValue)
+{
+    __atomic_store_n(Value, NewValue, __ATOMIC_RELEASE);
+}
+
+u32 atomic_load_u32(volatile u32 *Value)
+{
+    return __atomic_load_n(Value, __ATOMIC_ACQUIRE);
+}
+
+void atomic_store_u32(volatile u32 *Value, u32 NewValue)
+{
+    __atomic_store_n(Value, NewValue, __ATOMIC_RELEASE);
+}
+
+#endif
+
+#endif //MAPLE_ATOMICS_IMPLEMENTATION
@@ -0,0 +1,427 @@
+#ifndef ENGINE_UTILS_BLOCK_COMPRESS_H
+#define ENGINE_UTILS_BLOCK_COMPRESS_H
+
+// Block compressed streams. The raw data is cut into blocks of BlockSize
+// bytes and every block is compressed on its own with a small LZ codec, so
+// blocks can be decoded in any order, on any thread, straight into their
+// place in the destination buffer. A seek table at the front of the stream
+// holds where each block starts, so any range of the raw data can be decoded
+// without touching the blocks before it.
+//
+// Layout:
+//
+//   block_stream_header
+//   u64 Offsets[BlockCount + 1]  from the start of the stream, block i is
+//                                stored in [Offsets[i], Offsets[i + 1])
+//   blocks
+//
+// Every block holds BlockSize raw bytes except the last one, which holds the
+// rest. A block that does not get smaller when compressed is stored as is,
+// which is the case when its stored size equals its raw size.
+//
+// The codec is a byte oriented LZ77 in the style of LZ4. A block is a list of
+// sequences, each one a run of literals followed by a match:
+//
+//   token       high 4 bits: literal count, low 4 bits: match length - 4.
+//               15 means the count goes on in the bytes that follow, each
+//               one added to it until a byte is not 255.
+//   literals
+//   offset      u16, little endian, how far back the match starts
+//   length      the rest of the match length, when the token has 15
+//
+// The last sequence of a block has literals only and ends the block. Matches
+// never reach outside their block, so the window is the block itself.
+
+#define BLOCK_STREAM_MAGIC         0x3142534D // "MSB1"
+#define BLOCK_STREAM_MIN_BLOCK     _KB(16)
+#define BLOCK_STREAM_MAX_BLOCK     _MB(1)
+#define BLOCK_STREAM_DEFAULT_BLOCK _KB(128)
+
+typedef struct block_stream_header
+{
+    u32 Magic;
+    u32 BlockSize;
+    u64 RawSize;
+    u32 BlockCount;
+    u32 Reserved;
+} block_stream_header;
+
+#define block_stream_offsets(h) ((const u64*)((const u8*)(h) + sizeof(block_stream_header)))
+#define block_stream_raw_size(h, b) \
+(((b) + 1 < (h)->BlockCount) ? (u64)(h)->BlockSize : (h)->RawSize - (u64)(b) * (h)->BlockSize)
+
+// Largest size lz_compress can produce for Size bytes
+u64 lz_compress_bound(u64 Size);
+// Returns the compressed size, or 0 if it does not fit in DstCapacity
+u64 lz_compress(const void *Src, u64 SrcSize, void *Dst, u64 DstCapacity);
+// Returns false unless Src decodes to exactly DstSize bytes. Never reads or
+// writes outside of the two buffers, whatever Src holds.
+bool lz_decompress(const void *Src, u64 SrcSize, void *Dst, u64 DstSize);
+
+// Largest size block_stream_compress can produce for RawSize bytes
+u64 block_stream_bound(u64 RawSize, u32 BlockSize);
+// BlockSize is a power of two between BLOCK_STREAM_MIN_BLOCK and
+// BLOCK_STREAM_MAX_BLOCK. Returns the size of the stream, or 0 if it does
+// not fit in DstCapacity.
+u64 block_stream_compress(const void *Src, u64 RawSize, u32 BlockSize, void *Dst, u64 DstCapacity);
+// Checks that the header and the seek table describe StreamSize bytes, so
+// the blocks can be decoded without further checks on the table
+bool block_stream_validate(const void *Stream, u64 StreamSize);
+// Decodes a single block to Dst, which holds block_stream_raw_size bytes
+bool block_stream_decode_block(const void *Stream, u32 Block, void *Dst);
+// Decodes the whole stream to Dst, which holds RawSize bytes
+bool block_stream_decode(const void *Stream, void *Dst);
+
+#endif //ENGINE_UTILS_BLOCK_COMPRESS_H
+
+#if defined(MAPLE_BLOCK_COMPRESS_IMPLEMENTATION)
+
+#define LZ_MIN_MATCH     4
+#define LZ_MAX_OFFSET    0xFFFF
+#define LZ_HASH_BITS     14
+// Matches stop this far from the end of a block so the last sequence always
+// has a few literals, and a match search never reads past the end
+#define LZ_LAST_LITERALS 8
+
+file_internal u32 lz_read32(const u8 *Ptr)
+{
+    u32 Result;
+    memcpy(&Result, Ptr, sizeof(Result));
+    return Result;
+}
+
+// Index of the first byte that differs between two words that are not equal
+file_internal u32 lz_first_difference(u64 Diff)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long Index;
+    _BitScanForward64(&Index, Diff);
+    return (u32)Index / 8;
+#else
+    return (u32)__builtin_ctzll(Diff) / 8;
+#endif
+}
+
+file_internal u32 lz_hash(u32 Sequence)
+{
+    return (Sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Writes the part of a length that did not fit in its token nibble
+file_internal u8* lz_write_length(u8 *Op, u64 Length)
+{
+    for (; Length >= 255; Length -= 255) *Op++ = 255;
+    *Op++ = (u8)Length;
+    return Op;
+}
+
+file_internal bool lz_read_length(const u8 **Ip, const u8 *IEnd, u64 *Length)
+{
+    u32 Byte;
+    do
+    {
+        if (*Ip >= IEnd) return false;
+        Byte = *(*Ip)++;
+        *Length += Byte;
+    } while (Byte == 255);
+    
+    return true;
+}
+
+// Writes a sequence, MatchLen is 0 for the last one. Returns NULL if the
+// sequence does not fit.
+file_internal u8* lz_write_sequence(u8 *Op, u8 *OEnd, const u8 *Literals, u64 LitLen, u32 Offset, u64 MatchLen)
+{
+    // token, both lengths and the offset
+    u64 Needed = 1 + LitLen + (LitLen / 255 + 1) + 2 + (MatchLen / 255 + 1);
+    if ((u64)(OEnd - Op) < Needed) return NULL;
+    
+    u64 MatchCode = (MatchLen) ? MatchLen - LZ_MIN_MATCH : 0;
+    
+    u8 *Token = Op++;
+    *Token = (u8)(((LitLen < 15) ? LitLen : 15) << 4);
+    if (LitLen >= 15) Op = lz_write_length(Op, LitLen - 15);
+    
+    memcpy(Op, Literals, LitLen);
+    Op += LitLen;
+    
+    if (MatchLen == 0) return Op;
+    
+    *Op++ = (u8)(Offset & 0xFF);
+    *Op++ = (u8)(Offset >> 8);
+    
+    *Token |= (u8)((MatchCode < 15) ? MatchCode : 15);
+    if (MatchCode >= 15) Op = lz_write_length(Op, MatchCode - 15);
+    
+    return Op;
+}
+
+u64 lz_compress_bound(u64 Size)
+{
+    return Size + Size / 255 + 16;
+}
+
+u64 lz_compress(const void *Src, u64 SrcSize, void *Dst, u64 DstCapacity)
+{
+    const u8 *Start  = (const u8*)Src;
+    const u8 *End    = Start + SrcSize;
+    const u8 *Ip     = Start;
+    const u8 *Anchor = Start;
+    
+    u8 *Op   = (u8*)Dst;
+    u8 *OEnd = Op + DstCapacity;
+    
+    // Positions are offsets from Start. A stale or empty entry is harmless,
+    // every candidate is compared before it is used.
+    u32 Table[1 << LZ_HASH_BITS];
+    memset(Table, 0, sizeof(Table));
+    
+    if (SrcSize > LZ_LAST_LITERALS + LZ_MIN_MATCH)
+    {
+        const u8 *MatchLimit = End - LZ_LAST_LITERALS;
+        
+        while (Ip + LZ_MIN_MATCH <= MatchLimit)
+        {
+            u32 Sequence = lz_read32(Ip);
+            u32 Hash     = lz_hash(Sequence);
+            
+            const u8 *Ref = Start + Table[Hash];
+            Table[Hash] = (u32)(Ip - Start);
+            
+            if (Ref >= Ip || Ip - Ref > LZ_MAX_OFFSET || lz_read32(Ref) != Sequence)
+            {
+                // Step further the longer nothing matched, so data that does
+                // not compress goes through quickly
+                Ip += 1 + ((Ip - Anchor) >> 6);
+                continue;
+            }
+            
+            // Grow the match backwards into the pending literals
+            while (Ip > Anchor && Ref > Start && Ip[-1] == Ref[-1])
+            {
+                --Ip;
+                --Ref;
+            }
+            
+            const u8 *MatchEnd = Ip + LZ_MIN_MATCH;
+            const u8 *RefEnd   = Ref + LZ_MIN_MATCH;
+            for (;;)
+            {
+                if (MatchEnd + 8 > MatchLimit)
+                {
+                    while (MatchEnd < MatchLimit && *MatchEnd == *RefEnd)
+                    {
+                        ++MatchEnd;
+                        ++RefEnd;
+                    }
+                    break;
+                }
+                
+                u64 A, B;
+                memcpy(&A, MatchEnd, 8);
+                memcpy(&B, RefEnd, 8);
+                if (A != B)
+                {
+                    MatchEnd += lz_first_difference(A ^ B);
+                    break;
+                }
+                
+                MatchEnd += 8;
+                RefEnd   += 8;
+            }
+            
+            Op = lz_write_sequence(Op, OEnd, Anchor, Ip - Anchor, (u32)(Ip - Ref), MatchEnd - Ip);
+            if (!Op) return 0;
+            
+            // The end of a match is a likely start of the next one
+            if (MatchEnd - 2 > Start) Table[lz_hash(lz_read32(MatchEnd - 2))] = (u32)(MatchEnd - 2 - Start);
+            
+            Ip     = MatchEnd;
+            Anchor = Ip;
+        }
+    }
+    
+    Op = lz_write_sequence(Op, OEnd, Anchor, End - Anchor, 0, 0);
+    if (!Op) return 0;
+    
+    return Op - (u8*)Dst;
+}
+
+bool lz_decompress(const void *Src, u64 SrcSize, void *Dst, u64 DstSize)
+{
+    const u8 *Ip   = (const u8*)Src;
+    const u8 *IEnd = Ip + SrcSize;
+    
+    u8 *Start = (u8*)Dst;
+    u8 *Op    = Start;
+    u8 *OEnd  = Start + DstSize;
+    
+    for (;;)
+    {
+        if (Ip >= IEnd) return false;
+        u32 Token = *Ip++;
+        
+        u64 LitLen = Token >> 4;
+        if (LitLen == 15 && !lz_read_length(&Ip, IEnd, &LitLen)) return false;
+        if (LitLen > (u64)(IEnd - Ip) || LitLen > (u64)(OEnd - Op)) return false;
+        
+        // Most runs of literals are short and copied with one fixed size copy,
+        // the bytes past the run are written again by what comes next
+        if (LitLen <= 16 && IEnd - Ip >= 16 && OEnd - Op >= 16) memcpy(Op, Ip, 16);
+        else                                                     memcpy(Op, Ip, LitLen);
+        
+        Op += LitLen;
+        Ip += LitLen;
+        
+        // Only the last sequence ends without a match
+        if (Ip == IEnd) break;
+        
+        if (IEnd - Ip < 2) return false;
+        u64 Offset = (u64)Ip[0] | ((u64)Ip[1] << 8);
+        Ip += 2;
+        
+        u64 MatchLen = Token & 15;
+        if (MatchLen == 15 && !lz_read_length(&Ip, IEnd, &MatchLen)) return false;
+        MatchLen += LZ_MIN_MATCH;
+        
+        if (Offset == 0 || Offset > (u64)(Op - Start) || MatchLen > (u64)(OEnd - Op)) return false;
+        
+        const u8 *Match = Op - Offset;
+        u8 *MatchEnd = Op + MatchLen;
+        
+        // Eight bytes at a time when the source can't overlap a single copy.
+        // The last copy can write up to 7 bytes past the match, which stays
+        // inside Dst and is written again by the next sequence.
+        if (Offset >= 8 && (u64)(OEnd - Op) >= MatchLen + 8)
+        {
+            for (; Op < MatchEnd; Op += 8, Match += 8) memcpy(Op, Match, 8);
+        }
+        else if (Offset < MatchLen)
+        {
+            // The match repeats its first Offset bytes. Every copy doubles
+            // what is already written, which is a whole number of repeats.
+            memcpy(Op, Match, Offset);
+            for (u64 Copied = Offset; Copied < MatchLen;)
+            {
+                u64 Chunk = (Copied < MatchLen - Copied) ? Copied : MatchLen - Copied;
+                memcpy(Op + Copied, Op, Chunk);
+                Copied += Chunk;
+            }
+        }
+        else
+        {
+            memcpy(Op, Match, MatchLen);
+        }
+        
+        Op = MatchEnd;
+    }
+    
+    return Op == OEnd;
+}
+
+u64 block_stream_bound(u64 RawSize, u32 BlockSize)
+{
+    u64 BlockCount = (RawSize + BlockSize - 1) / BlockSize;
+    return sizeof(block_stream_header) + (BlockCount + 1) * sizeof(u64) + RawSize;
+}
+
+u64 block_stream_compress(const void *Src, u64 RawSize, u32 BlockSize, void *Dst, u64 DstCapacity)
+{
+    if (BlockSize < BLOCK_STREAM_MIN_BLOCK || BlockSize > BLOCK_STREAM_MAX_BLOCK || (BlockSize & (BlockSize - 1)))
+    {
+        return 0;
+    }
+    
+    u64 BlockCount = (RawSize + BlockSize - 1) / BlockSize;
+    if (BlockCount > 0xFFFFFFFF) return 0;
+    
+    u64 Offset = sizeof(block_stream_header) + (BlockCount + 1) * sizeof(u64);
+    if (Offset > DstCapacity) return 0;
+    
+    block_stream_header *Header = (block_stream_header*)Dst;
+    Header->Magic      = BLOCK_STREAM_MAGIC;
+    Header->BlockSize  = BlockSize;
+    Header->RawSize    = RawSize;
+    Header->BlockCount = (u32)BlockCount;
+    Header->Reserved   = 0;
+    
+    u64 *Offsets = (u64*)((u8*)Dst + sizeof(block_stream_header));
+    
+    for (u32 i = 0; i < BlockCount; ++i)
+    {
+        const u8 *Raw  = (const u8*)Src + (u64)i * BlockSize;
+        u64 RawBlock   = block_stream_raw_size(Header, i);
+        u64 Capacity   = DstCapacity - Offset;
+        
+        // Anything that is not smaller than the raw block is stored raw
+        u64 Compressed = lz_compress(Raw, RawBlock, (u8*)Dst + Offset, (Capacity < RawBlock) ? Capacity : RawBlock - 1);
+        if (!Compressed)
+        {
+            if (Capacity < RawBlock) return 0;
+            
+            memcpy((u8*)Dst + Offset, Raw, RawBlock);
+            Compressed = RawBlock;
+        }
+        
+        Offsets[i] = Offset;
+        Offset    += Compressed;
+    }
+    
+    Offsets[BlockCount] = Offset;
+    return Offset;
+}
+
+bool block_stream_validate(const void *Stream, u64 StreamSize)
+{
+    const block_stream_header *Header = (const block_stream_header*)Stream;
+    
+    if (StreamSize < sizeof(block_stream_header) || Header->Magic != BLOCK_STREAM_MAGIC) return false;
+    if (Header->BlockSize < BLOCK_STREAM_MIN_BLOCK || Header->BlockSize > BLOCK_STREAM_MAX_BLOCK) return false;
+    if ((Header->RawSize + Header->BlockSize - 1) / Header->BlockSize != Header->BlockCount) return false;
+    
+    u64 TableEnd = sizeof(block_stream_header) + ((u64)Header->BlockCount + 1) * sizeof(u64);
+    if (TableEnd > StreamSize) return false;
+    
+    const u64 *Offsets = block_stream_offsets(Header);
+    if (Offsets[0] != TableEnd || Offsets[Header->BlockCount] != StreamSize) return false;
+    
+    for (u32 i = 0; i < Header->BlockCount; ++i)
+    {
+        if (Offsets[i + 1] < Offsets[i]) return false;
+        if (Offsets[i + 1] - Offsets[i] > block_stream_raw_size(Header, i)) return false;
+    }
+    
+    return true;
+}
+
+bool block_stream_decode_block(const void *Stream, u32 Block, void *Dst)
+{
+    const block_stream_header *Header = (const block_stream_header*)Stream;
+    const u64 *Offsets = block_stream_offsets(Header);
+    
+    const u8 *Stored = (const u8*)Stream + Offsets[Block];
+    u64 StoredSize   = Offsets[Block + 1] - Offsets[Block];
+    u64 RawSize      = block_stream_raw_size(Header, Block);
+    
+    if (StoredSize == RawSize)
+    {
+        memcpy(Dst, Stored, RawSize);
+        return true;
+    }
+    
+    return lz_decompress(Stored, StoredSize, Dst, RawSize);
+}
+
+bool block_stream_decode(const void *Stream, void *Dst)
+{
+    const block_stream_header *Header = (const block_stream_header*)Stream;
+    
+    for (u32 i = 0; i < Header->BlockCount; ++i)
+    {
+        if (!block_stream_decode_block(Stream, i, (u8*)Dst + (u64)i * Header->BlockSize)) return false;
+    }
+    
+    return true;
+}
+
+#endif //MAPLE_BLOCK_COMPRESS_IMPLEMENTATION
@@ -1,29 +1,311 @@
 #ifndef ENGINE_UTILS_DYN_ARRAY_H
 #define ENGINE_UTILS_DYN_ARRAY_H
 
-typedef struct 
+// Typed dynamic array. The array is a plain pointer to its elements, so it is
+// indexed like any other array, and the size, capacity and allocator are kept
+// in a header right before the first element:
+//
+//     assetsys_file_id *Children = NULL;
+//     arr_init(Children, allocator_frame(Core->Scratch), 16);
+//     arr_put(Children, Fid);
+//     for (u32 i = 0; i < arr_len(Children); ++i) Children[i]...
+//
+// A NULL array is a valid, empty array. If it was never initialized, the first
+// put allocates it from Core->Memory. The capacity doubles when the array is
+// full, and growing goes through allocator_realloc, so heap arrays grow into
+// their neighbour and frame arrays grow in place when they were the last
+// allocation. The array can move when it grows, so do not hold on to pointers
+// to its elements across a put.
+//
+// If the allocator runs out of memory, puts are dropped.
+
+typedef struct dyn_array_header
 {
-    u32   Size;
-    u32   Cap;
-    void *Ptr;
+    allocator Allocator;
+    u32       Size;
+    u32       Cap;
 } dyn_array_header;
 
-#define arr_init maple_arr_init
-#define arr_free maple_arr_free
-#define arr_put  maple_arr_put
-#define arr_remove maple_arr_remove
+// Keeps the elements as aligned as the allocation itself
+#define DYN_ARRAY_HEADER_SIZE memory_align(sizeof(dyn_array_header), 16)
+
+#define arr_init           maple_arr_init
+#define arr_free           maple_arr_free
+#define arr_len            maple_arr_len
+#define arr_cap            maple_arr_cap
+#define arr_reserve        maple_arr_reserve
+#define arr_put            maple_arr_put
+#define arr_pop            maple_arr_pop
+#define arr_last           maple_arr_last
+#define arr_remove         maple_arr_remove
+#define arr_remove_ordered maple_arr_remove_ordered
+#define arr_clear          maple_arr_clear
+
+#ifdef __cplusplus
+template<class T> static inline T* dyn_array_cast(T*, void *Ptr) { return (T*)Ptr; }
+#define DYN_ARRAY_CAST(a, p) dyn_array_cast(a, p)
+#else
+#define DYN_ARRAY_CAST(a, p) (p)
+#endif
 
+#define maple_arr_header(a) ((dyn_array_header*)((u8*)(a) - DYN_ARRAY_HEADER_SIZE))
 
-#define maple_arr_init()
-#define maple_arr_free()
-#define maple_arr_put()
-#define maple_arr_remove()
+#define maple_arr_init(a, Allocator, Cap) ((a) = DYN_ARRAY_CAST(a, dyn_array_init(Allocator, sizeof(*(a)), Cap)))
+#define maple_arr_free(a)                 (dyn_array_free(a), (a) = NULL)
+#define maple_arr_len(a)                  ((a) ? maple_arr_header(a)->Size : 0)
+#define maple_arr_cap(a)                  ((a) ? maple_arr_header(a)->Cap : 0)
+// Makes room for Cap elements in total. Evaluates to false if out of memory.
+#define maple_arr_reserve(a, Cap)         (dyn_array_fits(a, Cap, false) ||                                    \
+                                           ((a) = DYN_ARRAY_CAST(a, dyn_array_resize(a, sizeof(*(a)), Cap, false)), \
+                                            dyn_array_fits(a, Cap, false)))
+#define maple_arr_put(a, v)               ((dyn_array_fits(a, 1, true) ||                                      \
+                                            ((a) = DYN_ARRAY_CAST(a, dyn_array_resize(a, sizeof(*(a)), 1, true)), \
+                                             dyn_array_fits(a, 1, true)))                                      \
+                                           ? (void)((a)[maple_arr_header(a)->Size++] = (v)) : (void)0)
+#define maple_arr_pop(a)                  ((a)[--maple_arr_header(a)->Size])
+#define maple_arr_last(a)                 ((a)[maple_arr_header(a)->Size - 1])
+// Moves the last element into the hole, order is not kept
+#define maple_arr_remove(a, i)            ((a)[i] = (a)[--maple_arr_header(a)->Size])
+#define maple_arr_remove_ordered(a, i)    (memmove((a) + (i), (a) + (i) + 1,                                   \
+                                                   (maple_arr_header(a)->Size - (i) - 1) * sizeof(*(a))),      \
+                                           maple_arr_header(a)->Size--)
+#define maple_arr_clear(a)                ((a) ? (void)(maple_arr_header(a)->Size = 0) : (void)0)
 
+void* dyn_array_init(allocator Allocator, u32 ElementSize, u32 Cap);
+void dyn_array_free(void *Array);
+// When Grow is set, makes room for Count more elements, growing the capacity
+// geometrically. Otherwise makes room for Count elements in total.
+void* dyn_array_resize(void *Array, u32 ElementSize, u32 Count, bool Grow);
+bool dyn_array_fits(void *Array, u32 Count, bool Grow);
+
+//~ Struct of arrays
+
+// Each column holds one field of every element, so a loop that only touches a
+// few fields of many elements only streams those fields through the cache.
+// All columns share a count and a single allocation. Column offsets are
+// padded to a cache line from the start of the allocation, but allocators
+// only align to 16 bytes, so the end of one column and the start of the next
+// can still share a line. Columns are accessed with soa_column:
+//
+//     u32 Sizes[] = { sizeof(v3), sizeof(v3), sizeof(u32) };
+//     soa_array_init(&Particles, allocator_heap(Core->Memory, MemoryTag_Untagged), 3, Sizes, 1024);
+//
+//     u32 i = soa_array_push(&Particles);
+//     soa_column(&Particles, v3, 0)[i] = Position;
+#define SOA_ARRAY_MAX_COLUMNS 8
+#define SOA_ARRAY_INVALID     0xFFFFFFFF
+
+typedef struct soa_array
+{
+    allocator Allocator;
+
+    u32   Count;
+    u32   Cap;
+
+    u32   ColumnCount;
+    u32   ColumnSizes[SOA_ARRAY_MAX_COLUMNS];
+    void *Columns[SOA_ARRAY_MAX_COLUMNS]; // Columns[0] is the start of the allocation
+} soa_array;
+
+#define soa_column(s, Type, Column) ((Type*)(s)->Columns[Column])
+
+void soa_array_init(soa_array *Array, allocator Allocator, u32 ColumnCount, const u32 *ColumnSizes, u32 Cap);
+void soa_array_free(soa_array *Array);
+void soa_array_clear(soa_array *Array);
+// Makes room for Cap elements in total. Returns false if out of memory.
+bool soa_array_reserve(soa_array *Array, u32 Cap);
+// Adds a zeroed element and returns its index, or SOA_ARRAY_INVALID
+u32 soa_array_push(soa_array *Array);
+// Moves the last element into the hole, order is not kept
+void soa_array_remove(soa_array *Array, u32 Index);
 
 #endif //DYN_ARRAY_H
 
 #if defined(USE_MAPLE_DYN_ARRAY_IMPLEMENTATION)
 
+// Provided by the platform layer, or by the dll that includes the implementation
+void mprinte(char *Fmt, ...);
+
+void* dyn_array_init(allocator Allocator, u32 ElementSize, u32 Cap)
+{
+    dyn_array_header *Header = (dyn_array_header*)allocator_alloc(&Allocator, DYN_ARRAY_HEADER_SIZE + (u64)Cap * ElementSize);
+    if (!Header)
+    {
+        mprinte("Unable to allocate a dynamic array of %d elements!\n", Cap);
+        return NULL;
+    }
+
+    Header->Allocator = Allocator;
+    Header->Size      = 0;
+    Header->Cap       = Cap;
+
+    return (u8*)Header + DYN_ARRAY_HEADER_SIZE;
+}
+
+void dyn_array_free(void *Array)
+{
+    if (!Array) return;
+
+    dyn_array_header *Header = maple_arr_header(Array);
+    allocator Allocator = Header->Allocator;
+    allocator_free(&Allocator, Header);
+}
+
+bool dyn_array_fits(void *Array, u32 Count, bool Grow)
+{
+    if (!Array) return false;
+
+    dyn_array_header *Header = maple_arr_header(Array);
+    return ((Grow) ? Header->Size + Count : Count) <= Header->Cap;
+}
+
+void* dyn_array_resize(void *Array, u32 ElementSize, u32 Count, bool Grow)
+{
+    if (!Array)
+    {
+        u32 Cap = (Grow && Count < 8) ? 8 : Count;
+        return dyn_array_init(allocator_heap(Core->Memory, MemoryTag_Untagged), ElementSize, Cap);
+    }
+
+    dyn_array_header *Header = maple_arr_header(Array);
+
+    u32 Cap = Count;
+    if (Grow)
+    {
+        Cap = (Header->Cap) ? Header->Cap * 2 : 8;
+        while (Cap < Header->Size + Count) Cap *= 2;
+    }
+
+    if (Cap <= Header->Cap) return Array;
+
+    // The header moves with the array, the allocator has to be copied out first
+    allocator Allocator = Header->Allocator;
+    u64 OldSize = DYN_ARRAY_HEADER_SIZE + (u64)Header->Cap * ElementSize;
+    u64 NewSize = DYN_ARRAY_HEADER_SIZE + (u64)Cap * ElementSize;
+
+    dyn_array_header *Result = (dyn_array_header*)allocator_realloc(&Allocator, Header, OldSize, NewSize);
+    if (!Result)
+    {
+        mprinte("Unable to grow a dynamic array to %d elements!\n", Cap);
+        return Array;
+    }
+
+    Result->Cap = Cap;
+    return (u8*)Result + DYN_ARRAY_HEADER_SIZE;
+}
+
+//~ Struct of arrays
+
+#define SOA_ARRAY_COLUMN_ALIGN 64
+
+// Offsets of every column for a capacity, returns the size of the allocation
+file_internal u64 soa_array_layout(soa_array *Array, u32 Cap, u64 *Offsets)
+{
+    u64 Offset = 0;
+    for (u32 i = 0; i < Array->ColumnCount; ++i)
+    {
+        Offsets[i] = Offset;
+        Offset = memory_align(Offset + (u64)Cap * Array->ColumnSizes[i], SOA_ARRAY_COLUMN_ALIGN);
+    }
+
+    return Offset;
+}
+
+void soa_array_init(soa_array *Array, allocator Allocator, u32 ColumnCount, const u32 *ColumnSizes, u32 Cap)
+{
+    assert(ColumnCount > 0 && ColumnCount <= SOA_ARRAY_MAX_COLUMNS);
+
+    Array->Allocator   = Allocator;
+    Array->Count       = 0;
+    Array->Cap         = 0;
+    Array->ColumnCount = ColumnCount;
+
+    for (u32 i = 0; i < SOA_ARRAY_MAX_COLUMNS; ++i)
+    {
+        Array->ColumnSizes[i] = (i < ColumnCount) ? ColumnSizes[i] : 0;
+        Array->Columns[i]     = NULL;
+    }
+
+    if (Cap > 0) soa_array_reserve(Array, Cap);
+}
+
+void soa_array_free(soa_array *Array)
+{
+    allocator_free(&Array->Allocator, Array->Columns[0]);
+
+    for (u32 i = 0; i < SOA_ARRAY_MAX_COLUMNS; ++i) Array->Columns[i] = NULL;
+    Array->Count = 0;
+    Array->Cap   = 0;
+}
+
+void soa_array_clear(soa_array *Array)
+{
+    Array->Count = 0;
+}
+
+bool soa_array_reserve(soa_array *Array, u32 Cap)
+{
+    if (Cap <= Array->Cap) return true;
+
+    u64 OldOffsets[SOA_ARRAY_MAX_COLUMNS];
+    u64 NewOffsets[SOA_ARRAY_MAX_COLUMNS];
+    u64 OldSize = soa_array_layout(Array, Array->Cap, OldOffsets);
+    u64 NewSize = soa_array_layout(Array, Cap, NewOffsets);
+
+    u8 *Memory = (u8*)allocator_realloc(&Array->Allocator, Array->Columns[0], OldSize, NewSize);
+    if (!Memory)
+    {
+        mprinte("Unable to grow a struct of arrays to %d elements!\n", Cap);
+        return false;
+    }
+
+    // The columns only move up, so moving the last one first never overwrites
+    // a column that has not been moved yet
+    for (u32 i = Array->ColumnCount; i-- > 0;)
+    {
+        if (NewOffsets[i] != OldOffsets[i])
+        {
+            memmove(Memory + NewOffsets[i], Memory + OldOffsets[i], (u64)Array->Count * Array->ColumnSizes[i]);
+        }
+
+        Array->Columns[i] = Memory + NewOffsets[i];
+    }
+
+    Array->Cap = Cap;
+    return true;
+}
+
+u32 soa_array_push(soa_array *Array)
+{
+    if (Array->Count == Array->Cap)
+    {
+        u32 Cap = (Array->Cap) ? Array->Cap * 2 : 16;
+        if (!soa_array_reserve(Array, Cap)) return SOA_ARRAY_INVALID;
+    }
+
+    u32 Index = Array->Count++;
+    for (u32 i = 0; i < Array->ColumnCount; ++i)
+    {
+        u32 Size = Array->ColumnSizes[i];
+        memset((u8*)Array->Columns[i] + (u64)Index * Size, 0, Size);
+    }
+
+    return Index;
+}
+
+void soa_array_remove(soa_array *Array, u32 Index)
+{
+    assert(Index < Array->Count);
+
+    u32 Last = --Array->Count;
+    if (Index == Last) return;
 
+    for (u32 i = 0; i < Array->ColumnCount; ++i)
+    {
+        u32 Size = Array->ColumnSizes[i];
+        u8 *Column = (u8*)Array->Columns[i];
+        memcpy(Column + (u64)Index * Size, Column + (u64)Last * Size, Size);
+    }
+}
 
-#endif
\ No newline at end of file
+#endif
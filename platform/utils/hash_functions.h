@@ -4,6 +4,189 @@
 u128 hash_bytes(void *Key, u32 Len);
 bool compare_hash(u128 lhs, u128 rhs);
 
+//~ hash64
+// A 64-bit non-cryptographic hash for path components, names and map keys.
+// Short keys go through a wyhash style path that does a single 128-bit
+// multiply per 16 bytes. Keys longer than HASH64_LONG_THRESHOLD are consumed
+// in 64 byte stripes spread across eight accumulators, xxh3 style, which maps
+// directly onto SIMD registers. The AVX2 version is picked at runtime when
+// the cpu has it, SSE2 otherwise. Every path gives the same result, so the
+// threshold and the secret below can not change once hashes are stored.
+
+#define HASH64_SEED            0ULL
+#define HASH64_LONG_THRESHOLD  512
+#define HASH64_STRIPE_SIZE     64
+#define HASH64_BLOCK_STRIPES   8   // Accumulators are scrambled once per block
+
+// wyhash primes
+#define HASH64_P0 0xA0761D6478BD642FULL
+#define HASH64_P1 0xE7037ED1A0B428DBULL
+#define HASH64_P2 0x8EBC6AF09C88C6E3ULL
+#define HASH64_P3 0x589965CC75374CC3ULL
+
+#define HASH64_PRIME32 0x9E3779B1U
+
+#ifdef __cplusplus
+#define HASH64_CONST constexpr
+#else
+#define HASH64_CONST const
+#endif
+
+// Keys for the striped path. Stripe n of a block uses entries n to n + 7, the
+// last stripe and the scramble use entries 8 to 15.
+file_global HASH64_CONST u64 Hash64Secret[16] = {
+    0xE220A8397B1DCDAFULL, 0x6E789E6AA1B965F4ULL, 0x06C45D188009454FULL, 0xF88BB8A8724C81ECULL,
+    0x1B39896A51A8749BULL, 0x53CB9F0C747EA2EAULL, 0x2C829ABE1F4532E1ULL, 0xC584133AC916AB3CULL,
+    0x3EE5789041C98AC3ULL, 0xF3B8488C368CB0A6ULL, 0x657EECDD3CB13D09ULL, 0xC2D326E0055BDEF6ULL,
+    0x8621A03FE0BBDB7BULL, 0x8E1F7555983AA92FULL, 0xB54E0F1600CC4D19ULL, 0x84BB3F97971D80ABULL,
+};
+
+u64 hash64(const void *Key, u64 Len);
+u64 hash64_seeded(const void *Key, u64 Len, u64 Seed);
+u64 hash64_cstr(const char *Str);
+
+#ifdef __cplusplus
+// Same as hash64_seeded, written so it can be evaluated at compile time.
+// Bytes are read one at a time and the 128-bit multiply is done in halves,
+// so prefer hash64 for anything hashed at runtime.
+constexpr u64 hash64_const_read(const char *P, u32 Bytes)
+{
+    u64 Result = 0;
+    for (u32 i = 0; i < Bytes; ++i) Result |= (u64)(u8)P[i] << (8 * i);
+    return Result;
+}
+
+constexpr void hash64_const_mum(u64 *A, u64 *B)
+{
+    u64 AHi = *A >> 32, ALo = (u32)*A;
+    u64 BHi = *B >> 32, BLo = (u32)*B;
+    
+    u64 LoLo = ALo * BLo;
+    u64 HiLo = AHi * BLo;
+    u64 LoHi = ALo * BHi;
+    u64 HiHi = AHi * BHi;
+    
+    u64 Cross = (LoLo >> 32) + (u32)HiLo + LoHi;
+    *A = (Cross << 32) | (u32)LoLo;
+    *B = HiHi + (HiLo >> 32) + (Cross >> 32);
+}
+
+constexpr u64 hash64_const_mix(u64 A, u64 B)
+{
+    hash64_const_mum(&A, &B);
+    return A ^ B;
+}
+
+constexpr void hash64_const_accumulate(u64 *Acc, const char *P, const u64 *Key)
+{
+    for (u32 i = 0; i < 8; ++i)
+    {
+        u64 Data    = hash64_const_read(P + 8 * i, 8);
+        u64 DataKey = Data ^ Key[i];
+        Acc[i ^ 1] += Data;
+        Acc[i]     += (DataKey & 0xFFFFFFFF) * (DataKey >> 32);
+    }
+}
+
+constexpr void hash64_const_scramble(u64 *Acc, const u64 *Key)
+{
+    for (u32 i = 0; i < 8; ++i)
+    {
+        u64 A = Acc[i];
+        A ^= A >> 47;
+        A ^= Key[i];
+        Acc[i] = A * HASH64_PRIME32;
+    }
+}
+
+constexpr u64 hash64_const(const char *P, u64 Len, u64 Seed)
+{
+    if (Len > HASH64_LONG_THRESHOLD)
+    {
+        u64 Acc[8] = {};
+        for (u32 i = 0; i < 8; ++i) Acc[i] = Hash64Secret[i] + Seed;
+        
+        u64 BlockSize = HASH64_STRIPE_SIZE * HASH64_BLOCK_STRIPES;
+        u64 Blocks    = (Len - 1) / BlockSize;
+        for (u64 b = 0; b < Blocks; ++b)
+        {
+            for (u32 n = 0; n < HASH64_BLOCK_STRIPES; ++n)
+            {
+                hash64_const_accumulate(Acc, P + b * BlockSize + n * HASH64_STRIPE_SIZE, Hash64Secret + n);
+            }
+            hash64_const_scramble(Acc, Hash64Secret + 8);
+        }
+        
+        u64 Stripes = ((Len - 1) - Blocks * BlockSize) / HASH64_STRIPE_SIZE;
+        for (u32 n = 0; n < Stripes; ++n)
+        {
+            hash64_const_accumulate(Acc, P + Blocks * BlockSize + n * HASH64_STRIPE_SIZE, Hash64Secret + n);
+        }
+        hash64_const_accumulate(Acc, P + Len - HASH64_STRIPE_SIZE, Hash64Secret + 8);
+        
+        u64 Result = (Len * HASH64_P0) ^ Seed;
+        for (u32 i = 0; i < 4; ++i)
+        {
+            Result += hash64_const_mix(Acc[2 * i] ^ Hash64Secret[2 * i + 1], Acc[2 * i + 1] ^ Hash64Secret[2 * i]);
+        }
+        
+        Result ^= Result >> 37;
+        Result *= 0x165667919E3779F9ULL;
+        Result ^= Result >> 32;
+        return Result;
+    }
+    
+    Seed ^= hash64_const_mix(Seed ^ HASH64_P0, HASH64_P1);
+    
+    u64 A = 0, B = 0;
+    if (Len <= 16)
+    {
+        if (Len >= 4)
+        {
+            A = (hash64_const_read(P, 4) << 32) | hash64_const_read(P + ((Len >> 3) << 2), 4);
+            B = (hash64_const_read(P + Len - 4, 4) << 32) | hash64_const_read(P + Len - 4 - ((Len >> 3) << 2), 4);
+        }
+        else if (Len > 0)
+        {
+            A = ((u64)(u8)P[0] << 16) | ((u64)(u8)P[Len >> 1] << 8) | (u64)(u8)P[Len - 1];
+        }
+    }
+    else
+    {
+        u64 i = Len;
+        if (i > 48)
+        {
+            u64 See1 = Seed, See2 = Seed;
+            do
+            {
+                Seed = hash64_const_mix(hash64_const_read(P,      8) ^ HASH64_P1, hash64_const_read(P + 8,  8) ^ Seed);
+                See1 = hash64_const_mix(hash64_const_read(P + 16, 8) ^ HASH64_P2, hash64_const_read(P + 24, 8) ^ See1);
+                See2 = hash64_const_mix(hash64_const_read(P + 32, 8) ^ HASH64_P3, hash64_const_read(P + 40, 8) ^ See2);
+                P += 48;
+                i -= 48;
+            } while (i > 48);
+            Seed ^= See1 ^ See2;
+        }
+        while (i > 16)
+        {
+            Seed = hash64_const_mix(hash64_const_read(P, 8) ^ HASH64_P1, hash64_const_read(P + 8, 8) ^ Seed);
+            P += 16;
+            i -= 16;
+        }
+        A = hash64_const_read(P + i - 16, 8);
+        B = hash64_const_read(P + i - 8, 8);
+    }
+    
+    A ^= HASH64_P1;
+    B ^= Seed;
+    hash64_const_mum(&A, &B);
+    return hash64_const_mix(A ^ HASH64_P0 ^ Len, B ^ HASH64_P1);
+}
+
+// Evaluated at compile time when used in a constant expression
+#define hash64_literal(Lit) hash64_const(Lit, sizeof(Lit) - 1, HASH64_SEED)
+#endif
+
 #if defined(MAPLE_HASH_FUNCTION_IMPLEMENTATION)
 
 //-----------------------------------------------------------------------------
@@ -50,14 +233,14 @@ inline uint64_t rotl64 ( uint64_t x, int8_t r )
 
 static const u32 GlobalSeed = 8026;
 
-file_internal u128 hash_bytes(void *Key, u32 Len)
+u128 hash_bytes(void *Key, u32 Len)
 {
     u128 Result = {0};
     MurmurHash3_x64_128(Key, Len, GlobalSeed, &Result);
     return Result;
 }
 
-file_internal bool compare_hash(u128 lhs, u128 rhs)
+bool compare_hash(u128 lhs, u128 rhs)
 {
     return (lhs.Upper == rhs.Upper) && (lhs.Lower == rhs.Lower);
 }
@@ -182,6 +365,363 @@ void MurmurHash3_x64_128( const void * key, const int len,
     ((uint64_t*)out)[1] = h2;
 }
 
+//~ hash64
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define HASH64_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define HASH64_X64 0
+#endif
+
+FORCE_INLINE u64 hash64_read64(const u8 *P)
+{
+    u64 Result;
+    memcpy(&Result, P, sizeof(u64));
+    return Result;
+}
+
+FORCE_INLINE u64 hash64_read32(const u8 *P)
+{
+    u32 Result;
+    memcpy(&Result, P, sizeof(u32));
+    return Result;
+}
+
+// Full 128-bit product of A and B, low half in A and high half in B
+FORCE_INLINE void hash64_mum(u64 *A, u64 *B)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    u64 Hi;
+    *A = _umul128(*A, *B, &Hi);
+    *B = Hi;
+#else
+    __uint128_t Product = (__uint128_t)*A * *B;
+    *A = (u64)Product;
+    *B = (u64)(Product >> 64);
+#endif
+}
+
+FORCE_INLINE u64 hash64_mix(u64 A, u64 B)
+{
+    hash64_mum(&A, &B);
+    return A ^ B;
+}
+
+// Folds the accumulators of the striped path into the final hash
+file_internal u64 hash64_long_merge(u64 *Acc, u64 Len, u64 Seed)
+{
+    u64 Result = (Len * HASH64_P0) ^ Seed;
+    for (u32 i = 0; i < 4; ++i)
+    {
+        Result += hash64_mix(Acc[2 * i] ^ Hash64Secret[2 * i + 1], Acc[2 * i + 1] ^ Hash64Secret[2 * i]);
+    }
+    
+    Result ^= Result >> 37;
+    Result *= 0x165667919E3779F9ULL;
+    Result ^= Result >> 32;
+    return Result;
+}
+
+// Every version of the striped path walks the input the same way. The last
+// stripe is always the final 64 bytes, so the loops stop one byte short to
+// never consume the whole input before it.
+#define HASH64_LONG_LOOP(P, Len)                                                                    \
+u64 BlockSize = HASH64_STRIPE_SIZE * HASH64_BLOCK_STRIPES;                                          \
+u64 Blocks    = ((Len) - 1) / BlockSize;                                                            \
+for (u64 b = 0; b < Blocks; ++b)                                                                    \
+{                                                                                                   \
+    const u8 *Block = (P) + b * BlockSize;                                                          \
+    for (u32 n = 0; n < HASH64_BLOCK_STRIPES; ++n)                                                  \
+    {                                                                                               \
+        hash64_accumulate(Block + n * HASH64_STRIPE_SIZE, Hash64Secret + n);                        \
+    }                                                                                               \
+    hash64_scramble(Hash64Secret + 8);                                                              \
+}                                                                                                   \
+u64 Stripes = (((Len) - 1) - Blocks * BlockSize) / HASH64_STRIPE_SIZE;                              \
+for (u32 n = 0; n < Stripes; ++n)                                                                   \
+{                                                                                                   \
+    hash64_accumulate((P) + Blocks * BlockSize + n * HASH64_STRIPE_SIZE, Hash64Secret + n);         \
+}                                                                                                   \
+hash64_accumulate((P) + (Len) - HASH64_STRIPE_SIZE, Hash64Secret + 8)
+
+#if HASH64_X64
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define HASH64_TARGET_AVX2
+#define HASH64_TARGET_XSAVE
+#else
+#define HASH64_TARGET_AVX2  __attribute__((target("avx2")))
+#define HASH64_TARGET_XSAVE __attribute__((target("xsave")))
+#endif
+
+//~ SSE2, every x64 cpu
+
+// Two accumulators per register. Each 64-bit word of input is added into its
+// neighbour's accumulator, and the product of the low and high halves of the
+// keyed word into its own.
+FORCE_INLINE __m128i hash64_accumulate_sse2(__m128i Acc, const u8 *P, const u64 *Key)
+{
+    __m128i Data    = _mm_loadu_si128((const __m128i*)P);
+    __m128i DataKey = _mm_xor_si128(Data, _mm_loadu_si128((const __m128i*)Key));
+    __m128i Product = _mm_mul_epu32(DataKey, _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1)));
+    __m128i Swapped = _mm_shuffle_epi32(Data, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_add_epi64(Acc, _mm_add_epi64(Product, Swapped));
+}
+
+FORCE_INLINE __m128i hash64_scramble_sse2(__m128i Acc, const u64 *Key)
+{
+    // There is no 64-bit multiply, so the 32-bit prime is applied to each half
+    __m128i Prime = _mm_set1_epi32((int)HASH64_PRIME32);
+    
+    Acc = _mm_xor_si128(Acc, _mm_srli_epi64(Acc, 47));
+    Acc = _mm_xor_si128(Acc, _mm_loadu_si128((const __m128i*)Key));
+    
+    __m128i Lo = _mm_mul_epu32(Acc, Prime);
+    __m128i Hi = _mm_mul_epu32(_mm_srli_epi64(Acc, 32), Prime);
+    return _mm_add_epi64(Lo, _mm_slli_epi64(Hi, 32));
+}
+
+// Written out per register so the accumulators stay in registers
+#define hash64_accumulate(P, Key)                         \
+Acc0 = hash64_accumulate_sse2(Acc0, (P),      (Key));     \
+Acc1 = hash64_accumulate_sse2(Acc1, (P) + 16, (Key) + 2); \
+Acc2 = hash64_accumulate_sse2(Acc2, (P) + 32, (Key) + 4); \
+Acc3 = hash64_accumulate_sse2(Acc3, (P) + 48, (Key) + 6)
+
+#define hash64_scramble(Key)                  \
+Acc0 = hash64_scramble_sse2(Acc0, (Key));     \
+Acc1 = hash64_scramble_sse2(Acc1, (Key) + 2); \
+Acc2 = hash64_scramble_sse2(Acc2, (Key) + 4); \
+Acc3 = hash64_scramble_sse2(Acc3, (Key) + 6)
+
+file_internal u64 hash64_long_sse2(const u8 *P, u64 Len, u64 Seed)
+{
+    u64 Acc[8];
+    for (u32 i = 0; i < 8; ++i) Acc[i] = Hash64Secret[i] + Seed;
+    
+    __m128i Acc0 = _mm_loadu_si128((const __m128i*)Acc + 0);
+    __m128i Acc1 = _mm_loadu_si128((const __m128i*)Acc + 1);
+    __m128i Acc2 = _mm_loadu_si128((const __m128i*)Acc + 2);
+    __m128i Acc3 = _mm_loadu_si128((const __m128i*)Acc + 3);
+    
+    HASH64_LONG_LOOP(P, Len);
+    
+    _mm_storeu_si128((__m128i*)Acc + 0, Acc0);
+    _mm_storeu_si128((__m128i*)Acc + 1, Acc1);
+    _mm_storeu_si128((__m128i*)Acc + 2, Acc2);
+    _mm_storeu_si128((__m128i*)Acc + 3, Acc3);
+    
+    return hash64_long_merge(Acc, Len, Seed);
+}
+
+#undef hash64_accumulate
+#undef hash64_scramble
+
+//~ AVX2, picked at runtime
+
+// Same as the SSE2 path with four accumulators per register
+HASH64_TARGET_AVX2 FORCE_INLINE __m256i hash64_accumulate_avx2(__m256i Acc, const u8 *P, const u64 *Key)
+{
+    __m256i Data    = _mm256_loadu_si256((const __m256i*)P);
+    __m256i DataKey = _mm256_xor_si256(Data, _mm256_loadu_si256((const __m256i*)Key));
+    __m256i Product = _mm256_mul_epu32(DataKey, _mm256_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1)));
+    __m256i Swapped = _mm256_shuffle_epi32(Data, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(Acc, _mm256_add_epi64(Product, Swapped));
+}
+
+HASH64_TARGET_AVX2 FORCE_INLINE __m256i hash64_scramble_avx2(__m256i Acc, const u64 *Key)
+{
+    __m256i Prime = _mm256_set1_epi32((int)HASH64_PRIME32);
+    
+    Acc = _mm256_xor_si256(Acc, _mm256_srli_epi64(Acc, 47));
+    Acc = _mm256_xor_si256(Acc, _mm256_loadu_si256((const __m256i*)Key));
+    
+    __m256i Lo = _mm256_mul_epu32(Acc, Prime);
+    __m256i Hi = _mm256_mul_epu32(_mm256_srli_epi64(Acc, 32), Prime);
+    return _mm256_add_epi64(Lo, _mm256_slli_epi64(Hi, 32));
+}
+
+#define hash64_accumulate(P, Key)                         \
+Acc0 = hash64_accumulate_avx2(Acc0, (P),      (Key));     \
+Acc1 = hash64_accumulate_avx2(Acc1, (P) + 32, (Key) + 4)
+
+#define hash64_scramble(Key)                  \
+Acc0 = hash64_scramble_avx2(Acc0, (Key));     \
+Acc1 = hash64_scramble_avx2(Acc1, (Key) + 4)
+
+HASH64_TARGET_AVX2 file_internal u64 hash64_long_avx2(const u8 *P, u64 Len, u64 Seed)
+{
+    u64 Acc[8];
+    for (u32 i = 0; i < 8; ++i) Acc[i] = Hash64Secret[i] + Seed;
+    
+    __m256i Acc0 = _mm256_loadu_si256((const __m256i*)Acc + 0);
+    __m256i Acc1 = _mm256_loadu_si256((const __m256i*)Acc + 1);
+    
+    HASH64_LONG_LOOP(P, Len);
+    
+    _mm256_storeu_si256((__m256i*)Acc + 0, Acc0);
+    _mm256_storeu_si256((__m256i*)Acc + 1, Acc1);
+    
+    return hash64_long_merge(Acc, Len, Seed);
+}
+
+#undef hash64_accumulate
+#undef hash64_scramble
+
+// AVX2 also needs the OS to save the upper halves of the registers
+HASH64_TARGET_XSAVE file_internal bool hash64_cpu_has_avx2(void)
+{
+    int Info[4];
+#if defined(_MSC_VER)
+    __cpuid(Info, 0);
+    if (Info[0] < 7) return false;
+    
+    __cpuid(Info, 1);
+    bool Avx     = (Info[2] & (1 << 28)) != 0;
+    bool OsXSave = (Info[2] & (1 << 27)) != 0;
+    
+    __cpuidex(Info, 7, 0);
+    bool Avx2 = (Info[1] & (1 << 5)) != 0;
+#else
+    unsigned int a, b, c, d;
+    if (__get_cpuid_max(0, NULL) < 7) return false;
+    
+    __cpuid(1, a, b, c, d);
+    bool Avx     = (c & (1 << 28)) != 0;
+    bool OsXSave = (c & (1 << 27)) != 0;
+    
+    __cpuid_count(7, 0, a, b, c, d);
+    bool Avx2 = (b & (1 << 5)) != 0;
+    (void)Info;
+#endif
+    
+    return Avx && OsXSave && Avx2 && (_xgetbv(0) & 6) == 6;
+}
+
+file_internal u64 hash64_long(const u8 *P, u64 Len, u64 Seed)
+{
+    // 0 until the cpu has been checked, then 1 for SSE2 and 2 for AVX2. Racing
+    // threads all store the same value.
+    local_persist volatile u32 Path = 0;
+    if (!Path) Path = (hash64_cpu_has_avx2()) ? 2 : 1;
+    
+    return (Path == 2) ? hash64_long_avx2(P, Len, Seed) : hash64_long_sse2(P, Len, Seed);
+}
+
+#else
+
+FORCE_INLINE void hash64_accumulate_scalar(u64 *Acc, const u8 *P, const u64 *Key)
+{
+    for (u32 i = 0; i < 8; ++i)
+    {
+        u64 Data    = hash64_read64(P + 8 * i);
+        u64 DataKey = Data ^ Key[i];
+        Acc[i ^ 1] += Data;
+        Acc[i]     += (DataKey & 0xFFFFFFFF) * (DataKey >> 32);
+    }
+}
+
+FORCE_INLINE void hash64_scramble_scalar(u64 *Acc, const u64 *Key)
+{
+    for (u32 i = 0; i < 8; ++i)
+    {
+        u64 A = Acc[i];
+        A ^= A >> 47;
+        A ^= Key[i];
+        Acc[i] = A * HASH64_PRIME32;
+    }
+}
+
+#define hash64_accumulate(P, Key) hash64_accumulate_scalar(Acc, (P), (Key))
+#define hash64_scramble(Key)      hash64_scramble_scalar(Acc, (Key))
+
+file_internal u64 hash64_long(const u8 *P, u64 Len, u64 Seed)
+{
+    u64 Acc[8];
+    for (u32 i = 0; i < 8; ++i) Acc[i] = Hash64Secret[i] + Seed;
+    
+    HASH64_LONG_LOOP(P, Len);
+    
+    return hash64_long_merge(Acc, Len, Seed);
+}
+
+#undef hash64_accumulate
+#undef hash64_scramble
+
+#endif
+
+#undef HASH64_LONG_LOOP
+
+u64 hash64_seeded(const void *Key, u64 Len, u64 Seed)
+{
+    const u8 *P = (const u8*)Key;
+    if (Len > HASH64_LONG_THRESHOLD) return hash64_long(P, Len, Seed);
+    
+    Seed ^= hash64_mix(Seed ^ HASH64_P0, HASH64_P1);
+    
+    u64 A = 0, B = 0;
+    if (Len <= 16)
+    {
+        if (Len >= 4)
+        {
+            // Two overlapping reads from each end cover every byte
+            A = (hash64_read32(P) << 32) | hash64_read32(P + ((Len >> 3) << 2));
+            B = (hash64_read32(P + Len - 4) << 32) | hash64_read32(P + Len - 4 - ((Len >> 3) << 2));
+        }
+        else if (Len > 0)
+        {
+            A = ((u64)P[0] << 16) | ((u64)P[Len >> 1] << 8) | (u64)P[Len - 1];
+        }
+    }
+    else
+    {
+        u64 i = Len;
+        if (i > 48)
+        {
+            // Three independent lanes so the multiplies can overlap
+            u64 See1 = Seed, See2 = Seed;
+            do
+            {
+                Seed = hash64_mix(hash64_read64(P)      ^ HASH64_P1, hash64_read64(P + 8)  ^ Seed);
+                See1 = hash64_mix(hash64_read64(P + 16) ^ HASH64_P2, hash64_read64(P + 24) ^ See1);
+                See2 = hash64_mix(hash64_read64(P + 32) ^ HASH64_P3, hash64_read64(P + 40) ^ See2);
+                P += 48;
+                i -= 48;
+            } while (i > 48);
+            Seed ^= See1 ^ See2;
+        }
+        while (i > 16)
+        {
+            Seed = hash64_mix(hash64_read64(P) ^ HASH64_P1, hash64_read64(P + 8) ^ Seed);
+            P += 16;
+            i -= 16;
+        }
+        A = hash64_read64(P + i - 16);
+        B = hash64_read64(P + i - 8);
+    }
+    
+    A ^= HASH64_P1;
+    B ^= Seed;
+    hash64_mum(&A, &B);
+    return hash64_mix(A ^ HASH64_P0 ^ Len, B ^ HASH64_P1);
+}
+
+u64 hash64(const void *Key, u64 Len)
+{
+    return hash64_seeded(Key, Len, HASH64_SEED);
+}
+
+u64 hash64_cstr(const char *Str)
+{
+    return hash64_seeded(Str, strlen(Str), HASH64_SEED);
+}
+
 #endif
 
 #endif //HASH_FUNCTIONS_H
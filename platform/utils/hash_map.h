@@ -0,0 +1,370 @@
+#ifndef ENGINE_UTILS_HASH_MAP_H
+#define ENGINE_UTILS_HASH_MAP_H
+
+#include <stddef.h>
+
+// Open addressing hash map in the style of a Swiss table. Slots are split into
+// groups of 15, and each group has 16 control bytes: one per slot holding the
+// top byte of the key's hash (0 for an empty slot), and an overflow byte. A
+// lookup checks all 15 slots of a group with a single SSE2 compare and only
+// compares keys where the control byte matches.
+//
+// When an insert finds a group full, it sets a bit in that group's overflow
+// byte before moving to the next group. A lookup only moves past a group if
+// the bit for its hash is set. Removing an entry just clears its control
+// byte, so there are no tombstones. Overflow bits are reset on rehash.
+//
+// Keys are hashed and compared as raw bytes, so key types must not have
+// padding. Inserting can move entries, so pointers to values are only valid
+// until the next insert.
+//
+// HASH_MAP_DEFINE declares a typed wrapper:
+//
+//     HASH_MAP_DEFINE(mount_map, string_id, u32)
+//
+//     mount_map Mounts;
+//     mount_map_init(&Mounts, allocator_heap(Core->Memory, MemoryTag_AssetSys), 16);
+//     mount_map_put(&Mounts, Name, Index);
+//     u32 *Index = mount_map_find(&Mounts, Name);
+
+#define HASH_MAP_GROUP_SLOTS 15
+#define HASH_MAP_GROUP_SIZE  16 // Control bytes per group
+
+typedef struct hash_map
+{
+    allocator Allocator;
+    
+    u8  *Ctrl;      // HASH_MAP_GROUP_SIZE bytes per group
+    u8  *Entries;   // EntrySize bytes per slot, key first
+    u32  GroupMask; // The group count is a power of two
+    
+    u32  Count;
+    u32  GrowAt;    // Rehash once Count reaches this
+    
+    u32  KeySize;
+    u32  ValueOffset;
+    u32  EntrySize;
+} hash_map;
+
+// Capacity is the number of entries the map holds before it has to grow, 0
+// defers the allocation to the first insert.
+void hash_map_init(hash_map *Map, allocator Allocator, u32 KeySize, u32 ValueOffset, u32 EntrySize, u32 Capacity);
+void hash_map_free(hash_map *Map);
+void hash_map_clear(hash_map *Map);
+
+// Returns the value stored for Key, or NULL
+void* hash_map_find(hash_map *Map, const void *Key);
+// Returns the value stored for Key, adding a zeroed value if Key is not in
+// the map. Inserted is optional. Returns NULL if the map was unable to grow.
+void* hash_map_insert(hash_map *Map, const void *Key, bool *Inserted);
+bool hash_map_remove(hash_map *Map, const void *Key);
+
+// Visits every entry, in no particular order:
+//     for (u32 Iter = 0; hash_map_next(Map, &Iter, &Key, &Value);)
+// Entries can be removed while iterating, but not inserted.
+bool hash_map_next(hash_map *Map, u32 *Iter, void **Key, void **Value);
+
+#define HASH_MAP_DEFINE(Name, KeyType, ValueType)                                                  \
+typedef struct Name##_entry { KeyType Key; ValueType Value; } Name##_entry;                        \
+typedef struct Name { hash_map Map; } Name;                                                        \
+                                                                                                   \
+static inline void Name##_init(Name *M, allocator Allocator, u32 Capacity)                         \
+{                                                                                                  \
+    hash_map_init(&M->Map, Allocator, sizeof(KeyType), offsetof(Name##_entry, Value),              \
+                  sizeof(Name##_entry), Capacity);                                                 \
+}                                                                                                  \
+static inline void Name##_free(Name *M)  { hash_map_free(&M->Map); }                               \
+static inline void Name##_clear(Name *M) { hash_map_clear(&M->Map); }                              \
+static inline u32  Name##_count(Name *M) { return M->Map.Count; }                                  \
+                                                                                                   \
+static inline ValueType* Name##_find(Name *M, KeyType Key)                                         \
+{                                                                                                  \
+    return (ValueType*)hash_map_find(&M->Map, &Key);                                               \
+}                                                                                                  \
+static inline ValueType* Name##_insert(Name *M, KeyType Key, bool *Inserted)                       \
+{                                                                                                  \
+    return (ValueType*)hash_map_insert(&M->Map, &Key, Inserted);                                   \
+}                                                                                                  \
+static inline void Name##_put(Name *M, KeyType Key, ValueType Value)                               \
+{                                                                                                  \
+    ValueType *Slot = (ValueType*)hash_map_insert(&M->Map, &Key, NULL);                            \
+    if (Slot) *Slot = Value;                                                                       \
+}                                                                                                  \
+static inline bool Name##_remove(Name *M, KeyType Key)                                             \
+{                                                                                                  \
+    return hash_map_remove(&M->Map, &Key);                                                         \
+}                                                                                                  \
+static inline bool Name##_next(Name *M, u32 *Iter, KeyType **Key, ValueType **Value)               \
+{                                                                                                  \
+    return hash_map_next(&M->Map, Iter, (void**)Key, (void**)Value);                               \
+}
+
+#endif //ENGINE_UTILS_HASH_MAP_H
+
+#if defined(MAPLE_HASH_MAP_IMPLEMENTATION)
+
+// Provided by the platform layer, or by the dll that includes the implementation
+void mprinte(char *Fmt, ...);
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HASH_MAP_SSE2 1
+#else
+#define HASH_MAP_SSE2 0
+#endif
+
+#define hash_map_slot_count(m)  (((m)->Ctrl) ? ((m)->GroupMask + 1) * HASH_MAP_GROUP_SLOTS : 0)
+#define hash_map_max_load(s)    ((u32)((u64)(s) * 7 / 8))
+#define hash_map_group(m, g)    ((m)->Ctrl + (u64)(g) * HASH_MAP_GROUP_SIZE)
+#define hash_map_entry(m, g, s) ((m)->Entries + ((u64)(g) * HASH_MAP_GROUP_SLOTS + (s)) * (m)->EntrySize)
+
+// The top byte of the hash, 0 is kept for empty slots
+file_internal u8 hash_map_ctrl(u64 Hash)
+{
+    u8 Result = (u8)(Hash >> 56);
+    return (Result) ? Result : 1;
+}
+
+// Bits the group index and the control byte do not use
+file_internal u8 hash_map_overflow_bit(u64 Hash)
+{
+    return (u8)(1 << ((Hash >> 48) & 7));
+}
+
+// Bit i is set when slot i of the group holds Ctrl
+file_internal u32 hash_map_match(const u8 *Group, u8 Ctrl)
+{
+#if HASH_MAP_SSE2
+    __m128i Bytes = _mm_loadu_si128((const __m128i*)Group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(Bytes, _mm_set1_epi8((char)Ctrl))) & 0x7FFF;
+#else
+    u32 Result = 0;
+    for (u32 i = 0; i < HASH_MAP_GROUP_SLOTS; ++i) Result |= (u32)(Group[i] == Ctrl) << i;
+    return Result;
+#endif
+}
+
+file_internal u32 hash_map_lowest_bit(u32 Mask)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long Index;
+    _BitScanForward(&Index, Mask);
+    return (u32)Index;
+#else
+    return (u32)__builtin_ctz(Mask);
+#endif
+}
+
+// Puts the entry in the first free slot along the probe sequence. The key has
+// to be missing from the map, and the map has to have a free slot.
+file_internal u8* hash_map_place(hash_map *Map, u64 Hash)
+{
+    u32 Group = (u32)Hash & Map->GroupMask;
+    for (u32 Step = 1;; ++Step)
+    {
+        u8 *Ctrl = hash_map_group(Map, Group);
+        
+        u32 Empty = hash_map_match(Ctrl, 0);
+        if (Empty)
+        {
+            u32 Slot = hash_map_lowest_bit(Empty);
+            Ctrl[Slot] = hash_map_ctrl(Hash);
+            return hash_map_entry(Map, Group, Slot);
+        }
+        
+        Ctrl[HASH_MAP_GROUP_SLOTS] |= hash_map_overflow_bit(Hash);
+        
+        // Triangular steps visit every group when the count is a power of two
+        Group = (Group + Step) & Map->GroupMask;
+    }
+}
+
+file_internal bool hash_map_rehash(hash_map *Map, u32 GroupCount)
+{
+    u64 CtrlSize = (u64)GroupCount * HASH_MAP_GROUP_SIZE;
+    u64 Size     = CtrlSize + (u64)GroupCount * HASH_MAP_GROUP_SLOTS * Map->EntrySize;
+    
+    u8 *Memory = (u8*)allocator_alloc(&Map->Allocator, Size);
+    if (!Memory)
+    {
+        mprinte("Unable to grow hash map to %d groups!\n", GroupCount);
+        return false;
+    }
+    memset(Memory, 0, CtrlSize);
+    
+    hash_map Old = *Map;
+    
+    Map->Ctrl      = Memory;
+    Map->Entries   = Memory + CtrlSize;
+    Map->GroupMask = GroupCount - 1;
+    Map->GrowAt    = hash_map_max_load(GroupCount * HASH_MAP_GROUP_SLOTS);
+    
+    if (Old.Ctrl)
+    {
+        for (u32 Group = 0; Group <= Old.GroupMask; ++Group)
+        {
+            u8 *Ctrl = hash_map_group(&Old, Group);
+            for (u32 Slot = 0; Slot < HASH_MAP_GROUP_SLOTS; ++Slot)
+            {
+                if (!Ctrl[Slot]) continue;
+                
+                u8 *Entry = hash_map_entry(&Old, Group, Slot);
+                u64 Hash  = hash64(Entry, Map->KeySize);
+                memcpy(hash_map_place(Map, Hash), Entry, Map->EntrySize);
+            }
+        }
+        
+        allocator_free(&Map->Allocator, Old.Ctrl);
+    }
+    
+    return true;
+}
+
+file_internal u8* hash_map_find_hashed(hash_map *Map, const void *Key, u64 Hash)
+{
+    if (!Map->Ctrl) return NULL;
+    
+    u8  Tag         = hash_map_ctrl(Hash);
+    u8  OverflowBit = hash_map_overflow_bit(Hash);
+    u32 Group       = (u32)Hash & Map->GroupMask;
+    
+    for (u32 Step = 1; Step <= Map->GroupMask + 1; ++Step)
+    {
+        u8 *Ctrl = hash_map_group(Map, Group);
+        
+        for (u32 Match = hash_map_match(Ctrl, Tag); Match; Match &= Match - 1)
+        {
+            u8 *Entry = hash_map_entry(Map, Group, hash_map_lowest_bit(Match));
+            if (memcmp(Entry, Key, Map->KeySize) == 0) return Entry;
+        }
+        
+        // Nothing with this hash was ever pushed past this group
+        if (!(Ctrl[HASH_MAP_GROUP_SLOTS] & OverflowBit)) return NULL;
+        
+        Group = (Group + Step) & Map->GroupMask;
+    }
+    
+    return NULL;
+}
+
+void hash_map_init(hash_map *Map, allocator Allocator, u32 KeySize, u32 ValueOffset, u32 EntrySize, u32 Capacity)
+{
+    Map->Allocator   = Allocator;
+    Map->Ctrl        = NULL;
+    Map->Entries     = NULL;
+    Map->GroupMask   = 0;
+    Map->Count       = 0;
+    Map->GrowAt      = 0;
+    Map->KeySize     = KeySize;
+    Map->ValueOffset = ValueOffset;
+    Map->EntrySize   = EntrySize;
+    
+    if (Capacity > 0)
+    {
+        u32 GroupCount = 1;
+        while (hash_map_max_load(GroupCount * HASH_MAP_GROUP_SLOTS) < Capacity) GroupCount <<= 1;
+        hash_map_rehash(Map, GroupCount);
+    }
+}
+
+void hash_map_free(hash_map *Map)
+{
+    allocator_free(&Map->Allocator, Map->Ctrl);
+    
+    Map->Ctrl      = NULL;
+    Map->Entries   = NULL;
+    Map->GroupMask = 0;
+    Map->Count     = 0;
+    Map->GrowAt    = 0;
+}
+
+void hash_map_clear(hash_map *Map)
+{
+    if (!Map->Ctrl) return;
+    
+    memset(Map->Ctrl, 0, (u64)(Map->GroupMask + 1) * HASH_MAP_GROUP_SIZE);
+    Map->Count  = 0;
+    Map->GrowAt = hash_map_max_load(hash_map_slot_count(Map));
+}
+
+void* hash_map_find(hash_map *Map, const void *Key)
+{
+    u8 *Entry = hash_map_find_hashed(Map, Key, hash64(Key, Map->KeySize));
+    return (Entry) ? Entry + Map->ValueOffset : NULL;
+}
+
+void* hash_map_insert(hash_map *Map, const void *Key, bool *Inserted)
+{
+    u64 Hash  = hash64(Key, Map->KeySize);
+    u8 *Entry = hash_map_find_hashed(Map, Key, Hash);
+    
+    if (Inserted) *Inserted = (Entry == NULL);
+    if (Entry) return Entry + Map->ValueOffset;
+    
+    if (Map->Count >= Map->GrowAt)
+    {
+        // GrowAt also drops when entries are removed from overflowed groups.
+        // If the map is still well below the load limit, that is why it was
+        // hit, so rehash at the same size to clear the overflow bits.
+        u32 GroupCount = (Map->Ctrl) ? Map->GroupMask + 1 : 0;
+        u32 SlotCount  = hash_map_slot_count(Map);
+        
+        if (!GroupCount) GroupCount = 1;
+        else if (Map->Count >= hash_map_max_load(SlotCount) / 4 * 3) GroupCount *= 2;
+        
+        if (!hash_map_rehash(Map, GroupCount)) return NULL;
+    }
+    
+    Entry = hash_map_place(Map, Hash);
+    memcpy(Entry, Key, Map->KeySize);
+    memset(Entry + Map->KeySize, 0, Map->EntrySize - Map->KeySize);
+    Map->Count++;
+    
+    return Entry + Map->ValueOffset;
+}
+
+bool hash_map_remove(hash_map *Map, const void *Key)
+{
+    u8 *Entry = hash_map_find_hashed(Map, Key, hash64(Key, Map->KeySize));
+    if (!Entry) return false;
+    
+    u64 Index = (u64)(Entry - Map->Entries) / Map->EntrySize;
+    u8 *Ctrl  = hash_map_group(Map, Index / HASH_MAP_GROUP_SLOTS);
+    
+    Ctrl[Index % HASH_MAP_GROUP_SLOTS] = 0;
+    Map->Count--;
+    
+    // Lookups keep probing past an overflowed group even once it has room,
+    // so these removals count toward the next rehash.
+    if (Ctrl[HASH_MAP_GROUP_SLOTS]) Map->GrowAt--;
+    
+    return true;
+}
+
+bool hash_map_next(hash_map *Map, u32 *Iter, void **Key, void **Value)
+{
+    u32 SlotCount = hash_map_slot_count(Map);
+    for (u32 Index = *Iter; Index < SlotCount; ++Index)
+    {
+        u32 Group = Index / HASH_MAP_GROUP_SLOTS;
+        u32 Slot  = Index % HASH_MAP_GROUP_SLOTS;
+        if (!hash_map_group(Map, Group)[Slot]) continue;
+        
+        u8 *Entry = hash_map_entry(Map, Group, Slot);
+        if (Key)   *Key   = Entry;
+        if (Value) *Value = Entry + Map->ValueOffset;
+        
+        *Iter = Index + 1;
+        return true;
+    }
+    
+    *Iter = SlotCount;
+    return false;
+}
+
+#undef hash_map_slot_count
+#undef hash_map_max_load
+#undef hash_map_group
+#undef hash_map_entry
+
+#endif
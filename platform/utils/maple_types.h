@@ -30,7 +30,7 @@ typedef union u128
 } u128;
 
 // Defines for calculating size
-#define _KB(x) (x * 1024)
+#define _KB(x) ((u64)(x) * 1024)
 #define _MB(x) (_KB(x) * 1024)
 #define _GB(x) (_MB(x) * 1024)
 
@@ -3,17 +3,27 @@
 #ifndef ENGINE_UTILS_MSTR_H
 #define ENGINE_UTILS_MSTR_H
 
-typedef union 
+#include <stdarg.h>
+
+// Strings of up to MSTR_STACK_SIZE - 1 characters are stored inline, longer
+// strings are allocated from Core->Memory. The last byte of the inline buffer
+// holds the inline length, or MSTR_HEAP_FLAG when the string lives on the
+// heap. A zero initialized mstr is a valid, empty string.
+#define MSTR_STACK_SIZE 23
+#define MSTR_HEAP_FLAG  0xFF
+
+typedef union
 {
     struct
     {
-        char Stack[12];
-        u32       Len;
+        char Stack[MSTR_STACK_SIZE];
+        u8   StackLen;
     };
     
     struct
     {
         char *Heap;
+        u32   HeapLen;
         u32   HeapSize;
     };
     
@@ -22,34 +32,104 @@ typedef union
 mstr mstr_init(char *Cstr, u32 CStrLen);
 void mstr_free(mstr *String);
 mstr mstr_add(mstr *Left, mstr *Right);
-mstr mstr_concat(mstr *Src, mstr *Other);
-mstr cstr_concat(mstr *Src, char *Other);
 mstr cstr_add(char *Left, u32 LeftLen, char *Right, u32 RightLen);
+// Appends Other to the end of Src
+void mstr_concat(mstr *Src, mstr *Other);
+void cstr_concat(mstr *Src, char *Other);
 char *mstr_to_cstr(mstr *Src);
+u32 mstr_len(mstr *Src);
+// Shortens the string to Len characters. Does not move the string back inline.
+void mstr_set_len(mstr *Src, u32 Len);
+
+// Builds a string in memory from a frame allocator, so temporary strings
+// (paths, messages) never touch the heap. The buffer grows geometrically, and
+// because it is usually the last allocation made from the frame, it is grown
+// in place. The string is only valid until the frame is recycled. If the
+// frame runs out of memory, appends are truncated.
+typedef struct mstr_builder
+{
+    frame_allocator *Arena;
+    
+    char *Buffer; // Always null terminated once allocated
+    u32   Len;
+    u32   Cap;    // Includes the null terminator
+} mstr_builder;
+
+void mstr_builder_init(mstr_builder *Builder, frame_allocator *Arena, u32 InitialCap);
+void mstr_builder_reset(mstr_builder *Builder);
+void mstr_builder_append(mstr_builder *Builder, const char *Str, u32 Len);
+void mstr_builder_append_cstr(mstr_builder *Builder, const char *Str);
+void mstr_builder_append_mstr(mstr_builder *Builder, mstr *Str);
+// printf style formatting, appended to the builder
+void mstr_format(mstr_builder *Builder, const char *Fmt, ...);
+char *mstr_builder_to_cstr(mstr_builder *Builder);
 
 #endif //MSTR_H
 
 #if defined(USE_MAPLE_MSTR_IMPLEMENTATION)
 
+// Provided by the platform layer, or by the dll that includes the implementation
+void mprinte(char *Fmt, ...);
+
+#define mstr_is_heap(s) ((s)->StackLen == MSTR_HEAP_FLAG)
+
+// Makes room for Len characters and a null terminator. The contents are kept.
+file_internal char* mstr_reserve(mstr *String, u32 Len)
+{
+    if (mstr_is_heap(String))
+    {
+        if (Len + 1 > String->HeapSize)
+        {
+            u32 HeapSize = String->HeapSize * 2;
+            if (HeapSize < Len + 1) HeapSize = Len + 1;
+            
+            String->Heap     = (char*)memory_realloc(Core->Memory, String->Heap, HeapSize);
+            String->HeapSize = HeapSize;
+        }
+        
+        return String->Heap;
+    }
+    else if (Len >= MSTR_STACK_SIZE)
+    {
+        u32 StackLen = String->StackLen;
+        
+        char *Heap = (char*)memory_alloc_tagged(Core->Memory, Len + 1, MemoryTag_Mstr);
+        memcpy(Heap, String->Stack, StackLen);
+        
+        String->Heap     = Heap;
+        String->HeapLen  = StackLen;
+        String->HeapSize = Len + 1;
+        String->StackLen = MSTR_HEAP_FLAG;
+        
+        return Heap;
+    }
+    
+    return String->Stack;
+}
+
+file_internal void mstr_store_len(mstr *String, u32 Len)
+{
+    if (mstr_is_heap(String))
+    {
+        String->HeapLen = Len;
+        String->Heap[Len] = 0;
+    }
+    else
+    {
+        String->StackLen = (u8)Len;
+        String->Stack[Len] = 0;
+    }
+}
+
 mstr mstr_init(char *Cstr, u32 CstrLen)
 {
     mstr Result = {0};
-    Result.Len = CstrLen;
     
     if (Cstr && CstrLen > 0)
     {
-        if (CstrLen > 11)
-        {
-            Result.HeapSize = CstrLen + 1;
-            Result.Heap = (char*)memory_alloc(Core->Memory, CstrLen + 1);
-            memcpy(Result.Heap, Cstr, Result.Len);
-            Result.Heap[Result.Len] = 0;
-        }
-        else
-        {
-            memcpy(Result.Stack, Cstr, Result.Len);
-            Result.Stack[Result.Len] = 0;
-        }
+        char *Str = mstr_reserve(&Result, CstrLen);
+        memcpy(Str, Cstr, CstrLen);
+        mstr_store_len(&Result, CstrLen);
     }
     
     return Result;
@@ -57,89 +137,182 @@ mstr mstr_init(char *Cstr, u32 CstrLen)
 
 void mstr_free(mstr *String)
 {
-    if (String->Len > 11) 
+    if (mstr_is_heap(String))
     {
         memory_release(Core->Memory, String->Heap);
-        String->Heap = NULL;
-        String->HeapSize = 0;
     }
     
-    String->Len = 0;
+    memset(String, 0, sizeof(mstr));
 }
 
 mstr mstr_add(mstr *Left, mstr *Right)
+{
+    return cstr_add(mstr_to_cstr(Left), mstr_len(Left), mstr_to_cstr(Right), mstr_len(Right));
+}
+
+mstr cstr_add(char *Left, u32 LeftLen, char *Right, u32 RightLen)
 {
     mstr Result = {0};
-    Result.Len = Left->Len + Right->Len;
+    u32 Len = LeftLen + RightLen;
+    
+    char *Str = mstr_reserve(&Result, Len);
+    memcpy(Str, Left, LeftLen);
+    memcpy(Str + LeftLen, Right, RightLen);
+    mstr_store_len(&Result, Len);
+    
+    return Result;
+}
+
+void mstr_concat(mstr *Src, mstr *Other)
+{
+    u32 SrcLen   = mstr_len(Src);
+    u32 OtherLen = mstr_len(Other);
     
-    if (Result.Len > 11)
+    // Other might be Src, and reserving can move Src
+    if (Src == Other)
     {
-        if (Result.Len > 11)
-        {
-            Result.HeapSize = Result.Len + 1;
-            Result.Heap = (char*)memory_alloc(Core->Memory, Result.HeapSize);
-            
-            memcpy(Result.Heap, mstr_to_cstr(Left), Left->Len);
-            memcpy(Result.Heap + Left->Len, mstr_to_cstr(Right), Right->Len);
-            
-            Result.Heap[Result.Len] = 0;
-        }
-        else
-        {
-            memcpy(Result.Stack, mstr_to_cstr(Left), Left->Len);
-            memcpy(Result.Stack + Left->Len, mstr_to_cstr(Right), Right->Len);
-            Result.Stack[Result.Len] = 0;
-        }
+        char *Str = mstr_reserve(Src, 2 * SrcLen);
+        memcpy(Str + SrcLen, Str, SrcLen);
+    }
+    else
+    {
+        char *Str = mstr_reserve(Src, SrcLen + OtherLen);
+        memcpy(Str + SrcLen, mstr_to_cstr(Other), OtherLen);
     }
     
-    return Result;
+    mstr_store_len(Src, SrcLen + OtherLen);
 }
 
-mstr mstr_concat(mstr *Src, mstr *Other)
+void cstr_concat(mstr *Src, char *Other)
 {
-    mstr Result = {0};
+    u32 SrcLen   = mstr_len(Src);
+    u32 OtherLen = (u32)strlen(Other);
     
-    return Result;
+    char *Str = mstr_reserve(Src, SrcLen + OtherLen);
+    memcpy(Str + SrcLen, Other, OtherLen);
+    mstr_store_len(Src, SrcLen + OtherLen);
 }
 
-mstr cstr_concat(mstr *Src, char *Other)
+char *mstr_to_cstr(mstr *Src)
 {
-    mstr Result = {0};
+    return (mstr_is_heap(Src)) ? Src->Heap : Src->Stack;
+}
+
+u32 mstr_len(mstr *Src)
+{
+    return (mstr_is_heap(Src)) ? Src->HeapLen : Src->StackLen;
+}
+
+void mstr_set_len(mstr *Src, u32 Len)
+{
+    assert(Len <= mstr_len(Src));
+    mstr_store_len(Src, Len);
+}
+
+//~ String builder
+
+// Makes room for Len more characters. Returns false if the arena is out of
+// memory, in which case the buffer is left as it was.
+file_internal bool mstr_builder_reserve(mstr_builder *Builder, u32 Len)
+{
+    u32 Needed = Builder->Len + Len + 1;
+    if (Needed <= Builder->Cap) return true;
     
-    return Result;
+    u32 Cap = (Builder->Cap) ? Builder->Cap * 2 : 64;
+    while (Cap < Needed) Cap *= 2;
+    
+    char *Buffer = (char*)frame_realloc(Builder->Arena, Builder->Buffer, Builder->Cap, Cap);
+    if (!Buffer) return false;
+    
+    Builder->Buffer = Buffer;
+    Builder->Cap    = Cap;
+    Builder->Buffer[Builder->Len] = 0;
+    
+    return true;
 }
 
-mstr cstr_add(char *Left, u32 LeftLen, char *Right, u32 RightLen)
+void mstr_builder_init(mstr_builder *Builder, frame_allocator *Arena, u32 InitialCap)
 {
-    mstr Result = {0};
-    Result.Len = LeftLen + RightLen;
+    Builder->Arena  = Arena;
+    Builder->Buffer = NULL;
+    Builder->Len    = 0;
+    Builder->Cap    = 0;
     
-    if (Result.Len > 11)
+    if (InitialCap > 0) mstr_builder_reserve(Builder, InitialCap);
+}
+
+void mstr_builder_reset(mstr_builder *Builder)
+{
+    Builder->Len = 0;
+    if (Builder->Buffer) Builder->Buffer[0] = 0;
+}
+
+void mstr_builder_append(mstr_builder *Builder, const char *Str, u32 Len)
+{
+    if (!mstr_builder_reserve(Builder, Len))
     {
-        if (Result.Len > 11)
-        {
-            Result.HeapSize = Result.Len + 1;
-            Result.Heap = (char*)memory_alloc(Core->Memory, Result.HeapSize);
-            
-            memcpy(Result.Heap, Left, LeftLen);
-            memcpy(Result.Heap + LeftLen, Right, RightLen);
-            
-            Result.Heap[Result.Len] = 0;
-        }
-        else
-        {
-            memcpy(Result.Stack, Left, LeftLen);
-            memcpy(Result.Stack + LeftLen, Right, RightLen);
-            Result.Stack[Result.Len] = 0;
-        }
+        // Keep whatever fits in the buffer we already have
+        if (Builder->Cap == 0) return;
+        Len = Builder->Cap - Builder->Len - 1;
     }
     
-    return Result;
+    memcpy(Builder->Buffer + Builder->Len, Str, Len);
+    Builder->Len += Len;
+    Builder->Buffer[Builder->Len] = 0;
 }
 
-char *mstr_to_cstr(mstr *Src)
+void mstr_builder_append_cstr(mstr_builder *Builder, const char *Str)
+{
+    mstr_builder_append(Builder, Str, (u32)strlen(Str));
+}
+
+void mstr_builder_append_mstr(mstr_builder *Builder, mstr *Str)
+{
+    mstr_builder_append(Builder, mstr_to_cstr(Str), mstr_len(Str));
+}
+
+void mstr_format(mstr_builder *Builder, const char *Fmt, ...)
+{
+    va_list Args, Copy;
+    va_start(Args, Fmt);
+    
+    // Try to format into the space that is already there. Only when that is
+    // too small is the buffer grown and the string formatted a second time.
+    u32 Available = (Builder->Cap) ? Builder->Cap - Builder->Len : 0;
+    char *Dst = (Builder->Buffer) ? Builder->Buffer + Builder->Len : NULL;
+    
+    va_copy(Copy, Args);
+    i32 Written = vsnprintf(Dst, Available, Fmt, Copy);
+    va_end(Copy);
+    
+    if (Written < 0)
+    {
+        mprinte("mstr_format: invalid format string \"%s\"\n", Fmt);
+        if (Dst) *Dst = 0;
+    }
+    else if ((u32)Written < Available)
+    {
+        Builder->Len += Written;
+    }
+    else if (mstr_builder_reserve(Builder, Written))
+    {
+        vsnprintf(Builder->Buffer + Builder->Len, Builder->Cap - Builder->Len, Fmt, Args);
+        Builder->Len += Written;
+    }
+    else if (Available > 0)
+    {
+        // Out of memory, vsnprintf already wrote the part that fits
+        Builder->Len += Available - 1;
+    }
+    
+    va_end(Args);
+}
+
+char *mstr_builder_to_cstr(mstr_builder *Builder)
 {
-    return (Src->Len > 11) ? Src->Heap : Src->Stack;
+    return (Builder->Buffer) ? Builder->Buffer : (char*)"";
 }
 
-#endif
\ No newline at end of file
+#undef mstr_is_heap
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef ENGINE_UTILS_STRING_INTERN_H
+#define ENGINE_UTILS_STRING_INTERN_H
+
+// Maps strings to small, stable ids. A string is hashed and copied once, when
+// it is interned. After that, comparing two strings is comparing two u32s.
+// Ids are never reused, and the characters of an interned string never move,
+// so both can be held on to for the lifetime of the table.
+//
+// Lookups do not take a lock. Interning new strings is serialized by a spin
+// lock, and an entry is fully written before its id is published in the
+// table, so readers on other threads never see a partial string.
+
+typedef u32 string_id;
+
+// Strings the engine refers to by name. They are interned in this order when
+// the table is created, so their ids are known at compile time and hot paths
+// can use StringId_* directly instead of hashing a literal every call.
+#define STRING_ID_PREDEFINED(X) \
+X(Root,     "root")             \
+X(Shaders,  "shaders")
+
+typedef enum string_id_predefined
+{
+    StringId_None = 0, // Never a valid string
+
+#define X(Name, Str) StringId_##Name,
+    STRING_ID_PREDEFINED(X)
+#undef X
+
+    StringId_PredefinedCount,
+} string_id_predefined;
+
+#define STRING_TABLE_CHUNK_SIZE _KB(64) // Character data is carved from chunks this big
+
+typedef struct string_entry
+{
+    const char *Str; // Null terminated
+    u32         Len;
+    u32         Hash;
+} string_entry;
+
+typedef struct string_table
+{
+    // Guards interning, lookups never take it
+    spin_lock Lock;
+    
+    memory *Heap;
+    
+    // Open addressing over string ids, 0 is an empty slot. Strings are never
+    // removed, so a probe can stop at the first empty slot.
+    volatile u32 *Slots;
+    u32           SlotMask;
+    
+    string_entry *Entries; // Indexed by string_id
+    u32           Capacity;
+    volatile u32  Count;   // Next id to hand out
+    
+    // Chunks are linked through their first pointer
+    char *Chunk;
+    u64   ChunkUsed;
+} string_table;
+
+// hash64 folded to 32 bits. Used by the table so that ids can also be found
+// from a hash computed ahead of time, see string_hash_literal.
+u32 string_hash(const char *Str, u32 Len);
+
+#ifdef __cplusplus
+constexpr u32 string_hash_fold(u64 Hash)
+{
+    return (u32)(Hash ^ (Hash >> 32));
+}
+// Evaluated at compile time when used in a constant expression
+#define string_hash_literal(Lit) string_hash_fold(hash64_literal(Lit))
+#endif
+
+// Capacity is the most strings the table can hold, including the predefined ones
+void string_table_init(string_table *Table, memory *Heap, u32 Capacity);
+void string_table_free(string_table *Table);
+
+// Returns the id of the string, adding it to the table if needed. Returns
+// StringId_None if the table is full.
+string_id string_intern(string_table *Table, const char *Str, u32 Len);
+string_id string_intern_cstr(string_table *Table, const char *Str);
+
+// Returns the id of an already interned string, or StringId_None. Never
+// allocates or takes the lock.
+string_id string_find(string_table *Table, const char *Str, u32 Len);
+// Same as string_find with the hash already computed
+string_id string_find_hashed(string_table *Table, u32 Hash, const char *Str, u32 Len);
+
+const char* string_get(string_table *Table, string_id Id);
+u32 string_get_len(string_table *Table, string_id Id);
+
+#endif //ENGINE_UTILS_STRING_INTERN_H
+
+#if defined(MAPLE_STRING_INTERN_IMPLEMENTATION)
+
+// Provided by the platform layer
+void mprinte(char *Fmt, ...);
+
+u32 string_hash(const char *Str, u32 Len)
+{
+    u64 Hash = hash64(Str, Len);
+    return (u32)(Hash ^ (Hash >> 32));
+}
+
+void string_table_init(string_table *Table, memory *Heap, u32 Capacity)
+{
+    // Keep the load factor at or below 50% so probes stay short
+    u32 SlotCount = 1;
+    while (SlotCount < 2 * Capacity) SlotCount <<= 1;
+    
+    Table->Lock      = 0;
+    Table->Heap      = Heap;
+    Table->SlotMask  = SlotCount - 1;
+    Table->Capacity  = Capacity;
+    Table->Count     = 1; // StringId_None
+    Table->Chunk     = NULL;
+    Table->ChunkUsed = STRING_TABLE_CHUNK_SIZE;
+    
+    Table->Slots   = (volatile u32*)memory_alloc_tagged(Heap, SlotCount * sizeof(u32), MemoryTag_Strings);
+    Table->Entries = (string_entry*)memory_alloc_tagged(Heap, Capacity * sizeof(string_entry), MemoryTag_Strings);
+    
+    memset((void*)Table->Slots, 0, SlotCount * sizeof(u32));
+    memset(Table->Entries, 0, Capacity * sizeof(string_entry));
+    
+    Table->Entries[StringId_None].Str = "";
+    
+    string_id Id;
+#define X(Name, Str) Id = string_intern(Table, Str, sizeof(Str) - 1); assert(Id == StringId_##Name);
+    STRING_ID_PREDEFINED(X)
+#undef X
+}
+
+void string_table_free(string_table *Table)
+{
+    while (Table->Chunk)
+    {
+        char *Prev = *(char**)Table->Chunk;
+        memory_release(Table->Heap, Table->Chunk);
+        Table->Chunk = Prev;
+    }
+    
+    memory_release(Table->Heap, (void*)Table->Slots);
+    memory_release(Table->Heap, Table->Entries);
+    
+    Table->Slots    = NULL;
+    Table->Entries  = NULL;
+    Table->SlotMask = 0;
+    Table->Capacity = 0;
+    Table->Count    = 0;
+}
+
+string_id string_find_hashed(string_table *Table, u32 Hash, const char *Str, u32 Len)
+{
+    for (u32 Slot = Hash & Table->SlotMask;; Slot = (Slot + 1) & Table->SlotMask)
+    {
+        string_id Id = atomic_load_u32(Table->Slots + Slot);
+        if (Id == StringId_None) return StringId_None;
+        
+        string_entry *Entry = Table->Entries + Id;
+        if (Entry->Hash == Hash && Entry->Len == Len && memcmp(Entry->Str, Str, Len) == 0)
+        {
+            return Id;
+        }
+    }
+}
+
+string_id string_find(string_table *Table, const char *Str, u32 Len)
+{
+    return string_find_hashed(Table, string_hash(Str, Len), Str, Len);
+}
+
+string_id string_intern(string_table *Table, const char *Str, u32 Len)
+{
+    u32 Hash = string_hash(Str, Len);
+    
+    string_id Result = string_find_hashed(Table, Hash, Str, Len);
+    if (Result) return Result;
+    
+    spin_lock_acquire(&Table->Lock);
+    
+    // Another thread might have added it between the lookup and taking the lock
+    u32 Slot = Hash & Table->SlotMask;
+    for (;; Slot = (Slot + 1) & Table->SlotMask)
+    {
+        string_id Id = Table->Slots[Slot];
+        if (Id == StringId_None) break;
+        
+        string_entry *Entry = Table->Entries + Id;
+        if (Entry->Hash == Hash && Entry->Len == Len && memcmp(Entry->Str, Str, Len) == 0)
+        {
+            Result = Id;
+            break;
+        }
+    }
+    
+    if (!Result)
+    {
+        if (Table->Count >= Table->Capacity)
+        {
+            mprinte("String table is full! Unable to intern \"%.*s\".\n", Len, Str);
+        }
+        else
+        {
+            // Strings too large for a chunk get a chunk of their own
+            u64 Size = Len + 1;
+            if (Table->ChunkUsed + Size > STRING_TABLE_CHUNK_SIZE)
+            {
+                u64 ChunkSize = sizeof(char*) + Size;
+                if (ChunkSize < STRING_TABLE_CHUNK_SIZE) ChunkSize = STRING_TABLE_CHUNK_SIZE;
+                
+                char *Chunk = (char*)memory_alloc_tagged(Table->Heap, ChunkSize, MemoryTag_Strings);
+                *(char**)Chunk = Table->Chunk;
+                
+                Table->Chunk     = Chunk;
+                Table->ChunkUsed = sizeof(char*);
+            }
+            
+            char *Copy = Table->Chunk + Table->ChunkUsed;
+            memcpy(Copy, Str, Len);
+            Copy[Len] = 0;
+            Table->ChunkUsed += Size;
+            
+            Result = Table->Count;
+            
+            string_entry *Entry = Table->Entries + Result;
+            Entry->Str  = Copy;
+            Entry->Len  = Len;
+            Entry->Hash = Hash;
+            
+            // Publish the id last, the entry has to be complete before a reader can find it
+            Table->Count++;
+            atomic_store_u32(Table->Slots + Slot, Result);
+        }
+    }
+    
+    spin_lock_release(&Table->Lock);
+    
+    return Result;
+}
+
+string_id string_intern_cstr(string_table *Table, const char *Str)
+{
+    return string_intern(Table, Str, (u32)strlen(Str));
+}
+
+const char* string_get(string_table *Table, string_id Id)
+{
+    return Table->Entries[Id].Str;
+}
+
+u32 string_get_len(string_table *Table, string_id Id)
+{
+    return Table->Entries[Id].Len;
+}
+
+#endif
@@ -0,0 +1,356 @@
+// Builds a Maple pack (.mpk) from a directory, see platform/platform/mpk.h for
+// the format.
+//
+// Build: build.bat tools
+// Run:   build\maple_mpk.exe [-store] <directory> <pack.mpk>
+//
+// Every file under the directory goes into the pack, except hidden files and
+// directories, which the asset system skips as well. The pack is mounted like
+// the directory would have been, with the same paths:
+//
+//   maple_mpk.exe data\shaders shaders.mpk
+//   assetsys_mount(AssetSys, "shaders.mpk", "shaders");
+//
+// Data is stored in directory order so files that sit together on disk are
+// read together. The table of contents is sorted by path hash instead.
+//
+// Files are compressed as block streams (utils/block_compress.h) unless that
+// saves less than an eighth of their size. -store keeps every file as is.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+
+#define WINDOWS_LEAN_AND_MEAN
+#include <windows.h>
+
+#include "../platform/utils/maple_types.h"
+
+#define MAPLE_HASH_FUNCTION_IMPLEMENTATION
+#include "../platform/utils/hash_functions.h"
+
+#define MAPLE_BLOCK_COMPRESS_IMPLEMENTATION
+#include "../platform/utils/block_compress.h"
+
+#include "../platform/platform/mpk.h"
+
+#define MPK_BUILDER_MAX_PATH 2048
+// A compressed file is kept only if it is at least 1/MIN_SAVING smaller
+#define MPK_BUILDER_MIN_SAVING 8
+
+#define mpk_align(n, a) (((n) + (a) - 1) & ~(u64)((a) - 1))
+
+typedef struct pack_file
+{
+    char *Path; // relative to the pack's directory
+    u32   PathLen;
+    u64   Size;
+    u64   Offset;
+    u64   Hash;
+    
+    u64   StoredSize; // Size, or the size of its block stream
+    u16   Compression;
+} pack_file;
+
+typedef struct pack_file_list
+{
+    pack_file *Files;
+    u32        Count;
+    u32        Cap;
+} pack_file_list;
+
+typedef struct pack_toc_item
+{
+    u64 Hash;
+    u32 File; // index in the pack_file_list
+} pack_toc_item;
+
+file_internal void pack_file_list_add(pack_file_list *List, const char *Path, u64 Size)
+{
+    if (List->Count == List->Cap)
+    {
+        List->Cap   = (List->Cap) ? List->Cap * 2 : 1024;
+        List->Files = (pack_file*)realloc(List->Files, List->Cap * sizeof(pack_file));
+    }
+    
+    pack_file *File = List->Files + List->Count++;
+    File->PathLen = (u32)strlen(Path);
+    File->Path    = (char*)malloc(File->PathLen + 1);
+    File->Size    = Size;
+    File->Offset  = 0;
+    File->Hash    = mpk_path_hash(Path, File->PathLen);
+    
+    File->StoredSize  = Size;
+    File->Compression = MpkCompression_None;
+    memcpy(File->Path, Path, File->PathLen + 1);
+}
+
+// Relative is the path of Directory inside the pack, empty for the root
+file_internal bool pack_collect_files(pack_file_list *List, const char *Directory, const char *Relative)
+{
+    char Path[MPK_BUILDER_MAX_PATH];
+    snprintf(Path, sizeof(Path), "%s/*", Directory);
+    
+    WIN32_FIND_DATA FindFileData;
+    HANDLE Handle = FindFirstFileEx(Path, FindExInfoStandard, &FindFileData, FindExSearchNameMatch, NULL, 0);
+    
+    if (Handle == INVALID_HANDLE_VALUE)
+    {
+        printf("Unable to read the directory \"%s\"\n", Directory);
+        return false;
+    }
+    
+    bool Result = true;
+    do
+    {
+        // don't allow hidden files or folders, same as the asset system
+        if (FindFileData.cFileName[0] == '.') continue;
+        
+        char ChildPath[MPK_BUILDER_MAX_PATH];
+        char ChildRelative[MPK_BUILDER_MAX_PATH];
+        
+        int PathLen     = snprintf(ChildPath, sizeof(ChildPath), "%s/%s", Directory, FindFileData.cFileName);
+        int RelativeLen = (Relative[0]) ?
+            snprintf(ChildRelative, sizeof(ChildRelative), "%s/%s", Relative, FindFileData.cFileName) :
+            snprintf(ChildRelative, sizeof(ChildRelative), "%s", FindFileData.cFileName);
+        
+        // Names are stored with a 16 bit length
+        if (PathLen >= (int)sizeof(ChildPath) || RelativeLen >= (int)sizeof(ChildRelative) || RelativeLen > 0xFFFF)
+        {
+            printf("Path is too long: \"%s/%s\"\n", Directory, FindFileData.cFileName);
+            Result = false;
+            break;
+        }
+        
+        if (FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            Result = pack_collect_files(List, ChildPath, ChildRelative);
+            if (!Result) break;
+        }
+        else
+        {
+            u64 Size = ((u64)FindFileData.nFileSizeHigh << 32) | (u64)FindFileData.nFileSizeLow;
+            pack_file_list_add(List, ChildRelative, Size);
+        }
+    }
+    while (FindNextFile(Handle, &FindFileData) != 0);
+    
+    FindClose(Handle);
+    return Result;
+}
+
+file_internal int pack_toc_compare(const void *Left, const void *Right)
+{
+    u64 A = ((const pack_toc_item*)Left)->Hash;
+    u64 B = ((const pack_toc_item*)Right)->Hash;
+    return (A < B) ? -1 : (A > B);
+}
+
+file_internal bool pack_write_zeros(FILE *Out, u64 Count)
+{
+    local_persist const u8 Zeros[MPK_ALIGNMENT] = {0};
+    
+    while (Count > 0)
+    {
+        u64 Chunk = (Count < MPK_ALIGNMENT) ? Count : MPK_ALIGNMENT;
+        if (fwrite(Zeros, 1, Chunk, Out) != Chunk) return false;
+        Count -= Chunk;
+    }
+    
+    return true;
+}
+
+// Reads exactly File->Size bytes, a file that changed size since it was
+// listed fails the build rather than corrupting the pack
+file_internal bool pack_read_file(const char *Directory, pack_file *File, u8 *Buffer)
+{
+    char Path[MPK_BUILDER_MAX_PATH];
+    snprintf(Path, sizeof(Path), "%s/%s", Directory, File->Path);
+    
+    FILE *In = fopen(Path, "rb");
+    if (!In)
+    {
+        printf("Unable to open \"%s\"\n", Path);
+        return false;
+    }
+    
+    bool Result = (fread(Buffer, 1, File->Size, In) == File->Size && fgetc(In) == EOF);
+    if (!Result) printf("\"%s\" changed while the pack was being built\n", Path);
+    
+    fclose(In);
+    return Result;
+}
+
+file_internal u8* pack_reserve(u8 *Buffer, u64 *Capacity, u64 Size)
+{
+    if (Size <= *Capacity) return Buffer;
+    
+    *Capacity = Size;
+    return (u8*)realloc(Buffer, Size);
+}
+
+int main(int argc, char **argv)
+{
+    bool Compress = true;
+    if (argc == 4 && strcmp(argv[1], "-store") == 0)
+    {
+        Compress = false;
+        argv++;
+        argc--;
+    }
+    
+    if (argc != 3)
+    {
+        printf("usage: maple_mpk [-store] <directory> <pack.mpk>\n");
+        printf("  -store  keep every file uncompressed\n");
+        return 1;
+    }
+    
+    const char *Directory  = argv[1];
+    const char *OutputPath = argv[2];
+    
+    pack_file_list List = {0};
+    if (!pack_collect_files(&List, Directory, "")) return 1;
+    
+    u64 NamesSize = 0;
+    for (u32 i = 0; i < List.Count; ++i) NamesSize += List.Files[i].PathLen;
+    
+    mpk_header Header = {0};
+    Header.Magic         = MPK_MAGIC;
+    Header.Version       = MPK_VERSION;
+    Header.EntryCount    = List.Count;
+    Header.Alignment     = MPK_ALIGNMENT;
+    Header.EntriesOffset = sizeof(mpk_header);
+    Header.NamesOffset   = Header.EntriesOffset + (u64)List.Count * sizeof(mpk_entry);
+    Header.NamesSize     = NamesSize;
+    Header.DataOffset    = mpk_align(Header.NamesOffset + NamesSize, MPK_ALIGNMENT);
+    
+    FILE *Out = fopen(OutputPath, "wb");
+    if (!Out)
+    {
+        printf("Unable to create \"%s\"\n", OutputPath);
+        return 1;
+    }
+    
+    // Stored sizes are only known once the files are compressed, so the data
+    // is written first, in directory order, and the table after it
+    bool Ok = pack_write_zeros(Out, Header.DataOffset);
+    
+    u8 *Raw    = NULL;
+    u8 *Packed = NULL;
+    u64 RawCapacity    = 0;
+    u64 PackedCapacity = 0;
+    
+    u64 Written         = Header.DataOffset;
+    u64 DataSize        = 0;
+    u64 StoredSize      = 0;
+    u32 CompressedCount = 0;
+    for (u32 i = 0; Ok && i < List.Count; ++i)
+    {
+        pack_file *File = List.Files + i;
+        
+        Raw = pack_reserve(Raw, &RawCapacity, File->Size);
+        Ok  = pack_read_file(Directory, File, Raw);
+        if (!Ok) break;
+        
+        const u8 *Stored  = Raw;
+        File->StoredSize  = File->Size;
+        File->Compression = MpkCompression_None;
+        
+        if (Compress && File->Size > 0)
+        {
+            u64 Bound = block_stream_bound(File->Size, BLOCK_STREAM_DEFAULT_BLOCK);
+            Packed = pack_reserve(Packed, &PackedCapacity, Bound);
+            
+            // Decoding is not free, a file that barely shrinks stays raw
+            u64 StreamSize = block_stream_compress(Raw, File->Size, BLOCK_STREAM_DEFAULT_BLOCK, Packed, Bound);
+            if (StreamSize && StreamSize <= File->Size - File->Size / MPK_BUILDER_MIN_SAVING)
+            {
+                Stored            = Packed;
+                File->StoredSize  = StreamSize;
+                File->Compression = MpkCompression_Blocks;
+                CompressedCount++;
+            }
+        }
+        
+        u64 Alignment = (File->StoredSize >= MPK_ALIGNMENT) ? MPK_ALIGNMENT : MPK_SMALL_ALIGNMENT;
+        File->Offset  = mpk_align(Written, Alignment);
+        
+        Ok = pack_write_zeros(Out, File->Offset - Written) &&
+            fwrite(Stored, 1, File->StoredSize, Out) == File->StoredSize;
+        
+        Written     = File->Offset + File->StoredSize;
+        DataSize   += File->Size;
+        StoredSize += File->StoredSize;
+    }
+    Header.Size = Written;
+    
+    free(Raw);
+    free(Packed);
+    
+    // The table of contents is sorted by hash while the files stay in
+    // directory order
+    u32 TocCount = (List.Count) ? List.Count : 1;
+    pack_toc_item *Toc = (pack_toc_item*)malloc(TocCount * sizeof(pack_toc_item));
+    for (u32 i = 0; i < List.Count; ++i)
+    {
+        Toc[i].Hash = List.Files[i].Hash;
+        Toc[i].File = i;
+    }
+    
+    qsort(Toc, List.Count, sizeof(pack_toc_item), pack_toc_compare);
+    
+    for (u32 i = 1; Ok && i < List.Count; ++i)
+    {
+        if (Toc[i].Hash == Toc[i - 1].Hash)
+        {
+            printf("\"%s\" and \"%s\" have the same hash, rename one of them\n",
+                   List.Files[Toc[i - 1].File].Path, List.Files[Toc[i].File].Path);
+            Ok = false;
+        }
+    }
+    
+    // Names are stored in table order
+    mpk_entry *Entries = (mpk_entry*)calloc(TocCount, sizeof(mpk_entry));
+    u32 NameOffset = 0;
+    for (u32 i = 0; i < List.Count; ++i)
+    {
+        pack_file *File  = List.Files + Toc[i].File;
+        mpk_entry *Entry = Entries + i;
+        
+        Entry->PathHash    = File->Hash;
+        Entry->Offset      = File->Offset;
+        Entry->Size        = File->StoredSize;
+        Entry->RawSize     = File->Size;
+        Entry->NameOffset  = NameOffset;
+        Entry->NameLen     = (u16)File->PathLen;
+        Entry->Compression = File->Compression;
+        
+        NameOffset += File->PathLen;
+    }
+    
+    if (Ok) Ok = (fseek(Out, 0, SEEK_SET) == 0 && fwrite(&Header, sizeof(Header), 1, Out) == 1);
+    if (Ok && List.Count) Ok = (fwrite(Entries, sizeof(mpk_entry), List.Count, Out) == List.Count);
+    for (u32 i = 0; Ok && i < List.Count; ++i)
+    {
+        pack_file *File = List.Files + Toc[i].File;
+        Ok = (fwrite(File->Path, 1, File->PathLen, Out) == File->PathLen);
+    }
+    
+    Ok = (fclose(Out) == 0) && Ok;
+    
+    if (!Ok)
+    {
+        printf("Unable to write \"%s\"\n", OutputPath);
+        remove(OutputPath);
+        return 1;
+    }
+    
+    printf("%s: %u files (%u compressed), %.1f MB of data stored in %.1f MB (%.1f%%), %.1f MB packed\n",
+           OutputPath, List.Count, CompressedCount, DataSize / (1024.0 * 1024.0), StoredSize / (1024.0 * 1024.0),
+           (DataSize) ? 100.0 * (r64)StoredSize / (r64)DataSize : 100.0, Header.Size / (1024.0 * 1024.0));
+    
+    return 0;
+}